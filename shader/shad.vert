@@ -15,6 +15,8 @@ layout(location = 3) in vec2 inTexCoord;
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 
+invariant gl_Position;
+
 void main()
 {
 	gl_Position = ubo.projection * ubo.view * ubo.model * vec4(inPosition, 1.0);
@@ -0,0 +1,26 @@
+#version 460
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(binding = 0) uniform UniformBufferObject {
+	mat4 model;
+	mat4 view;
+	mat4 projection;
+} ubo;
+
+// positions are unorm16 inside the mesh bounds, model includes the dequantize transform
+// a glTF mesh feeds float positions and normals in place, the normal's third component is dropped
+layout(location = 0) in vec3 inPosition;
+layout(location = 2) in vec2 normal;		// octahedral, unused for now
+layout(location = 3) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+
+invariant gl_Position;
+
+void main()
+{
+	gl_Position = ubo.projection * ubo.view * ubo.model * vec4(inPosition, 1.0);
+	fragColor = vec3(1.0);
+	fragTexCoord = inTexCoord;
+}
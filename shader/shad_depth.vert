@@ -0,0 +1,19 @@
+#version 460
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(binding = 0) uniform UniformBufferObject {
+	mat4 model;
+	mat4 view;
+	mat4 projection;
+} ubo;
+
+// depth prepass, binds the position stream alone
+// must match the shading pass bit for bit, that pass tests with LESS_OR_EQUAL against this depth
+layout(location = 0) in vec3 inPosition;
+
+invariant gl_Position;
+
+void main()
+{
+	gl_Position = ubo.projection * ubo.view * ubo.model * vec4(inPosition, 1.0);
+}
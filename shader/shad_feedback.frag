@@ -0,0 +1,35 @@
+#version 460
+#extension GL_ARB_separate_shader_objects : enable
+
+// page layout of core/VirtualTexture.h, the pass runs at 1 / VT_FEEDBACK_SCALE of the swapchain extent
+const float PAGE_SIZE = 128.0;
+const float FEEDBACK_SCALE_LOG2 = 3.0;
+
+layout(binding = 0) uniform UniformBufferObject {
+	mat4 model;
+	mat4 view;
+	mat4 projection;
+	vec4 virtualTexture;	// width, height, level count
+} ubo;
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+
+// packVirtualPage : level, page row, page column
+layout(location = 0) out uint outPage;
+
+void main()
+{
+	// derivatives are taken at the feedback resolution, scale them back to the pixels the main pass shades
+	vec2 size = ubo.virtualTexture.xy;
+	vec2 texel = fragTexCoord * size;
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	float level = clamp(floor(0.5 * log2(max(dot(dx, dx), dot(dy, dy))) - FEEDBACK_SCALE_LOG2), 0.0, ubo.virtualTexture.z - 1.0);
+
+	vec2 uv = fract(fragTexCoord);
+	vec2 levelSize = max(floor(size / exp2(level)), vec2(1.0));
+	uvec2 page = uvec2(min(floor(uv * levelSize / PAGE_SIZE), floor((levelSize - 1.0) / PAGE_SIZE)));
+
+	outPage = (uint(level) << 24) | (page.y << 12) | page.x;
+}
\ No newline at end of file
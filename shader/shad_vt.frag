@@ -0,0 +1,50 @@
+#version 460
+#extension GL_ARB_separate_shader_objects : enable
+
+// page layout of core/VirtualTexture.h
+const float PAGE_SIZE = 128.0;
+const float PAGE_BORDER = 4.0;
+const float TILE_SIZE = 136.0;
+
+layout(binding = 0) uniform UniformBufferObject {
+	mat4 model;
+	mat4 view;
+	mat4 projection;
+	vec4 virtualTexture;	// width, height, level count
+} ubo;
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(binding = 1) uniform sampler2D pageCache;
+layout(binding = 2) uniform usampler2D indirection;		// slot x, slot y, resident level
+
+layout(location = 0) out vec4 outFragColor;
+
+void main()
+{
+	vec2 size = ubo.virtualTexture.xy;
+	vec2 texel = fragTexCoord * size;
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	float level = clamp(floor(0.5 * log2(max(dot(dx, dx), dot(dy, dy)))), 0.0, ubo.virtualTexture.z - 1.0);
+
+	// repeat addressing like the regular texture sampler
+	vec2 uv = fract(fragTexCoord);
+	vec2 levelSize = max(floor(size / exp2(level)), vec2(1.0));
+	ivec2 page = ivec2(min(floor(uv * levelSize / PAGE_SIZE), floor((levelSize - 1.0) / PAGE_SIZE)));
+	uvec4 entry = texelFetch(indirection, page, int(level));
+
+	// the entry may be a coarser page standing in for one that isn't resident, address it in its own level
+	// relative to the page the entry holds, rebuildIndirection halves the page coordinates down to it and clamps them
+	// to the level's pages, on levels that aren't a power of two the texel can sit up to a texel outside that page,
+	// the border holds it
+	vec2 residentSize = max(floor(size / exp2(float(entry.b))), vec2(1.0));
+	vec2 residentTexel = min(uv * residentSize, residentSize - 0.5);
+	ivec2 residentPage = min(page >> (int(entry.b) - int(level)), ivec2(ceil(residentSize / PAGE_SIZE)) - 1);
+	vec2 inPage = clamp(residentTexel - vec2(residentPage) * PAGE_SIZE, -PAGE_BORDER + 0.5, PAGE_SIZE + PAGE_BORDER - 0.5);
+
+	vec2 cacheTexel = vec2(entry.rg) * TILE_SIZE + PAGE_BORDER + inPage;
+	vec3 color = textureLod(pageCache, cacheTexel / vec2(textureSize(pageCache, 0)), 0.0).rgb;
+	outFragColor = vec4(fragColor * color, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef DJINNLIB_FILE_STAMP_INCLUDE_H
+#define DJINNLIB_FILE_STAMP_INCLUDE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace Djinn
+{
+	// identity of a source file, caches store it to notice when they are stale
+	struct FileStamp
+	{
+		uint64_t size{ 0 };
+		int64_t writeTime{ 0 };
+	};
+
+	inline bool queryFileStamp(const std::string& path, FileStamp& stamp)
+	{
+		std::error_code ec;
+		const auto size{ std::filesystem::file_size(path, ec) };
+		if (ec)
+		{
+			return false;
+		}
+
+		const auto writeTime{ std::filesystem::last_write_time(path, ec) };
+		if (ec)
+		{
+			return false;
+		}
+
+		stamp.size = static_cast<uint64_t>(size);
+		stamp.writeTime = writeTime.time_since_epoch().count();
+		return true;
+	}
+}
+
+#endif // DJINNLIB_FILE_STAMP_INCLUDE_H
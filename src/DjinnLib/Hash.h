@@ -0,0 +1,72 @@
+#ifndef DJINNLIB_HASH_INCLUDE_H
+#define DJINNLIB_HASH_INCLUDE_H
+
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+namespace Djinn
+{
+	constexpr uint64_t FNV_OFFSET_BASIS{ 0xcbf29ce484222325ULL };
+	constexpr uint64_t FNV_PRIME{ 0x100000001b3ULL };
+
+	// FNV-1a over a string, usable at compile time
+	constexpr uint64_t HashFNV1a(const std::string_view str, uint64_t hash = FNV_OFFSET_BASIS)
+	{
+		for (const char c : str)
+		{
+			hash ^= static_cast<uint8_t>(c);
+			hash *= FNV_PRIME;
+		}
+		return hash;
+	}
+
+	// FNV-1a over the 8 bytes of an integer, usable at compile time
+	constexpr uint64_t HashCombine(uint64_t hash, const uint64_t value)
+	{
+		for (uint32_t i = 0; i < 8; ++i)
+		{
+			hash ^= (value >> (i * 8)) & 0xff;
+			hash *= FNV_PRIME;
+		}
+		return hash;
+	}
+
+	// murmur3 finalizer, spreads every input bit over the whole word
+	constexpr uint64_t HashMix64(uint64_t value)
+	{
+		value ^= value >> 33;
+		value *= 0xff51afd7ed558ccdULL;
+		value ^= value >> 33;
+		value *= 0xc4ceb9fe1a85ec53ULL;
+		value ^= value >> 33;
+		return value;
+	}
+
+	// bits of a float for hashing, -0.0f and 0.0f compare equal so they must hash equal
+	inline uint32_t FloatBits(const float value)
+	{
+		return std::bit_cast<uint32_t>(value == 0.0f ? 0.0f : value);
+	}
+
+	// hashes a run of floats two at a time, consistent with comparing them with ==
+	inline uint64_t HashFloats(const float* values, const size_t count, uint64_t hash = FNV_OFFSET_BASIS)
+	{
+		size_t i{ 0 };
+		for (; i + 1 < count; i += 2)
+		{
+			const uint64_t word{ (static_cast<uint64_t>(FloatBits(values[i])) << 32) | FloatBits(values[i + 1]) };
+			hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+			hash ^= hash >> 32;
+		}
+		if (i < count)
+		{
+			hash = (hash ^ FloatBits(values[i])) * 0x9e3779b97f4a7c15ULL;
+			hash ^= hash >> 32;
+		}
+		return HashMix64(hash);
+	}
+}
+
+#endif // DJINNLIB_HASH_INCLUDE_H
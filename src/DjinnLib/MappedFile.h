@@ -0,0 +1,181 @@
+#ifndef DJINNLIB_MAPPED_FILE_INCLUDE_H
+#define DJINNLIB_MAPPED_FILE_INCLUDE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Djinn
+{
+	// read-only mapping of a whole file
+	// pages are faulted in by the OS on first touch, so nothing is copied up front
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile() { Close(); }
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		MappedFile(MappedFile&& other) noexcept { swap(other); }
+		MappedFile& operator=(MappedFile&& other) noexcept
+		{
+			if (this != &other)
+			{
+				Close();
+				swap(other);
+			}
+			return *this;
+		}
+
+		// returns false if the file does not exist or is empty
+		bool Open(const std::string& path)
+		{
+			Close();
+#if defined(_WIN32)
+			file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+			{
+				return false;
+			}
+
+			LARGE_INTEGER fileSize{};
+			if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+			{
+				Close();
+				return false;
+			}
+
+			mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping == nullptr)
+			{
+				Close();
+				return false;
+			}
+
+			data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			if (data == nullptr)
+			{
+				Close();
+				return false;
+			}
+			size = static_cast<size_t>(fileSize.QuadPart);
+#else
+			const int fd{ open(path.c_str(), O_RDONLY) };
+			if (fd < 0)
+			{
+				return false;
+			}
+
+			struct stat fileStat {};
+			if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0)
+			{
+				close(fd);
+				return false;
+			}
+
+			void* ptr{ mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0) };
+			// the mapping keeps its own reference to the file
+			close(fd);
+			if (ptr == MAP_FAILED)
+			{
+				return false;
+			}
+
+			data = static_cast<const uint8_t*>(ptr);
+			size = static_cast<size_t>(fileStat.st_size);
+#endif
+			return true;
+		}
+
+		void Close()
+		{
+#if defined(_WIN32)
+			if (data != nullptr)
+			{
+				UnmapViewOfFile(data);
+			}
+			if (mapping != nullptr)
+			{
+				CloseHandle(mapping);
+			}
+			if (file != INVALID_HANDLE_VALUE)
+			{
+				CloseHandle(file);
+			}
+			mapping = nullptr;
+			file = INVALID_HANDLE_VALUE;
+#else
+			if (data != nullptr)
+			{
+				munmap(const_cast<uint8_t*>(data), size);
+			}
+#endif
+			data = nullptr;
+			size = 0;
+		}
+
+		// read-ahead hint for a range that is about to be read, the OS starts paging it in asynchronously
+		void WillNeed(const size_t offset, const size_t length) const
+		{
+			if (data == nullptr || offset >= size)
+			{
+				return;
+			}
+			const size_t end{ offset + std::min(length, size - offset) };
+#if defined(_WIN32)
+			WIN32_MEMORY_RANGE_ENTRY range{};
+			range.VirtualAddress = const_cast<uint8_t*>(data + offset);
+			range.NumberOfBytes = end - offset;
+			PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+			// madvise wants a page aligned start
+			const auto pageSize{ static_cast<size_t>(sysconf(_SC_PAGESIZE)) };
+			const size_t begin{ offset - offset % pageSize };
+			madvise(const_cast<uint8_t*>(data + begin), end - begin, MADV_WILLNEED);
+#endif
+		}
+
+		bool IsOpen() const { return data != nullptr; }
+		const uint8_t* Data() const { return data; }
+		size_t Size() const { return size; }
+
+	private:
+		void swap(MappedFile& other) noexcept
+		{
+			std::swap(data, other.data);
+			std::swap(size, other.size);
+#if defined(_WIN32)
+			std::swap(file, other.file);
+			std::swap(mapping, other.mapping);
+#endif
+		}
+
+		const uint8_t* data{ nullptr };
+		size_t size{ 0 };
+#if defined(_WIN32)
+		HANDLE file{ INVALID_HANDLE_VALUE };
+		HANDLE mapping{ nullptr };
+#endif
+	};
+}
+
+#endif // DJINNLIB_MAPPED_FILE_INCLUDE_H
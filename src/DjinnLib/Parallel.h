@@ -0,0 +1,57 @@
+#ifndef DJINNLIB_PARALLEL_INCLUDE_H
+#define DJINNLIB_PARALLEL_INCLUDE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace Djinn
+{
+	inline uint32_t hardwareThreadCount()
+	{
+		return std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// runs task(i) for every i in [0, count), one thread per task
+	// the calling thread runs task 0 so a single task never spawns anything
+	template <typename Task>
+	void parallelFor(const size_t count, Task&& task)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		std::vector<std::thread> workers;
+		workers.reserve(count - 1);
+		for (size_t i = 1; i < count; ++i)
+		{
+			workers.emplace_back([&task, i]() { task(i); });
+		}
+
+		task(size_t{ 0 });
+
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	// splits [0, count) into contiguous bands of at least minBandSize, one band per hardware thread
+	// task(begin, end) runs once per band, small counts stay on the calling thread
+	template <typename Task>
+	void parallelForBands(const size_t count, const size_t minBandSize, Task&& task)
+	{
+		const size_t bands{ std::clamp(count / std::max(minBandSize, size_t{ 1 }), size_t{ 1 }, size_t{ hardwareThreadCount() }) };
+		const size_t bandSize{ (count + bands - 1) / bands };
+		parallelFor(bands, [&](const size_t band)
+			{
+				const size_t begin{ band * bandSize };
+				task(begin, std::min(count, begin + bandSize));
+			});
+	}
+}
+
+#endif // DJINNLIB_PARALLEL_INCLUDE_H
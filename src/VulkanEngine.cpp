@@ -5,16 +5,11 @@
 #include "core/Image.h"
 #include "core/defs.h"
 #include "core/Memory.h"
-#include "core/Commands.h"
+#include "core/Meshlet.h"
+#include "core/MeshLod.h"
 
 #include <chrono>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
-
-#define TINYOBJLOADER_IMPLEMENTATION // define this in only *one* .cc
-#include <tiny_obj_loader.h>
-
 #define VMA_IMPLEMENTATION
 #include "external/vk_mem_alloc.h"
 
@@ -48,6 +43,8 @@ void Djinn::VulkanEngine::initVulkan()
 	mainDeletionQueue.PushFunction([=]()
 		{	p_context->CleanUp(); });
 	initVMA();
+	initAllocator();
+	initUploads();
 	const auto indices = p_context->queueFamilyIndices;
 	msaaSamples = p_context->renderConfig.msaaSamples;
 	p_swapChain = new SwapChain(p_context);
@@ -56,18 +53,37 @@ void Djinn::VulkanEngine::initVulkan()
 	createRenderPass();			//
 	createDescriptorPool();		//
 	createDescriptorSetLayout();//
+	requestAssets();			// before the pipeline, the vertex format depends on the mesh
 	createGraphicsPipeline();	//
 	createColorResources();     //
 	createDepthResources();		//
+	if (p_context->renderConfig.virtualTexturing)
+	{
+		createFeedbackResources();
+	}
 	//createFramebuffers();		//
 	p_swapChain->createFramebuffers(p_context, &colorImage, &depthImage, renderPass);
 	//createCommandPool();		//
-	createTextureImage();		// 
-	createTextureImageView();	//
-	createTextureSampler();		//
-	loadModel(MODEL_PATH);				//
+	auto placeholderTexture{ std::make_unique<TextureAsset>() };
+	buildPlaceholderTexture(*placeholderTexture);
+	// replaced once the streamed texture is decoded
+	if (p_context->renderConfig.virtualTexturing)
+	{
+		createVirtualTexture(std::move(placeholderTexture));
+	}
+	else
+	{
+		createTextureImage(*placeholderTexture);
+		createTextureImageView();	//
+		createTextureSampler();		//
+	}
+	mainDeletionQueue.PushFunction([=]()
+		{destroyTexture(); });
 	createVertexBufferStaged();		//
 	createIndexBufferStaged();		//
+	createMeshletBuffers();		//
+	mainDeletionQueue.PushFunction([=]()
+		{destroyMeshBuffers(); });
 	createUniformBuffers();		//
 	createDescriptorSets();		//
 	createCommandBuffers();		//
@@ -85,8 +101,36 @@ void Djinn::VulkanEngine::initVMA()
 		{vmaDestroyAllocator(VMA);});
 }
 
+void Djinn::VulkanEngine::initAllocator()
+{
+	allocator.Init(p_context);
+	p_context->p_allocator = &allocator;
+	mainDeletionQueue.PushFunction([=]()
+		{
+			allocator.LogStats();
+			spdlog::info("Uploads: {:.2f} MiB written in place, {:.2f} MiB staged",
+				static_cast<double>(p_context->uploadStats.directBytes) / (1 << 20), static_cast<double>(p_context->uploadStats.stagedBytes) / (1 << 20));
+			allocator.CleanUp();
+			p_context->p_allocator = nullptr;
+		});
+}
+
+void Djinn::VulkanEngine::initUploads()
+{
+	uploadContext.Init(p_context, p_context->renderConfig.uploadStagingSize);
+	p_context->p_uploads = &uploadContext;
+	mainDeletionQueue.PushFunction([=]()
+		{
+			uploadContext.LogStats();
+			uploadContext.CleanUp();
+			p_context->p_uploads = nullptr;
+		});
+}
+
 void Djinn::VulkanEngine::CleanUp()
 {
+	// uploads recorded since the last frame still go out, they may reference what is destroyed below
+	uploadContext.Submit();
 	// wait for the device to not be "mid-work" before we destroy objects
 	vkDeviceWaitIdle(p_context->gpuInfo.device);
 	swapchainDeletionQueue.Flush();
@@ -132,6 +176,10 @@ void Djinn::VulkanEngine::recreateSwapChain()
 	createGraphicsPipeline();
 	createColorResources();     //
 	createDepthResources();		//
+	if (p_context->renderConfig.virtualTexturing)
+	{
+		createFeedbackResources();
+	}
 	p_swapChain->createFramebuffers(p_context, &colorImage, &depthImage, renderPass);
 	createDescriptorPool();		//
 	createDescriptorSets();		//
@@ -149,12 +197,93 @@ void Djinn::VulkanEngine::createRenderPass()
 	renderPass.Init(p_context, config);
 	swapchainDeletionQueue.PushFunction([=]()
 		{renderPass.CleanUp(p_context); });
+
+	if (p_context->renderConfig.virtualTexturing)
+	{
+		createFeedbackRenderPass();
+	}
+}
+
+// page ids in a single sample R32_UINT target, copied out to the readback buffer right after the pass
+void Djinn::VulkanEngine::createFeedbackRenderPass()
+{
+	feedbackExtent.width = std::max(1u, p_swapChain->swapChainExtent.width / VT_FEEDBACK_SCALE);
+	feedbackExtent.height = std::max(1u, p_swapChain->swapChainExtent.height / VT_FEEDBACK_SCALE);
+
+	VkAttachmentDescription colorAttachment{};
+	colorAttachment.format = VK_FORMAT_R32_UINT;
+	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+	VkAttachmentDescription depthAttachment{};
+	depthAttachment.format = findDepthFormat(p_context);
+	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference colorAttachmentRef{};
+	colorAttachmentRef.attachment = 0;
+	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference depthAttachmentRef{};
+	depthAttachmentRef.attachment = 1;
+	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass{};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorAttachmentRef;
+	subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+	// the depth image is shared by the frames in flight, the ids are read by the copy that follows the pass
+	Djinn::Array1D<VkSubpassDependency, 2> dependencies{};
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	Djinn::Array1D<VkAttachmentDescription, 2> attachments{ colorAttachment, depthAttachment };
+
+	VkRenderPassCreateInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.NumElem());
+	renderPassInfo.pAttachments = attachments.Ptr();
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.NumElem());
+	renderPassInfo.pDependencies = dependencies.Ptr();
+
+	auto result{ vkCreateRenderPass(p_context->gpuInfo.device, &renderPassInfo, nullptr, &feedbackRenderPass) };
+	DJINN_VK_ASSERT(result);
+
+	swapchainDeletionQueue.PushFunction([=]()
+		{vkDestroyRenderPass(p_context->gpuInfo.device, feedbackRenderPass, nullptr); });
 }
 
 void Djinn::VulkanEngine::createGraphicsPipeline()
 {
-	ShaderLoader vertShader("shader/vert.spv", p_context->gpuInfo.device, VK_SHADER_STAGE_VERTEX_BIT);
-	ShaderLoader fragShader("shader/frag.spv", p_context->gpuInfo.device, VK_SHADER_STAGE_FRAGMENT_BIT);
+	ShaderLoader vertShader(vertexShaderPath(mesh->streams), p_context->gpuInfo.device, VK_SHADER_STAGE_VERTEX_BIT);
+	const bool virtualTexturing{ p_context->renderConfig.virtualTexturing };
+	ShaderLoader fragShader(virtualTexturing ? "shader/vt_frag.spv" : "shader/frag.spv", p_context->gpuInfo.device, VK_SHADER_STAGE_FRAGMENT_BIT);
+
+	const bool depthPrepass{ p_context->renderConfig.depthPrepass };
 
 	GraphicsPipelineBuilder graphicsPipelineBuilder;
 	PipelineConfig pipelineConfig;
@@ -165,6 +294,12 @@ void Djinn::VulkanEngine::createGraphicsPipeline()
 	pipelineConfig.renderPass = renderPass.handle;
 	pipelineConfig.shaderLoaders.push_back(vertShader);
 	pipelineConfig.shaderLoaders.push_back(fragShader);
+	// the prepass already wrote the closest depth, shading only passes where it matches
+	pipelineConfig.depthCompareOp = depthPrepass ? VK_COMPARE_OP_LESS_OR_EQUAL : VK_COMPARE_OP_LESS;
+
+	auto shadedInput{ vertexInputLayout(mesh->streams, VertexPass::VERTEX_PASS_SHADED) };
+	pipelineConfig.vertexBindings = std::move(shadedInput.bindings);
+	pipelineConfig.vertexAttributes = std::move(shadedInput.attributes);
 
 	graphicsPipeline = graphicsPipelineBuilder.BuildPipeline(p_context, p_swapChain, pipelineConfig);
 
@@ -175,6 +310,74 @@ void Djinn::VulkanEngine::createGraphicsPipeline()
 	swapchainDeletionQueue.PushFunction([=]()
 		{vkDestroyPipeline(p_context->gpuInfo.device, graphicsPipeline.pipeline, nullptr);
 		vkDestroyPipelineLayout(p_context->gpuInfo.device, graphicsPipeline.pipelineLayout, nullptr); });
+
+	if (depthPrepass)
+	{
+		createDepthPipeline();
+	}
+	if (virtualTexturing)
+	{
+		createFeedbackPipeline();
+	}
+}
+
+// filled triangles, no fragment stage and no color writes, only the position stream is bound
+void Djinn::VulkanEngine::createDepthPipeline()
+{
+	ShaderLoader vertShader("shader/depth_vert.spv", p_context->gpuInfo.device, VK_SHADER_STAGE_VERTEX_BIT);
+
+	GraphicsPipelineBuilder graphicsPipelineBuilder;
+	PipelineConfig pipelineConfig;
+	pipelineConfig.descriptorSetLayouts.push_back(descriptorSetLayout);
+	pipelineConfig.msaaSamples = msaaSamples;
+	pipelineConfig.polygonMode = VK_POLYGON_MODE_FILL;
+	pipelineConfig.primitiveTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	pipelineConfig.renderPass = renderPass.handle;
+	pipelineConfig.shaderLoaders.push_back(vertShader);
+	pipelineConfig.colorWrites = false;
+
+	auto depthInput{ vertexInputLayout(mesh->streams, VertexPass::VERTEX_PASS_DEPTH) };
+	pipelineConfig.vertexBindings = std::move(depthInput.bindings);
+	pipelineConfig.vertexAttributes = std::move(depthInput.attributes);
+
+	depthPipeline = graphicsPipelineBuilder.BuildPipeline(p_context, p_swapChain, pipelineConfig);
+
+	vertShader.DestroyModule();
+
+	swapchainDeletionQueue.PushFunction([=]()
+		{vkDestroyPipeline(p_context->gpuInfo.device, depthPipeline.pipeline, nullptr);
+		vkDestroyPipelineLayout(p_context->gpuInfo.device, depthPipeline.pipelineLayout, nullptr); });
+}
+
+// the shaded vertex input at the feedback extent, the fragment stage writes the page a pixel wants instead of its color
+void Djinn::VulkanEngine::createFeedbackPipeline()
+{
+	ShaderLoader vertShader(vertexShaderPath(mesh->streams), p_context->gpuInfo.device, VK_SHADER_STAGE_VERTEX_BIT);
+	ShaderLoader fragShader("shader/feedback_frag.spv", p_context->gpuInfo.device, VK_SHADER_STAGE_FRAGMENT_BIT);
+
+	GraphicsPipelineBuilder graphicsPipelineBuilder;
+	PipelineConfig pipelineConfig;
+	pipelineConfig.descriptorSetLayouts.push_back(descriptorSetLayout);
+	pipelineConfig.polygonMode = VK_POLYGON_MODE_FILL;
+	pipelineConfig.primitiveTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	pipelineConfig.renderPass = feedbackRenderPass;
+	pipelineConfig.shaderLoaders.push_back(vertShader);
+	pipelineConfig.shaderLoaders.push_back(fragShader);
+	pipelineConfig.blending = false;
+	pipelineConfig.extent = feedbackExtent;
+
+	auto shadedInput{ vertexInputLayout(mesh->streams, VertexPass::VERTEX_PASS_SHADED) };
+	pipelineConfig.vertexBindings = std::move(shadedInput.bindings);
+	pipelineConfig.vertexAttributes = std::move(shadedInput.attributes);
+
+	feedbackPipeline = graphicsPipelineBuilder.BuildPipeline(p_context, p_swapChain, pipelineConfig);
+
+	vertShader.DestroyModule();
+	fragShader.DestroyModule();
+
+	swapchainDeletionQueue.PushFunction([=]()
+		{vkDestroyPipeline(p_context->gpuInfo.device, feedbackPipeline.pipeline, nullptr);
+		vkDestroyPipelineLayout(p_context->gpuInfo.device, feedbackPipeline.pipelineLayout, nullptr); });
 }
 
 
@@ -199,50 +402,133 @@ void Djinn::VulkanEngine::createDepthResources()
 		{depthImage.CleanUp(p_context); });
 }
 
-void Djinn::VulkanEngine::createTextureImage()
+// per swapchain image, an id target, its framebuffer and the host visible buffer the ids are copied into
+// the depth image is shared like the main pass's
+void Djinn::VulkanEngine::createFeedbackResources()
 {
-	int texWidth{ 0 };
-	int texHeight{ 0 };
-	int texChannels{ 0 };
+	ImageCreateInfo depthInfo{};
+	depthInfo.width = feedbackExtent.width;
+	depthInfo.height = feedbackExtent.height;
+	depthInfo.mipLevels = 1;
+	depthInfo.format = findDepthFormat(p_context);
+	depthInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	depthInfo.memoryFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	depthInfo.usageFlags = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	depthInfo.aspectFlags = VK_IMAGE_ASPECT_DEPTH_BIT;
+	depthInfo.sharingMode = p_swapChain->sharingMode;
+	depthInfo.numSamples = VK_SAMPLE_COUNT_1_BIT;
+	feedbackDepthImage.Init(p_context, depthInfo);
+
+	ImageCreateInfo colorInfo{ depthInfo };
+	colorInfo.format = VK_FORMAT_R32_UINT;
+	colorInfo.usageFlags = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	colorInfo.aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
+
+	BufferCreateInfo bufferInfo{};
+	bufferInfo.size = static_cast<VkDeviceSize>(feedbackExtent.width) * feedbackExtent.height * sizeof(uint32_t);
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	bufferInfo.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	bufferInfo.sharingMode = p_swapChain->sharingMode;
+
+	const size_t imageCount{ p_swapChain->swapChainImages.size() };
+	feedbackImages.resize(imageCount);
+	feedbackFramebuffers.resize(imageCount);
+	feedbackBuffers.resize(imageCount);
+	feedbackReady.assign(imageCount, false);
+	for (size_t i = 0; i < imageCount; ++i)
+	{
+		feedbackImages[i].Init(p_context, colorInfo);
+		feedbackBuffers[i].Init(p_context, bufferInfo);
 
-	stbi_uc* pixels{ stbi_load(TEXTURE_PATH.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha) };
-	assert(pixels != nullptr);
-	const VkDeviceSize imageSize = texWidth * texHeight * 4;
+		Djinn::Array1D<VkImageView, 2> attachments{ feedbackImages[i].imageView, feedbackDepthImage.imageView };
 
-	m_mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
+		VkFramebufferCreateInfo framebufferCreateInfo{};
+		framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferCreateInfo.renderPass = feedbackRenderPass;
+		framebufferCreateInfo.attachmentCount = static_cast<uint32_t>(attachments.NumElem());
+		framebufferCreateInfo.pAttachments = attachments.Ptr();
+		framebufferCreateInfo.width = feedbackExtent.width;
+		framebufferCreateInfo.height = feedbackExtent.height;
+		framebufferCreateInfo.layers = 1;
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
+		auto result{ vkCreateFramebuffer(p_context->gpuInfo.device, &framebufferCreateInfo, nullptr, &feedbackFramebuffers[i]) };
+		DJINN_VK_ASSERT(result);
+	}
 
-	createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-		VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory, 0);
+	swapchainDeletionQueue.PushFunction([=]()
+		{
+			for (size_t i = 0; i < feedbackImages.size(); ++i)
+			{
+				vkDestroyFramebuffer(p_context->gpuInfo.device, feedbackFramebuffers[i], nullptr);
+				feedbackImages[i].CleanUp(p_context);
+				feedbackBuffers[i].CleanUp(p_context);
+			}
+			feedbackDepthImage.CleanUp(p_context);
+		});
+}
 
-	void* data;
-	vkMapMemory(p_context->gpuInfo.device, stagingBufferMemory, 0, imageSize, 0, &data);
-	memcpy(data, pixels, static_cast<size_t>(imageSize));
-	vkUnmapMemory(p_context->gpuInfo.device, stagingBufferMemory);
+// allocates every level but only uploads the mip tail that fits the frame budget, streamTextureMips does the rest
+void Djinn::VulkanEngine::createTextureImage(const TextureAsset& texture)
+{
+	m_mipLevels = static_cast<uint32_t>(texture.levels.size());
+	textureFormat = textureVkFormat(texture.format, texture.srgb);
+	textureComponents = textureComponentMapping(texture.format);
+
+	createImage(texture.width, texture.height, m_mipLevels, textureFormat, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageAllocation);
 
-	stbi_image_free(pixels);
+	residentMip = textureLevelsInBudget(texture, m_mipLevels);
+	uploadTextureLevels(texture, residentMip, m_mipLevels, true);
+}
 
-	createImage(texWidth, texHeight, m_mipLevels, VK_FORMAT_R8G8B8A8_SRGB, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+// levels [firstLevel, endLevel) are contiguous in the pyramid, they go up through one staging range
+void Djinn::VulkanEngine::uploadTextureLevels(const TextureAsset& texture, const uint32_t firstLevel, const uint32_t endLevel, const bool firstUpload)
+{
+	const std::span<const MipLevel> levels{ texture.levels.subspan(firstLevel, endLevel - firstLevel) };
+	const uint64_t bufferBase{ levels.front().offset };
+	const VkDeviceSize uploadSize{ levels.back().offset + levels.back().size - bufferBase };
 
-	// transition image to transfer dst -> copy to image -> transfer to shader read only to sample from
-	transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_mipLevels);
-	copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-	//transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_mipLevels);
+	const StagingRange staging{ uploadContext.Stage(uploadSize) };
+	memcpy(staging.data, texture.pixels.data() + bufferBase, static_cast<size_t>(uploadSize));
 
-	vkDestroyBuffer(p_context->gpuInfo.device, stagingBuffer, nullptr);
-	vkFreeMemory(p_context->gpuInfo.device, stagingBufferMemory, nullptr);
+	copyBufferToImage(staging, textureImage, levels, bufferBase, firstLevel, firstUpload);
+}
 
-	generateMipMaps(textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, m_mipLevels);
-	mainDeletionQueue.PushFunction([=]()
-		{vkDestroyImage(p_context->gpuInfo.device, textureImage, nullptr);
-		vkFreeMemory(p_context->gpuInfo.device, textureImageMemory, nullptr); });
+// walks from endLevel towards level 0 and returns the finest level whose upload still fits the budget
+// the coarsest candidate is always taken, a single level larger than the budget goes up on its own
+uint32_t Djinn::VulkanEngine::textureLevelsInBudget(const TextureAsset& texture, const uint32_t endLevel) const
+{
+	const uint64_t budget{ p_context->renderConfig.textureUploadBudget };
+
+	uint32_t firstLevel{ endLevel - 1 };
+	uint64_t uploadSize{ texture.levels[firstLevel].size };
+	while (firstLevel > 0 && uploadSize + texture.levels[firstLevel - 1].size <= budget)
+	{
+		--firstLevel;
+		uploadSize += texture.levels[firstLevel].size;
+	}
+	return firstLevel;
+}
+
+// uploads the next finer levels of the streaming texture, the descriptor sets follow in drawFrame
+void Djinn::VulkanEngine::streamTextureMips()
+{
+	const uint32_t firstLevel{ textureLevelsInBudget(*streamingTexture, residentMip) };
+	uploadTextureLevels(*streamingTexture, firstLevel, residentMip, false);
+
+	residentMip = firstLevel;
+	createTextureSampler();
+
+	if (residentMip == 0)
+	{
+		spdlog::info("{} fully resident", streamingTexture->path);
+		streamingTexture.reset();
+	}
 }
 
-VkImageView Djinn::VulkanEngine::createImageView(const VkImage image, const VkFormat format, const VkImageAspectFlags aspectFlags, const uint32_t mipLevels)
+VkImageView Djinn::VulkanEngine::createImageView(const VkImage image, const VkFormat format, const VkImageAspectFlags aspectFlags, const uint32_t mipLevels,
+	const VkComponentMapping components)
 {
 	VkImageView imageView;
 
@@ -251,6 +537,7 @@ VkImageView Djinn::VulkanEngine::createImageView(const VkImage image, const VkFo
 	viewCreateInfo.image = image;
 	viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
 	viewCreateInfo.format = format;
+	viewCreateInfo.components = components;
 	viewCreateInfo.subresourceRange.aspectMask = aspectFlags;
 	viewCreateInfo.subresourceRange.baseMipLevel = 0;
 	viewCreateInfo.subresourceRange.levelCount = mipLevels;
@@ -265,9 +552,7 @@ VkImageView Djinn::VulkanEngine::createImageView(const VkImage image, const VkFo
 
 void Djinn::VulkanEngine::createTextureImageView()
 {
-	textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, m_mipLevels);
-	mainDeletionQueue.PushFunction([=]()
-		{	vkDestroyImageView(p_context->gpuInfo.device, textureImageView, nullptr); });
+	textureImageView = createImageView(textureImage, textureFormat, VK_IMAGE_ASPECT_COLOR_BIT, m_mipLevels, textureComponents);
 }
 
 
@@ -288,237 +573,304 @@ void Djinn::VulkanEngine::createTextureSampler()
 	samplerCreateInfo.compareOp = VK_COMPARE_OP_ALWAYS;
 	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 	samplerCreateInfo.mipLodBias = 0.0f;
-	samplerCreateInfo.minLod = 0.0f;
+	samplerCreateInfo.minLod = static_cast<float>(residentMip);
 	samplerCreateInfo.maxLod = static_cast<float>(m_mipLevels);
 
+	// the previous sampler may still be bound by a frame in flight
+	if (textureSampler != VK_NULL_HANDLE)
+	{
+		retiredSamplers.push_back(textureSampler);
+	}
+
 	auto result{ vkCreateSampler(p_context->gpuInfo.device, &samplerCreateInfo, nullptr, &textureSampler) };
 	DJINN_VK_ASSERT(result);
-
-	mainDeletionQueue.PushFunction([=]()
-		{vkDestroySampler(p_context->gpuInfo.device, textureSampler, nullptr); });
-
 }
 
-
-void Djinn::VulkanEngine::createColorResources()
+// the texture is swapped while streaming, so it is destroyed here instead of through the deletion queue
+void Djinn::VulkanEngine::destroyTexture()
 {
-	const auto colorFormat = p_swapChain->swapChainImageFormat;
-
-	ImageCreateInfo createInfo{};
-	createInfo.width = p_swapChain->swapChainExtent.width;
-	createInfo.height = p_swapChain->swapChainExtent.height;
-	createInfo.mipLevels = 1;
-	createInfo.format = colorFormat;
-	createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-	createInfo.memoryFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-	createInfo.usageFlags = VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-	createInfo.aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
-	createInfo.sharingMode = p_swapChain->sharingMode;
-	createInfo.numSamples = msaaSamples;
+	vkDestroySampler(p_context->gpuInfo.device, textureSampler, nullptr);
+	for (auto sampler : retiredSamplers)
+	{
+		vkDestroySampler(p_context->gpuInfo.device, sampler, nullptr);
+	}
+	retiredSamplers.clear();
+	vkDestroyImageView(p_context->gpuInfo.device, textureImageView, nullptr);
+	vkDestroyImage(p_context->gpuInfo.device, textureImage, nullptr);
+	allocator.Free(textureImageAllocation);
 
-	colorImage.Init(p_context, createInfo);
-	swapchainDeletionQueue.PushFunction([=]()
-		{colorImage.CleanUp(p_context); });
+	textureSampler = VK_NULL_HANDLE;
+	textureImageView = VK_NULL_HANDLE;
+	textureImage = VK_NULL_HANDLE;
 
+	if (indirectionImage.image != VK_NULL_HANDLE)
+	{
+		vkDestroySampler(p_context->gpuInfo.device, indirectionSampler, nullptr);
+		indirectionImage.CleanUp(p_context);
+		indirectionSampler = VK_NULL_HANDLE;
+		indirectionImage = {};
+	}
 }
 
-VkCommandBuffer Djinn::VulkanEngine::beginSingleTimeCommands(VkCommandPool& commandPool)
+// linear filtering of R8 / RG8 is core, of their sRGB variants optional, grey textures are widened when it is missing
+std::shared_ptr<const Djinn::TextureAsset> Djinn::VulkanEngine::deviceTexture(std::shared_ptr<const TextureAsset> texture) const
 {
-	VkCommandBufferAllocateInfo allocateInfo{};
-	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocateInfo.commandPool = commandPool;
-	allocateInfo.commandBufferCount = 1;
-
-	VkCommandBuffer commandBuffer;
-	vkAllocateCommandBuffers(p_context->gpuInfo.device, &allocateInfo, &commandBuffer);
-
-	VkCommandBufferBeginInfo beginInfo{};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	if (textureChannels(texture->format) == 4 || !texture->srgb)
+	{
+		return texture;
+	}
 
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(p_context->gpuInfo.gpu, textureVkFormat(texture->format, texture->srgb), &properties);
+	const VkFormatFeatureFlags required{ VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT };
+	if ((properties.optimalTilingFeatures & required) == required)
+	{
+		return texture;
+	}
 
-	return commandBuffer;
+	spdlog::info("Device can't filter sRGB {} channel textures, expanding {} to RGBA8", textureChannels(texture->format), texture->path);
+	auto expanded{ std::make_shared<TextureAsset>() };
+	expandTextureAsset(*texture, *expanded);
+	return expanded;
 }
 
-void Djinn::VulkanEngine::endSingleTimeCommands(VkCommandPool& commandPool, VkCommandBuffer commandBuffer, VkQueue submitQueue)
+// the texture image becomes a cache of virtualCacheSlots^2 tiles in the source's format, the indirection table
+// maps every page of every level to the closest resident one, only the coarsest level is uploaded here
+void Djinn::VulkanEngine::createVirtualTexture(std::shared_ptr<const TextureAsset> source)
 {
-	vkEndCommandBuffer(commandBuffer);
+	destroyTexture();
+	virtualSource = std::move(source);
+	const uint32_t slots{ p_context->renderConfig.virtualCacheSlots };
+	virtualTexture.Init(*virtualSource, slots, slots);
+
+	m_mipLevels = 1;
+	residentMip = 0;
+	textureFormat = textureVkFormat(virtualSource->format, virtualSource->srgb);
+	textureComponents = textureComponentMapping(virtualSource->format);
+	createImage(slots * VT_TILE_SIZE, slots * VT_TILE_SIZE, 1, textureFormat, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageAllocation);
+	createTextureImageView();
+	createTextureSampler();
+
+	const MipLevel& indirectionLevel0{ virtualTexture.IndirectionLevels().front() };
+	ImageCreateInfo createInfo{};
+	createInfo.width = indirectionLevel0.width;
+	createInfo.height = indirectionLevel0.height;
+	createInfo.mipLevels = virtualTexture.LevelCount();
+	createInfo.format = VK_FORMAT_R8G8B8A8_UINT;
+	createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	createInfo.memoryFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	createInfo.usageFlags = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	createInfo.aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
+	createInfo.sharingMode = p_swapChain->sharingMode;
+	createInfo.numSamples = VK_SAMPLE_COUNT_1_BIT;
+	indirectionImage.Init(p_context, createInfo);
 
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
+	// entries are fetched, never filtered
+	VkSamplerCreateInfo samplerCreateInfo{};
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.anisotropyEnable = VK_FALSE;
+	samplerCreateInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+	samplerCreateInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+	samplerCreateInfo.maxLod = static_cast<float>(virtualTexture.LevelCount());
 
-	vkQueueSubmit(submitQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(submitQueue);
+	auto result{ vkCreateSampler(p_context->gpuInfo.device, &samplerCreateInfo, nullptr, &indirectionSampler) };
+	DJINN_VK_ASSERT(result);
 
-	vkFreeCommandBuffers(p_context->gpuInfo.device, commandPool, 1, &commandBuffer);
+	std::vector<VirtualPageUpload> uploads;
+	virtualTexture.UpdatePages(UINT32_MAX, frameCount, uploads);
+	uploadVirtualPages(uploads, true);
 }
 
-// transition image layout by inserting image memory barrier to commandBuffer
-void Djinn::VulkanEngine::transitionImageLayout(const VkImage image, const VkFormat format, const VkImageLayout oldLayout,
-	const VkImageLayout newLayout, const uint32_t mipLevels)
+// the tiles and the whole indirection table go up through one staging range in the open upload batch
+// the first upload moves both images out of UNDEFINED, slots that weren't written yet are never addressed
+void Djinn::VulkanEngine::uploadVirtualPages(std::span<const VirtualPageUpload> uploads, const bool firstUpload)
 {
-	VkCommandBuffer commandBuffer{ beginSingleTimeCommands(p_context->transferCommandPool) };
-
-	VkImageMemoryBarrier barrier{};
-	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	barrier.oldLayout = oldLayout;
-	barrier.newLayout = newLayout;
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.image = image;
-	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	barrier.subresourceRange.baseMipLevel = 0;
-	barrier.subresourceRange.levelCount = mipLevels;
-	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = 1;
-	barrier.srcAccessMask = 0; // TODO
-	barrier.dstAccessMask = 0; // TODO
+	const TextureAsset& source{ virtualTexture.Source() };
+	const VkDeviceSize tileSize{ virtualTileSize(source.format) };
+	const std::span<const uint32_t> indirection{ virtualTexture.Indirection() };
+	const std::span<const MipLevel> indirectionLevels{ virtualTexture.IndirectionLevels() };
+	const VkDeviceSize indirectionBase{ tileSize * uploads.size() };
+	const VkDeviceSize uploadSize{ indirectionBase + indirection.size_bytes() };
+
+	const StagingRange staging{ uploadContext.Stage(uploadSize) };
+	for (size_t i = 0; i < uploads.size(); ++i)
+	{
+		extractVirtualTile(source, uploads[i].page, { staging.data + i * tileSize, static_cast<size_t>(tileSize) });
+	}
+	memcpy(staging.data + indirectionBase, indirection.data(), indirection.size_bytes());
 
-	VkPipelineStageFlags srcFlags;
-	VkPipelineStageFlags dstFlags;
+	VkCommandBuffer commandBuffer{ uploadContext.Commands() };
 
-	if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+	std::array<VkImageMemoryBarrier, 2> barriers{};
+	for (auto& barrier : barriers)
 	{
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = firstUpload ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
 		barrier.srcAccessMask = 0;
 		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-		srcFlags = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		dstFlags = VK_PIPELINE_STAGE_TRANSFER_BIT;
 	}
-	else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+	barriers[0].image = textureImage;
+	barriers[0].subresourceRange.levelCount = 1;
+	barriers[1].image = indirectionImage.image;
+	barriers[1].subresourceRange.levelCount = virtualTexture.LevelCount();
+
+	// frames in flight may still sample the slots being replaced
+	vkCmdPipelineBarrier(commandBuffer, firstUpload ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+	if (!uploads.empty())
 	{
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		std::vector<VkBufferImageCopy> regions(uploads.size());
+		for (size_t i = 0; i < uploads.size(); ++i)
+		{
+			const uint32_t slotX{ uploads[i].slot % virtualTexture.SlotsX() };
+			const uint32_t slotY{ uploads[i].slot / virtualTexture.SlotsX() };
+
+			regions[i].bufferOffset = staging.offset + i * tileSize;
+			regions[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			regions[i].imageSubresource.mipLevel = 0;
+			regions[i].imageSubresource.baseArrayLayer = 0;
+			regions[i].imageSubresource.layerCount = 1;
+			regions[i].imageOffset = { static_cast<int32_t>(slotX * VT_TILE_SIZE), static_cast<int32_t>(slotY * VT_TILE_SIZE), 0 };
+			regions[i].imageExtent = { VT_TILE_SIZE, VT_TILE_SIZE, 1 };
+		}
 
-		srcFlags = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		dstFlags = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		vkCmdCopyBufferToImage(commandBuffer, staging.buffer, textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(regions.size()), regions.data());
 	}
-	else
+
+	std::vector<VkBufferImageCopy> indirectionRegions(indirectionLevels.size());
+	for (size_t i = 0; i < indirectionLevels.size(); ++i)
 	{
-		throw std::runtime_error("Unsupported layout transition!");
+		indirectionRegions[i].bufferOffset = staging.offset + indirectionBase + indirectionLevels[i].offset;
+		indirectionRegions[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		indirectionRegions[i].imageSubresource.mipLevel = static_cast<uint32_t>(i);
+		indirectionRegions[i].imageSubresource.baseArrayLayer = 0;
+		indirectionRegions[i].imageSubresource.layerCount = 1;
+		indirectionRegions[i].imageOffset = { 0, 0, 0 };
+		indirectionRegions[i].imageExtent = { indirectionLevels[i].width, indirectionLevels[i].height, 1 };
 	}
 
-	vkCmdPipelineBarrier(commandBuffer, srcFlags, dstFlags, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	vkCmdCopyBufferToImage(commandBuffer, staging.buffer, indirectionImage.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		static_cast<uint32_t>(indirectionRegions.size()), indirectionRegions.data());
 
-	endSingleTimeCommands(p_context->transferCommandPool, commandBuffer, p_context->transferQueue);
-}
+	for (auto& barrier : barriers)
+	{
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	}
 
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+}
 
-void Djinn::VulkanEngine::copyBufferToImage(VkBuffer buffer, VkImage image, const uint32_t width, const uint32_t height)
+// runs once the image's fence has signaled, its readback buffer holds the pages the last frame drawn to it wanted
+// pages that miss the cache are uploaded before this frame records, the rest of the request waits for the next readback
+void Djinn::VulkanEngine::updateVirtualTexture(const uint32_t imageIndex)
 {
-	VkCommandBuffer commandBuffer{ beginSingleTimeCommands(p_context->transferCommandPool) };
+	if (feedbackReady[imageIndex])
+	{
+		const Djinn::Buffer& readback{ feedbackBuffers[imageIndex] };
+		readback.Invalidate(p_context, 0, readback.size);
+		const uint32_t* data{ reinterpret_cast<const uint32_t*>(readback.allocation.data) };
+		virtualTexture.ProcessFeedback({ data, static_cast<size_t>(readback.size / sizeof(uint32_t)) }, frameCount);
+	}
 
-	// copy the whole thing [0, 0, 0] -> [width, height, 1]
-	VkBufferImageCopy region{};
-	region.bufferOffset = 0;
-	region.bufferRowLength = 0;
-	region.bufferImageHeight = 0;
+	std::vector<VirtualPageUpload> uploads;
+	if (virtualTexture.UpdatePages(p_context->renderConfig.virtualPageBudget, frameCount, uploads))
+	{
+		uploadVirtualPages(uploads, false);
+	}
+}
 
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.mipLevel = 0;
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = 1;
 
-	region.imageOffset = { 0, 0, 0 };
-	region.imageExtent = { width, height, 1 };
+void Djinn::VulkanEngine::createColorResources()
+{
+	const auto colorFormat = p_swapChain->swapChainImageFormat;
+
+	ImageCreateInfo createInfo{};
+	createInfo.width = p_swapChain->swapChainExtent.width;
+	createInfo.height = p_swapChain->swapChainExtent.height;
+	createInfo.mipLevels = 1;
+	createInfo.format = colorFormat;
+	createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	createInfo.memoryFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	createInfo.usageFlags = VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	createInfo.aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT;
+	createInfo.sharingMode = p_swapChain->sharingMode;
+	createInfo.numSamples = msaaSamples;
 
-	// currently assumes layout has been transistioned to this state
-	vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+	colorImage.Init(p_context, createInfo);
+	swapchainDeletionQueue.PushFunction([=]()
+		{colorImage.CleanUp(p_context); });
 
-	endSingleTimeCommands(p_context->transferCommandPool, commandBuffer, p_context->transferQueue);
 }
 
-
-void Djinn::VulkanEngine::generateMipMaps(VkImage image, const VkFormat format, const uint32_t texWidth, const uint32_t texHeight, const uint32_t mipLevels)
+// transition to transfer dst -> copy every level -> transition to shader read only, recorded into the open upload batch
+// which goes to the graphics queue since the transfer queue can't wait on the fragment shader stage
+// levels are copied into the image from firstLevel on, their offsets are relative to bufferBase at the start of the staging range
+// the first upload moves every level of the image out of UNDEFINED, so the levels not copied yet are in a valid
+// layout for the sampler to skip over, later uploads only transition the levels they write
+void Djinn::VulkanEngine::copyBufferToImage(const StagingRange& staging, VkImage image, std::span<const MipLevel> levels, const uint64_t bufferBase,
+	const uint32_t firstLevel, const bool firstUpload)
 {
-	// check if image formats support linear blitting
-	VkFormatProperties formatProperties;
-	vkGetPhysicalDeviceFormatProperties(p_context->gpuInfo.gpu, format, &formatProperties);
-
-	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
-	{
-		throw std::runtime_error("texture image format does not support linear blitting!");
-	}
-
-	VkCommandPool commandPool = p_context->graphicsCommandPool;
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands(commandPool);
+	VkCommandBuffer commandBuffer{ uploadContext.Commands() };
 
 	VkImageMemoryBarrier barrier{};
 	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	barrier.image = image;
+	barrier.oldLayout = firstUpload ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
 	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
 	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = firstUpload ? 0 : firstLevel;
+	barrier.subresourceRange.levelCount = firstUpload ? m_mipLevels : static_cast<uint32_t>(levels.size());
 	barrier.subresourceRange.baseArrayLayer = 0;
 	barrier.subresourceRange.layerCount = 1;
-	barrier.subresourceRange.levelCount = 1;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
 
-	auto mipWidth = static_cast<int32_t>(texWidth);
-	auto mipHeight = static_cast<int32_t>(texHeight);
+	// earlier frames never sample these levels, but their layout changes under them
+	vkCmdPipelineBarrier(commandBuffer, firstUpload ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 
-	for (uint32_t i = 1; i < m_mipLevels; ++i)
+	std::vector<VkBufferImageCopy> regions(levels.size());
+	for (size_t i = 0; i < levels.size(); ++i)
 	{
-		const int32_t currentMipLevel = i - 1;
-		const int32_t nextMiplevel = i;
-		barrier.subresourceRange.baseMipLevel = currentMipLevel;
-		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-		// we are actually specifying how the mip is downsampled
-		// we are a
-		VkImageBlit blit{};
-		blit.srcOffsets[0] = { 0, 0, 0 };
-		blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
-
-		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		blit.srcSubresource.mipLevel = currentMipLevel;
-		blit.srcSubresource.baseArrayLayer = 0;
-		blit.srcSubresource.layerCount = 1;
-
-		blit.dstOffsets[0] = { 0, 0, 0 };
-		blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1,
-			mipHeight > 1 ? mipHeight / 2 : 1,
-			1 };
-
-		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		blit.dstSubresource.mipLevel = nextMiplevel;
-		blit.dstSubresource.baseArrayLayer = 0;
-		blit.dstSubresource.layerCount = 1;
-
-		vkCmdBlitImage(commandBuffer,
-			image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			1, &blit, VK_FILTER_LINEAR);
-
-		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		regions[i].bufferOffset = staging.offset + levels[i].offset - bufferBase;
+		regions[i].bufferRowLength = 0;
+		regions[i].bufferImageHeight = 0;
 
-		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		regions[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		regions[i].imageSubresource.mipLevel = firstLevel + static_cast<uint32_t>(i);
+		regions[i].imageSubresource.baseArrayLayer = 0;
+		regions[i].imageSubresource.layerCount = 1;
 
-		if (mipWidth > 1)
-		{
-			mipWidth /= 2;
-		}
-		if (mipHeight > 1)
-		{
-			mipHeight /= 2;
-		}
+		regions[i].imageOffset = { 0, 0, 0 };
+		regions[i].imageExtent = { levels[i].width, levels[i].height, 1 };
 	}
 
-	// handle last barrier
-	barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+	vkCmdCopyBufferToImage(commandBuffer, staging.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		static_cast<uint32_t>(regions.size()), regions.data());
+
 	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
 	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
@@ -526,14 +878,12 @@ void Djinn::VulkanEngine::generateMipMaps(VkImage image, const VkFormat format,
 
 	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
 		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-	endSingleTimeCommands(commandPool, commandBuffer, p_context->graphicsQueue);
-
 }
 
+
 void Djinn::VulkanEngine::createImage(const uint32_t width, const uint32_t height, const uint32_t mipLevels, const VkFormat format,
 	const VkSampleCountFlagBits numSamples, const VkImageTiling tiling, const VkImageUsageFlags flags,
-	const VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory)
+	const VkMemoryPropertyFlags properties, VkImage& image, VulkanAllocation_t& allocation)
 {
 	VkImageCreateInfo imageCreateInfo{};
 	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -554,72 +904,127 @@ void Djinn::VulkanEngine::createImage(const uint32_t width, const uint32_t heigh
 	auto result{ vkCreateImage(p_context->gpuInfo.device, &imageCreateInfo, nullptr, &image) };
 	DJINN_VK_ASSERT(result);
 
-	VkMemoryRequirements memRequirements;
-	vkGetImageMemoryRequirements(p_context->gpuInfo.device, image, &memRequirements);
-
-	VkMemoryAllocateInfo allocateInfo{};
-	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocateInfo.allocationSize = memRequirements.size;
-	allocateInfo.memoryTypeIndex = findMemoryType(p_context, memRequirements.memoryTypeBits, properties);
-
-	result = vkAllocateMemory(p_context->gpuInfo.device, &allocateInfo, nullptr, &imageMemory);
-	DJINN_VK_ASSERT(result);
-
-	result = vkBindImageMemory(p_context->gpuInfo.device, image, imageMemory, 0);
-	DJINN_VK_ASSERT(result);
+	allocateImageMemory(p_context, image, tiling, properties, allocation);
 }
 
 
-void Djinn::VulkanEngine::loadModel(const std::string& path)
+void Djinn::VulkanEngine::requestAssets()
 {
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-
-	std::string err;
-	//const char* path = MODEL_PATH.c_str();
+	const VertexFormat requestedFormat{ p_context->renderConfig.compactVertices ?
+		VertexFormat::VERTEX_FORMAT_COMPACT : VertexFormat::VERTEX_FORMAT_FULL };
 
-	const auto ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, path.c_str());
+	assetStreamer.Init();
+	mainDeletionQueue.PushFunction([=]()
+		{assetStreamer.CleanUp(); });
+	TextureFormat textureRequest{ p_context->renderConfig.textureFormat };
+	if (textureRequest != TextureFormat::TEXTURE_FORMAT_RGBA8 && !p_context->gpuInfo.textureCompressionBC)
+	{
+		spdlog::warn("Device does not support BC textures, falling back to RGBA8");
+		textureRequest = TextureFormat::TEXTURE_FORMAT_RGBA8;
+	}
 
-	if (!err.empty())
+	if (!assetStreamer.OpenPack(PACK_PATH))
 	{
-		spdlog::error(err);
+		spdlog::info("No asset pack at {}, loading loose files", PACK_PATH);
 	}
 
-	assert(ret);
+	const bool splitPositions{ p_context->renderConfig.splitPositions };
+	assetStreamer.RequestMesh(MODEL_PATH, requestedFormat, splitPositions);
+	assetStreamer.RequestTexture(TEXTURE_PATH, textureRequest);
 
-	std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+	// rendering starts right away with the placeholders, uploadStreamedAssets swaps the real ones in
+	auto placeholderMesh{ std::make_shared<MeshAsset>() };
+	buildPlaceholderMesh(requestedFormat, splitPositions, *placeholderMesh);
+	mesh = std::move(placeholderMesh);
+}
 
-	for (const auto& shape : shapes)
+// upload stage of the streamer, runs at the start of a frame and swaps in at most one decoded asset
+// swaps happen once per asset, so waiting for the device is simpler than deferring the old resources
+void Djinn::VulkanEngine::uploadStreamedAssets()
+{
+	if (auto texture{ assetStreamer.PopTexture() })
 	{
-		for (const auto& index : shape.mesh.indices)
+		if (texture->contentKey == residentTextureKey)
 		{
-			Vertex vertex{};
+			// another request for what is already bound, the images stay as they are
+			spdlog::info("{} is already resident", texture->path);
+			return;
+		}
 
-			vertex.position =
+		vkDeviceWaitIdle(p_context->gpuInfo.device);
+		residentTextureKey = texture->contentKey;
+		texture = deviceTexture(std::move(texture));
+		if (p_context->renderConfig.virtualTexturing)
+		{
+			// pages stream from the mapped mips for as long as the texture is in use, there is no mip streaming
+			createVirtualTexture(std::move(texture));
+			spdlog::info("Streamed in {} ({}x{}, {} virtual levels, {}x{} page cache)", virtualSource->path, virtualSource->width,
+				virtualSource->height, virtualTexture.LevelCount(), virtualTexture.SlotsX(), virtualTexture.SlotsY());
+			for (uint32_t i = 0; i < static_cast<uint32_t>(descriptorSets.size()); ++i)
 			{
-				attrib.vertices[3 * index.vertex_index + 0],
-				attrib.vertices[3 * index.vertex_index + 1],
-				attrib.vertices[3 * index.vertex_index + 2]
-			};
+				updateTextureDescriptors(i);
+			}
+			std::fill(recordedLods.begin(), recordedLods.end(), UINT32_MAX);
+			return;
+		}
 
-			vertex.texCoord =
-			{
-				attrib.texcoords[2 * index.texcoord_index + 0],
-				1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-			};
+		destroyTexture();
+		createTextureImage(*texture);
+		createTextureImageView();
+		createTextureSampler();
+		for (uint32_t i = 0; i < static_cast<uint32_t>(descriptorSets.size()); ++i)
+		{
+			updateTextureDescriptors(i);
+		}
 
-			vertex.color = { 1.0f, 1.0f, 1.0f };
-			vertex.normal = { 1.0f, 1.0f, 1.0f };
+		// updating a bound descriptor set invalidates the command buffers, force a re-record
+		std::fill(recordedLods.begin(), recordedLods.end(), UINT32_MAX);
+		spdlog::info("Streamed in {} ({}x{}, {} mips, {} resident)", texture->path, texture->width, texture->height,
+			texture->levels.size(), texture->levels.size() - residentMip);
 
-			if (uniqueVertices.count(vertex) == 0)
-			{
-				uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-				vertices.push_back(vertex);
-			}
+		streamingTexture.reset();
+		if (residentMip > 0)
+		{
+			streamingTexture = std::move(texture);
+		}
+		return;
+	}
 
-			vertexIndices.push_back(uniqueVertices[vertex]);
+	if (streamingTexture)
+	{
+		streamTextureMips();
+	}
+
+	if (auto streamedMesh{ assetStreamer.PopMesh() })
+	{
+		if (streamedMesh->contentKey == mesh->contentKey)
+		{
+			spdlog::info("{} is already resident", streamedMesh->path);
+			return;
+		}
+
+		vkDeviceWaitIdle(p_context->gpuInfo.device);
+		destroyMeshBuffers();
+
+		const bool formatChanged{ streamedMesh->streams.vertexFormat != mesh->streams.vertexFormat ||
+			streamedMesh->streams.splitPositions() != mesh->streams.splitPositions() };
+		mesh = std::move(streamedMesh);
+		selectedLod = 0;
+		visibleSubmeshes.clear();
+		createVertexBufferStaged();
+		createIndexBufferStaged();
+		createMeshletBuffers();
+
+		if (formatChanged)
+		{
+			// the pipelines' vertex input follows the mesh layout
+			recreateSwapChain();
+		}
+		else
+		{
+			std::fill(recordedLods.begin(), recordedLods.end(), UINT32_MAX);
 		}
+		spdlog::info("Streamed in {}", mesh->path);
 	}
 }
 
@@ -628,7 +1033,7 @@ void Djinn::VulkanEngine::createDescriptorSetLayout()
 {
 	VkDescriptorSetLayoutBinding uboLayoutBinding{};
 	uboLayoutBinding.binding = 0;
-	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	uboLayoutBinding.descriptorCount = 1;
 	uboLayoutBinding.pImmutableSamplers = nullptr; // opt
 	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
@@ -640,11 +1045,21 @@ void Djinn::VulkanEngine::createDescriptorSetLayout()
 	samplerLayourBinding.pImmutableSamplers = nullptr;
 	samplerLayourBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-	Djinn::Array1D<VkDescriptorSetLayoutBinding, 2> bindings{ uboLayoutBinding, samplerLayourBinding };
+	// virtual texturing reads the texture size from the UBO in the fragment stage and adds the indirection table
+	VkDescriptorSetLayoutBinding indirectionLayoutBinding{ samplerLayourBinding };
+	indirectionLayoutBinding.binding = 2;
+
+	const bool virtualTexturing{ p_context->renderConfig.virtualTexturing };
+	if (virtualTexturing)
+	{
+		uboLayoutBinding.stageFlags |= VK_SHADER_STAGE_FRAGMENT_BIT;
+	}
+
+	Djinn::Array1D<VkDescriptorSetLayoutBinding, 3> bindings{ uboLayoutBinding, samplerLayourBinding, indirectionLayoutBinding };
 
 	VkDescriptorSetLayoutCreateInfo layoutCreateInfo{};
 	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.NumElem());
+	layoutCreateInfo.bindingCount = virtualTexturing ? 3 : 2;
 	layoutCreateInfo.pBindings = bindings.Ptr();
 
 	auto result{ (vkCreateDescriptorSetLayout(p_context->gpuInfo.device, &layoutCreateInfo, nullptr, &descriptorSetLayout)) };
@@ -658,101 +1073,70 @@ void Djinn::VulkanEngine::createDescriptorSetLayout()
 
 void Djinn::VulkanEngine::createVertexBufferStaged()
 {
-	const VkDeviceSize bufferSize{ sizeof(vertices[0]) * vertices.size() };
-
-	BufferCreateInfo bufferCreateInfo{};
-	bufferCreateInfo.size = bufferSize;
-	bufferCreateInfo.offset = 0;
-	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-	bufferCreateInfo.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-	bufferCreateInfo.sharingMode = p_swapChain->sharingMode;
-
-	Buffer _stagingBuffer;
-	_stagingBuffer.Init(p_context, bufferCreateInfo);
-
-	bufferCreateInfo.size = bufferSize;
-	bufferCreateInfo.offset = 0;
-	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-	bufferCreateInfo.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-	bufferCreateInfo.sharingMode = p_swapChain->sharingMode;
-	_vertexBuffer.Init(p_context, bufferCreateInfo);
-
-	copyDataToMappedBuffer(p_context, _stagingBuffer, bufferSize, 0, vertices.data());
-	copyBuffer(p_context, _stagingBuffer, _vertexBuffer, bufferSize);
-
-	_stagingBuffer.CleanUp(p_context);
-
-	mainDeletionQueue.PushFunction([=]()
-		{_vertexBuffer.CleanUp(p_context);});
+	uploadDeviceLocal(p_context, _vertexBuffer, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, p_swapChain->sharingMode, mesh->streams.vertexBytes);
+	if (mesh->streams.splitPositions())
+	{
+		uploadDeviceLocal(p_context, _positionBuffer, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, p_swapChain->sharingMode, mesh->streams.positionBytes);
+	}
 }
 
 
 
 void Djinn::VulkanEngine::createIndexBufferStaged()
 {
-	const VkDeviceSize bufferSize{ sizeof(vertexIndices[0]) * vertexIndices.size() };
-
-	BufferCreateInfo bufferCreateInfo{};
-	bufferCreateInfo.size = bufferSize;
-	bufferCreateInfo.offset = 0;
-	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-	bufferCreateInfo.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-	bufferCreateInfo.sharingMode = p_swapChain->sharingMode;
-
-	Buffer _stagingBuffer;
-	_stagingBuffer.Init(p_context, bufferCreateInfo);
-
-	bufferCreateInfo.size = bufferSize;
-	bufferCreateInfo.offset = 0;
-	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-	bufferCreateInfo.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-	bufferCreateInfo.sharingMode = p_swapChain->sharingMode;
-	_indexBuffer.Init(p_context, bufferCreateInfo);
-
-	copyDataToMappedBuffer(p_context, _stagingBuffer, bufferSize, 0, vertexIndices.data());
-	copyBuffer(p_context, _stagingBuffer, _indexBuffer, bufferSize);
-
-	_stagingBuffer.CleanUp(p_context);
-
-	mainDeletionQueue.PushFunction([=]()
-		{_indexBuffer.CleanUp(p_context); });
+	uploadDeviceLocal(p_context, _indexBuffer, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, p_swapChain->sharingMode, mesh->streams.indexBytes);
 }
 
-void Djinn::VulkanEngine::createUniformBuffers()
+// nothing draws per meshlet yet, these are storage buffers for a culling pass to read
+void Djinn::VulkanEngine::createMeshletBuffers()
 {
-	constexpr VkDeviceSize bufferSize{ sizeof(UniformBufferObject) };
-	const size_t swapchainSize{ p_swapChain->swapChainImages.size() };
-
+	if (mesh->meshlets.empty())
+	{
+		return;
+	}
 
-	_uniformBuffers.resize(swapchainSize);
-	//uniformBuffersMemory.resize(swapchainSize);
+	const auto upload = [&](Buffer& buffer, std::span<const std::byte> bytes)
+	{
+		uploadDeviceLocal(p_context, buffer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, p_swapChain->sharingMode, bytes);
+	};
 
-	BufferCreateInfo bufferCreateInfo{};
-	bufferCreateInfo.size = bufferSize;
-	bufferCreateInfo.offset = 0;
-	bufferCreateInfo.sharingMode = p_swapChain->sharingMode;
-	bufferCreateInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-	bufferCreateInfo.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	upload(_meshletBuffer, std::as_bytes(mesh->meshlets.meshlets));
+	upload(_meshletVertexBuffer, std::as_bytes(mesh->meshlets.vertices));
+	upload(_meshletTriangleBuffer, std::as_bytes(mesh->meshlets.triangles));
+	upload(_meshletBoundsBuffer, std::as_bytes(mesh->meshlets.bounds));
+}
 
-	for (auto& buffer : _uniformBuffers)
+// mesh buffers are swapped while streaming, null handles are skipped by the destroy calls
+void Djinn::VulkanEngine::destroyMeshBuffers()
+{
+	for (auto* p_buffer : { &_vertexBuffer, &_positionBuffer, &_indexBuffer, &_meshletBuffer, &_meshletVertexBuffer,
+		&_meshletTriangleBuffer, &_meshletBoundsBuffer })
 	{
-		buffer.Init(p_context, bufferCreateInfo);
+		p_buffer->CleanUp(p_context);
+		*p_buffer = {};
 	}
+}
 
-	for (auto& buffer : _uniformBuffers)
-	{
-		mainDeletionQueue.PushFunction([&]()
-			{buffer.CleanUp(p_context); });
-	}
+void Djinn::VulkanEngine::createUniformBuffers()
+{
+	// refilled every frame, drawFrame starts an image's region over once the image's fence has signaled
+	const uint32_t swapchainSize{ static_cast<uint32_t>(p_swapChain->swapChainImages.size()) };
+	_frameRing.Init(p_context, std::max<VkDeviceSize>(p_context->renderConfig.frameDataSize, sizeof(UniformBufferObject)), swapchainSize,
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, p_swapChain->sharingMode);
+	uniformOffsets.assign(swapchainSize, 0);
+
+	mainDeletionQueue.PushFunction([=]()
+		{_frameRing.CleanUp(p_context); });
 }
 
 void Djinn::VulkanEngine::createDescriptorPool()
 {
 	Array1D<VkDescriptorPoolSize, 2> poolSizes;
-	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	poolSizes[0].descriptorCount = static_cast<uint32_t>(p_swapChain->swapChainImages.size());
 	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes[1].descriptorCount = static_cast<uint32_t>(p_swapChain->swapChainImages.size());
+	poolSizes[1].descriptorCount = static_cast<uint32_t>(p_swapChain->swapChainImages.size()) *
+		(p_context->renderConfig.virtualTexturing ? 2 : 1);
 
 	VkDescriptorPoolCreateInfo poolCreateInfo{};
 	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -780,46 +1164,59 @@ void Djinn::VulkanEngine::createDescriptorSets()
 	auto result{ (vkAllocateDescriptorSets(p_context->gpuInfo.device, &allocInfo, descriptorSets.data())) };
 	DJINN_VK_ASSERT(result);
 
+	boundTextureMips.resize(descriptorSets.size());
 	for (size_t i = 0; i < p_swapChain->swapChainImages.size(); ++i)
 	{
 		VkDescriptorBufferInfo bufferInfo{};
-		bufferInfo.buffer = _uniformBuffers[i].buffer;
+		bufferInfo.buffer = _frameRing.buffer.buffer;
 		bufferInfo.offset = 0;
 		bufferInfo.range = sizeof(UniformBufferObject);
 
-		VkDescriptorImageInfo imageInfo{};
-		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		imageInfo.imageView = textureImageView;
-		imageInfo.sampler = textureSampler;
-
-		std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
-		//Djinn::Array1D<VkWriteDescriptorSet, 2> descriptorWrites;
-		//VkWriteDescriptorSet descriptorWrites[2];
-
-		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[0].dstSet = descriptorSets[i];
-		descriptorWrites[0].dstBinding = 0;
-		descriptorWrites[0].dstArrayElement = 0;
-		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorWrites[0].descriptorCount = 1;
-		descriptorWrites[0].pBufferInfo = &bufferInfo;
-		descriptorWrites[0].pImageInfo = nullptr; // opt
-		descriptorWrites[0].pTexelBufferView = nullptr; // opt
-
-		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[1].dstSet = descriptorSets[i];
-		descriptorWrites[1].dstBinding = 1;
-		descriptorWrites[1].dstArrayElement = 0;
-		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		descriptorWrites[1].descriptorCount = 1;
-		descriptorWrites[1].pBufferInfo = nullptr; //opt
-		descriptorWrites[1].pImageInfo = &imageInfo;
-		descriptorWrites[1].pTexelBufferView = nullptr; // opt
-
-		vkUpdateDescriptorSets(p_context->gpuInfo.device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+		VkWriteDescriptorSet descriptorWrite{};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = descriptorSets[i];
+		descriptorWrite.dstBinding = 0;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pBufferInfo = &bufferInfo;
+		descriptorWrite.pImageInfo = nullptr; // opt
+		descriptorWrite.pTexelBufferView = nullptr; // opt
+
+		vkUpdateDescriptorSets(p_context->gpuInfo.device, 1, &descriptorWrite, 0, nullptr);
+		updateTextureDescriptors(static_cast<uint32_t>(i));
 	}
 }
 
+// points the sampler bindings of a set at the current texture and sampler, the set must not be in use
+// with virtual texturing the texture is the page cache and binding 2 is the indirection table
+void Djinn::VulkanEngine::updateTextureDescriptors(const uint32_t imageIndex)
+{
+	std::array<VkDescriptorImageInfo, 2> imageInfos{};
+	imageInfos[0].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfos[0].imageView = textureImageView;
+	imageInfos[0].sampler = textureSampler;
+	imageInfos[1].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfos[1].imageView = indirectionImage.imageView;
+	imageInfos[1].sampler = indirectionSampler;
+
+	std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+	for (uint32_t i = 0; i < static_cast<uint32_t>(descriptorWrites.size()); ++i)
+	{
+		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet = descriptorSets[imageIndex];
+		descriptorWrites[i].dstBinding = 1 + i;
+		descriptorWrites[i].dstArrayElement = 0;
+		descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[i].descriptorCount = 1;
+		descriptorWrites[i].pImageInfo = &imageInfos[i];
+	}
+
+	const uint32_t writeCount{ p_context->renderConfig.virtualTexturing ? 2u : 1u };
+	vkUpdateDescriptorSets(p_context->gpuInfo.device, writeCount, descriptorWrites.data(), 0, nullptr);
+	boundTextureMips[imageIndex] = residentMip;
+}
+
 void Djinn::VulkanEngine::updateUniformBuffer(const uint32_t imageIndex)
 {
 	static auto startTime{ std::chrono::high_resolution_clock::now() };
@@ -828,57 +1225,43 @@ void Djinn::VulkanEngine::updateUniformBuffer(const uint32_t imageIndex)
 	const float elapsedTime{ std::chrono::duration<float, std::chrono::seconds::period>
 														(currentTime - startTime).count() };
 
+	const glm::mat4 model{ glm::rotate(glm::mat4(1.0f), elapsedTime * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)) };
+
 	UniformBufferObject ubo{};
-	ubo.model = glm::rotate(glm::mat4(1.0f), elapsedTime * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	ubo.model = model * mesh->dequantize;
 	ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
 	ubo.projection = glm::perspective(glm::radians(45.0f), (static_cast<float>(p_swapChain->swapChainExtent.width) / static_cast<float>(p_swapChain->swapChainExtent.height)), 0.1f, 10.0f);
-	ubo.projection[1][1] *= -1.0f;
-
-	copyDataToMappedBuffer(p_context, _uniformBuffers[imageIndex], sizeof(ubo), 0, &ubo);
-}
 
+	// LOD errors are in mesh units, project them at the distance of the nearest point of the bounds
+	const glm::vec3 center{ (mesh->streams.bounds.min + mesh->streams.bounds.max) * 0.5f };
+	const float radius{ glm::length(mesh->streams.bounds.max - mesh->streams.bounds.min) * 0.5f };
+	const float distance{ -(ubo.view * model * glm::vec4(center, 1.0f)).z - radius };
+	const float pixelsPerUnit{ static_cast<float>(p_swapChain->swapChainExtent.height) * 0.5f * ubo.projection[1][1] };
+	selectedLod = selectLod(mesh->lods, distance, pixelsPerUnit, p_context->renderConfig.lodPixelError);
+
+	// submesh bounds are in mesh space, the same space model takes to the world
+	const glm::mat4 modelViewProjection{ ubo.projection * ubo.view * model };
+	visibleSubmeshes.resize(mesh->submeshes.size());
+	for (size_t i = 0; i < mesh->submeshes.size(); ++i)
+	{
+		visibleSubmeshes[i] = boundsInFrustum(mesh->submeshes[i].bounds, modelViewProjection) ? 1 : 0;
+	}
 
-void Djinn::VulkanEngine::createBuffer(const VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
-	VkBuffer& buffer, VkDeviceMemory& bufferMemory, const VkDeviceSize offset)
-{
-	//QueueFamilyIndices queueFamilyIndices{ findQueueFamilies(p_context->physicalDevice, p_context->surface) };
-	Array1D<uint32_t, 2> queueFamilies{ p_context->queueFamilyIndices.graphicsFamily.value(), p_context->queueFamilyIndices.transferFamily.value() };
-
-	VkBufferCreateInfo bufferCreateInfo{};
-	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	bufferCreateInfo.size = size;
-	bufferCreateInfo.usage = usage;
-	// currently always want concurrent usage because we want graphics, transfer queues to have access
-	bufferCreateInfo.sharingMode = p_swapChain->sharingMode;
-	bufferCreateInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.NumElem());
-	bufferCreateInfo.pQueueFamilyIndices = queueFamilies.Ptr();
-
-	auto result{ vkCreateBuffer(p_context->gpuInfo.device, &bufferCreateInfo, nullptr, &buffer) };
-	DJINN_VK_ASSERT(result);
+	ubo.projection[1][1] *= -1.0f;
 
-	VkMemoryRequirements memRequirements;
-	vkGetBufferMemoryRequirements(p_context->gpuInfo.device, buffer, &memRequirements);
+	if (p_context->renderConfig.virtualTexturing)
+	{
+		ubo.virtualTexture = glm::vec4(static_cast<float>(virtualTexture.Width()), static_cast<float>(virtualTexture.Height()),
+			static_cast<float>(virtualTexture.LevelCount()), 0.0f);
+	}
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = findMemoryType(p_context, memRequirements.memoryTypeBits, properties);
+	uniformOffsets[imageIndex] = _frameRing.Push(ubo);
+}
 
-	// TODO : make custom allocator that manages this memory and passes offsets
-	result = vkAllocateMemory(p_context->gpuInfo.device, &allocInfo, nullptr, &bufferMemory);
-	DJINN_VK_ASSERT(result);
 
-	result = vkBindBufferMemory(p_context->gpuInfo.device, buffer, bufferMemory, offset);
-	DJINN_VK_ASSERT(result);
-}
 
 void Djinn::VulkanEngine::createCommandBuffers()
 {
-	// create clear values
-	Array1D<VkClearValue, 2> clearValues{};
-	clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-	clearValues[1].depthStencil = { 1.0f, 0 };
-
 	commandBuffers.resize(p_swapChain->swapChainFramebuffers.size());
 
 	VkCommandBufferAllocateInfo allocInfo{};
@@ -890,50 +1273,160 @@ void Djinn::VulkanEngine::createCommandBuffers()
 	auto result{ vkAllocateCommandBuffers(p_context->gpuInfo.device, &allocInfo, commandBuffers.data()) };
 	DJINN_VK_ASSERT(result);
 
-	// begin command buffer recording
+	recordedLods.resize(commandBuffers.size());
+	recordedVisibility.resize(commandBuffers.size());
+	recordedUniformOffsets.resize(commandBuffers.size());
 	for (size_t i = 0; i < commandBuffers.size(); ++i)
 	{
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = 0;		// Optional
-		beginInfo.pInheritanceInfo = nullptr;  // Optional (use when using secondary command buffers)
+		recordCommandBuffer(i);
+	}
 
-		// BEGIN 
-		// RECORD COMMANDS
-		// END
+	swapchainDeletionQueue.PushFunction([=]()
+		{vkFreeCommandBuffers(p_context->gpuInfo.device, p_context->graphicsCommandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data()); });
+}
 
-		result = vkBeginCommandBuffer(commandBuffers[i], &beginInfo);
-		DJINN_VK_ASSERT(result);
+// the graphics pool allows resetting single buffers, vkBeginCommandBuffer resets implicitly
+void Djinn::VulkanEngine::recordCommandBuffer(const size_t imageIndex)
+{
+	// create clear values
+	Array1D<VkClearValue, 2> clearValues{};
+	clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
+	clearValues[1].depthStencil = { 1.0f, 0 };
 
-		VkRenderPassBeginInfo renderPassInfo{};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = renderPass.handle;
-		renderPassInfo.framebuffer = p_swapChain->swapChainFramebuffers[i];
-		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = p_swapChain->swapChainExtent;
+	const auto commandBuffer{ commandBuffers[imageIndex] };
+	recordedLods[imageIndex] = selectedLod;
+	recordedVisibility[imageIndex] = visibleSubmeshes;
+	const uint32_t uniformOffset{ uniformOffsets[imageIndex] };
+	recordedUniformOffsets[imageIndex] = uniformOffset;
 
-		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.NumElem());
-		renderPassInfo.pClearValues = clearValues.Ptr();
+	// the visible submeshes of the selected level, neighbouring ranges are merged into one draw
+	std::vector<MeshLod> draws;
+	const size_t submeshCount{ mesh->submeshes.size() };
+	for (size_t i = 0; i < submeshCount; ++i)
+	{
+		if (i < visibleSubmeshes.size() && visibleSubmeshes[i] == 0)
+		{
+			continue;
+		}
+		const MeshLod& range{ mesh->submeshLods[selectedLod * submeshCount + i] };
+		if (!draws.empty() && draws.back().indexOffset + draws.back().indexCount == range.indexOffset)
+		{
+			draws.back().indexCount += range.indexCount;
+		}
+		else
+		{
+			draws.push_back(range);
+		}
+	}
+	const auto drawSubmeshes{ [&]()
+		{
+			for (const MeshLod& draw : draws)
+			{
+				vkCmdDrawIndexed(commandBuffer, draw.indexCount, 1, draw.indexOffset, 0, 0);
+			}
+		} };
 
-		vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-		vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.pipeline);
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = 0;		// Optional
+	beginInfo.pInheritanceInfo = nullptr;  // Optional (use when using secondary command buffers)
 
-		VkBuffer vertexBuffers[]{ _vertexBuffer.buffer };
-		VkDeviceSize offsets[]{ 0 };
-		vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
-		vkCmdBindIndexBuffer(commandBuffers[i], _indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+	// BEGIN 
+	// RECORD COMMANDS
+	// END
 
-		vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.pipelineLayout, 0, 1, &descriptorSets[i], 0, nullptr);
+	auto result{ vkBeginCommandBuffer(commandBuffer, &beginInfo) };
+	DJINN_VK_ASSERT(result);
 
-		vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(vertexIndices.size()), 1, 0, 0, 0);
-		vkCmdEndRenderPass(commandBuffers[i]);
+	// binding 0 is the position stream of a split mesh, or the whole vertex otherwise
+	// a glTF mesh binds every attribute out of the one buffer, at the offset of its accessor
+	const bool split{ mesh->streams.splitPositions() };
+	VkBuffer vertexBuffers[GLTF_VERTEX_STREAMS]{ split ? _positionBuffer.buffer : _vertexBuffer.buffer, _vertexBuffer.buffer, _vertexBuffer.buffer };
+	VkDeviceSize offsets[GLTF_VERTEX_STREAMS]{};
+	uint32_t shadedBindings{ split ? 2u : 1u };
+	if (mesh->streams.vertexFormat == VertexFormat::VERTEX_FORMAT_GLTF)
+	{
+		for (uint32_t i = 0; i < GLTF_VERTEX_STREAMS; ++i)
+		{
+			offsets[i] = mesh->streams.attributeStreams[i].offset;
+		}
+		shadedBindings = GLTF_VERTEX_STREAMS;
+	}
+	vkCmdBindIndexBuffer(commandBuffer, _indexBuffer.buffer, 0, mesh->streams.indexType());
 
-		result = vkEndCommandBuffer(commandBuffers[i]);
-		DJINN_VK_ASSERT(result);
+	if (p_context->renderConfig.virtualTexturing)
+	{
+		// the pages this frame samples, drawFrame reads them once the image comes around again
+		Array1D<VkClearValue, 2> feedbackClearValues{};
+		feedbackClearValues[0].color.uint32[0] = VT_NO_PAGE;
+		feedbackClearValues[1].depthStencil = { 1.0f, 0 };
+
+		VkRenderPassBeginInfo feedbackPassInfo{};
+		feedbackPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		feedbackPassInfo.renderPass = feedbackRenderPass;
+		feedbackPassInfo.framebuffer = feedbackFramebuffers[imageIndex];
+		feedbackPassInfo.renderArea.offset = { 0, 0 };
+		feedbackPassInfo.renderArea.extent = feedbackExtent;
+		feedbackPassInfo.clearValueCount = static_cast<uint32_t>(feedbackClearValues.NumElem());
+		feedbackPassInfo.pClearValues = feedbackClearValues.Ptr();
+
+		vkCmdBeginRenderPass(commandBuffer, &feedbackPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, feedbackPipeline.pipeline);
+		vkCmdBindVertexBuffers(commandBuffer, 0, shadedBindings, vertexBuffers, offsets);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, feedbackPipeline.pipelineLayout, 0, 1, &descriptorSets[imageIndex], 1, &uniformOffset);
+		drawSubmeshes();
+		vkCmdEndRenderPass(commandBuffer);
+
+		VkBufferImageCopy region{};
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = 0;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageExtent = { feedbackExtent.width, feedbackExtent.height, 1 };
+		vkCmdCopyImageToBuffer(commandBuffer, feedbackImages[imageIndex].image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			feedbackBuffers[imageIndex].buffer, 1, &region);
+
+		VkBufferMemoryBarrier readbackBarrier{};
+		readbackBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		readbackBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		readbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		readbackBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		readbackBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		readbackBarrier.buffer = feedbackBuffers[imageIndex].buffer;
+		readbackBarrier.offset = 0;
+		readbackBarrier.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &readbackBarrier, 0, nullptr);
 	}
 
-	swapchainDeletionQueue.PushFunction([=]()
-		{vkFreeCommandBuffers(p_context->gpuInfo.device, p_context->graphicsCommandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data()); });
+	VkRenderPassBeginInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = renderPass.handle;
+	renderPassInfo.framebuffer = p_swapChain->swapChainFramebuffers[imageIndex];
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = p_swapChain->swapChainExtent;
+
+	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.NumElem());
+	renderPassInfo.pClearValues = clearValues.Ptr();
+
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	if (p_context->renderConfig.depthPrepass)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPipeline.pipeline);
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPipeline.pipelineLayout, 0, 1, &descriptorSets[imageIndex], 1, &uniformOffset);
+		drawSubmeshes();
+	}
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.pipeline);
+	vkCmdBindVertexBuffers(commandBuffer, 0, shadedBindings, vertexBuffers, offsets);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline.pipelineLayout, 0, 1, &descriptorSets[imageIndex], 1, &uniformOffset);
+
+	drawSubmeshes();
+	vkCmdEndRenderPass(commandBuffer);
+
+	result = vkEndCommandBuffer(commandBuffer);
+	DJINN_VK_ASSERT(result);
 }
 
 void Djinn::VulkanEngine::createSyncObjects()
@@ -968,6 +1461,8 @@ void Djinn::VulkanEngine::createSyncObjects()
 
 void Djinn::VulkanEngine::drawFrame()
 {
+	uploadStreamedAssets();
+
 	// wait for fence from previous vkQueueSubmit call
 	vkWaitForFences(p_context->gpuInfo.device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
 
@@ -985,7 +1480,27 @@ void Djinn::VulkanEngine::drawFrame()
 	// mark image as "in-use"
 	imagesInFlight[swapChainImageIndex] = inFlightFences[currentFrame];
 
+	if (p_context->renderConfig.virtualTexturing)
+	{
+		updateVirtualTexture(swapChainImageIndex);
+	}
+
+	// the last submission using this image's set has finished, it can pick up the newly resident mips
+	if (boundTextureMips[swapChainImageIndex] != residentMip)
+	{
+		updateTextureDescriptors(swapChainImageIndex);
+		recordedLods[swapChainImageIndex] = UINT32_MAX;
+	}
+
+	// the fence waited on above covers every read of this image's ring region
+	_frameRing.BeginFrame(swapChainImageIndex);
 	updateUniformBuffer(swapChainImageIndex);
+	_frameRing.Flush(p_context);
+	if (recordedLods[swapChainImageIndex] != selectedLod || recordedVisibility[swapChainImageIndex] != visibleSubmeshes ||
+		recordedUniformOffsets[swapChainImageIndex] != uniformOffsets[swapChainImageIndex])
+	{
+		recordCommandBuffer(swapChainImageIndex);
+	}
 
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -1000,9 +1515,16 @@ void Djinn::VulkanEngine::drawFrame()
 	submitInfo.signalSemaphoreCount = 1;
 	submitInfo.pSignalSemaphores = &renderFinishedSemaphores[currentFrame];
 
+	// this frame's uploads go first in the queue, their barriers cover the reads below
+	uploadContext.Submit();
+
 	vkResetFences(p_context->gpuInfo.device, 1, &inFlightFences[currentFrame]);
 	result = vkQueueSubmit(p_context->graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]);
 	DJINN_VK_ASSERT(result);
+	if (p_context->renderConfig.virtualTexturing)
+	{
+		feedbackReady[swapChainImageIndex] = true;
+	}
 
 	// if RENDER_FINISHED - we can present the image to the screen
 	VkPresentInfoKHR presentInfo{};
@@ -1027,6 +1549,7 @@ void Djinn::VulkanEngine::drawFrame()
 	}
 
 	currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	++frameCount;
 }
 
 void Djinn::VulkanEngine::initImGui()
@@ -9,6 +9,8 @@
 #include <map>
 #include <set>
 #include <algorithm>
+#include <span>
+#include <memory>
 
 #include "ext_inc.h"
 #include "QueueFamilies.h"
@@ -16,9 +18,14 @@
 #include "core/core.h"
 #include "core/Image.h"
 #include "core/Buffer.h"
+#include "core/Memory.h"
+#include "core/FrameRing.h"
+#include "core/UploadContext.h"
 #include "core/Primitives.h"
+#include "core/AssetStreamer.h"
 #include "core/GraphicsPipeline.h"
 #include "core/RenderPass.h"
+#include "core/VirtualTexture.h"
 #include <vulkan/vulkan.h>
 #include "external/imgui/imgui.h"
 #include "external/imgui/backends/imgui_impl_vulkan.h"
@@ -60,35 +67,49 @@ namespace Djinn
 		void recreateSwapChain();
 		void createRenderPass();
 		void createGraphicsPipeline();
+		void createDepthPipeline();
 		void createDepthResources();
-		void createTextureImage();
+		void createTextureImage(const TextureAsset& texture);
+		void uploadTextureLevels(const TextureAsset& texture, const uint32_t firstLevel, const uint32_t endLevel, const bool firstUpload);
+		uint32_t textureLevelsInBudget(const TextureAsset& texture, const uint32_t endLevel) const;
+		void streamTextureMips();
 		void createTextureImageView();
 		void createTextureSampler();
+		void destroyTexture();
+		void createVirtualTexture(std::shared_ptr<const TextureAsset> source);
+		std::shared_ptr<const TextureAsset> deviceTexture(std::shared_ptr<const TextureAsset> texture) const;
+		void uploadVirtualPages(std::span<const VirtualPageUpload> uploads, const bool firstUpload);
+		void updateVirtualTexture(const uint32_t imageIndex);
+		void createFeedbackRenderPass();
+		void createFeedbackPipeline();
+		void createFeedbackResources();
 		void createColorResources();
-		VkImageView createImageView(const VkImage image, const VkFormat format, const VkImageAspectFlags aspectFlags, const uint32_t mipLevels);
-		VkCommandBuffer beginSingleTimeCommands(VkCommandPool& commandPool);
-		void endSingleTimeCommands(VkCommandPool& commandPool, VkCommandBuffer commandBuffer, VkQueue submitQueue);
-		void transitionImageLayout(VkImage image, const VkFormat format, const VkImageLayout oldLayout,
-			const VkImageLayout newLayout, const uint32_t mipLevels);
-		void copyBufferToImage(VkBuffer buffer, VkImage image, const uint32_t width, const uint32_t height);
-		void generateMipMaps(VkImage image, const VkFormat format, const uint32_t texWidth, const uint32_t texHeight, const uint32_t mipLevels);
+		VkImageView createImageView(const VkImage image, const VkFormat format, const VkImageAspectFlags aspectFlags, const uint32_t mipLevels,
+			const VkComponentMapping components = {});
+		void copyBufferToImage(const StagingRange& staging, VkImage image, std::span<const MipLevel> levels, const uint64_t bufferBase,
+			const uint32_t firstLevel, const bool firstUpload);
 		void createImage(const uint32_t width, const uint32_t height, const uint32_t mipLevels, const VkFormat format,
 			const VkSampleCountFlagBits numSamples, const VkImageTiling tiling, const VkImageUsageFlags flags,
-			const VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
-		void loadModel(const std::string& path);
+			const VkMemoryPropertyFlags properties, VkImage& image, VulkanAllocation_t& allocation);
+		void requestAssets();
+		void uploadStreamedAssets();
 		void createVertexBufferStaged();
 		void createIndexBufferStaged();
+		void createMeshletBuffers();
+		void destroyMeshBuffers();
 		void createUniformBuffers();
 		void createDescriptorPool();
 		void createDescriptorSets();
+		void updateTextureDescriptors(const uint32_t imageIndex);
 		void updateUniformBuffer(const uint32_t imageIndex);
-		void createBuffer(const VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
-			VkBuffer& buffer, VkDeviceMemory& bufferMemory, const VkDeviceSize offset);
 		void createDescriptorSetLayout();
 		void createCommandBuffers();
+		void recordCommandBuffer(const size_t imageIndex);
 		void createSyncObjects();
 		void initImGui();
 		void initVMA();
+		void initAllocator();
+		void initUploads();
 
 	private:
 
@@ -97,16 +118,27 @@ namespace Djinn
 		Djinn::Queue mainDeletionQueue;
 		Djinn::Queue swapchainDeletionQueue;
 		VmaAllocator VMA;
+		Djinn::VulkanAllocator allocator;
+		// every staged upload of buffers, textures and virtual pages, submitted ahead of the frame that reads it
+		Djinn::UploadContext uploadContext;
 
 		ImGui_ImplVulkanH_Window g_MainWindowData;
 
 		VkDescriptorSetLayout descriptorSetLayout{ VK_NULL_HANDLE };
 		Djinn::GraphicsPipeline graphicsPipeline;
+		// position only, built when RendererConfig::depthPrepass is set
+		Djinn::GraphicsPipeline depthPipeline;
 		Djinn::RenderPass renderPass;
 
 		//VkCommandPool gfxCommandPool					{ VK_NULL_HANDLE };
 		//VkCommandPool transferCommandPool				{ VK_NULL_HANDLE };
 		std::vector<VkCommandBuffer> commandBuffers;
+		// LOD each command buffer was recorded with, re-recorded when the selection changes
+		std::vector<uint32_t> recordedLods;
+		// and the submeshes it draws, re-recorded when one enters or leaves the view
+		std::vector<std::vector<uint8_t>> recordedVisibility;
+		// and the dynamic offset of its uniforms in the frame ring
+		std::vector<uint32_t> recordedUniformOffsets;
 
 		// synchronization
 		Djinn::Array1D<VkSemaphore, MAX_FRAMES_IN_FLIGHT> imageAvailableSemaphores;
@@ -124,14 +156,55 @@ namespace Djinn
 		// TODO 
 		// combine vertex and index buffer int o a single array
 		Djinn::Buffer _vertexBuffer;
+		// split meshes only, _vertexBuffer then holds the remaining attributes
+		Djinn::Buffer _positionBuffer;
 		Djinn::Buffer _indexBuffer;
-		std::vector<Djinn::Buffer> _uniformBuffers;
-
-		VkImage textureImage;
-		uint32_t m_mipLevels;
-		VkDeviceMemory textureImageMemory;
-		VkImageView textureImageView;
-		VkSampler textureSampler;
+		// meshlet streams for cluster culling, see core/Meshlet.h
+		Djinn::Buffer _meshletBuffer;
+		Djinn::Buffer _meshletVertexBuffer;
+		Djinn::Buffer _meshletTriangleBuffer;
+		Djinn::Buffer _meshletBoundsBuffer;
+		// per frame constants, a region per swapchain image so a reused command buffer's offsets stay valid
+		Djinn::FrameRing _frameRing;
+		// where each image's UniformBufferObject was pushed this frame
+		std::vector<uint32_t> uniformOffsets;
+
+		VkImage textureImage{ VK_NULL_HANDLE };
+		uint32_t m_mipLevels{ 1 };
+		VkFormat textureFormat{ VK_FORMAT_R8G8B8A8_SRGB };
+		VkComponentMapping textureComponents{};
+		Djinn::VulkanAllocation_t textureImageAllocation{};
+		VkImageView textureImageView{ VK_NULL_HANDLE };
+		VkSampler textureSampler{ VK_NULL_HANDLE };
+
+		// progressive streaming, levels below residentMip are not uploaded yet and the sampler's minLod skips them
+		// the asset keeps its pixels mapped until every level is resident
+		std::shared_ptr<const Djinn::TextureAsset> streamingTexture;
+		uint32_t residentMip{ 0 };
+		// content key of the texture in textureImage, a streamed asset with the same key is already on the GPU
+		uint64_t residentTextureKey{ 0 };
+		// samplers replaced while streaming, sets of frames still in flight may point at them
+		std::vector<VkSampler> retiredSamplers;
+		// residentMip each descriptor set was written with, rewritten once its frame has retired
+		std::vector<uint32_t> boundTextureMips;
+
+		// virtual texturing, the texture image above is the page cache and the source stays mapped to stream pages from
+		std::shared_ptr<const Djinn::TextureAsset> virtualSource;
+		Djinn::VirtualTexture virtualTexture;
+		// RGBA8UI, one mip per level of the virtual texture
+		Djinn::Image indirectionImage;
+		VkSampler indirectionSampler{ VK_NULL_HANDLE };
+		// page ids rendered at a fraction of the swapchain extent, read back once the image's fence has signaled
+		VkRenderPass feedbackRenderPass{ VK_NULL_HANDLE };
+		Djinn::GraphicsPipeline feedbackPipeline;
+		VkExtent2D feedbackExtent{ 0, 0 };
+		Djinn::Image feedbackDepthImage;
+		std::vector<Djinn::Image> feedbackImages;
+		std::vector<VkFramebuffer> feedbackFramebuffers;
+		std::vector<Djinn::Buffer> feedbackBuffers;
+		// whether a finished submission left page ids in the image's readback buffer
+		std::vector<bool> feedbackReady;
+		uint64_t frameCount{ 0 };
 
 		// MSAA images
 		VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT; // default to 1 sample
@@ -140,9 +213,12 @@ namespace Djinn
 		Djinn::Image depthImage;
 
 
-		// model info
-		std::vector<Vertex> vertices;
-		std::vector<uint32_t> vertexIndices;
+		// model info, a placeholder until the streamed mesh is resident
+		Djinn::AssetStreamer assetStreamer;
+		std::shared_ptr<const Djinn::MeshAsset> mesh;
+		uint32_t selectedLod{ 0 };
+		// frustum test of every submesh at the last uniform update, 0 = culled
+		std::vector<uint8_t> visibleSubmeshes;
 
 	};
 }
@@ -0,0 +1,148 @@
+// compression ratio and decode throughput of the pack codec
+// usage : lz_bench [file]... (cooked caches or packs, a synthetic vertex / index stream when none are given)
+
+#include <spdlog/spdlog.h>
+
+#include "../core/LzCodec.h"
+#include "../DjinnLib/MappedFile.h"
+#include "../DjinnLib/Parallel.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	constexpr uint32_t BENCH_RUNS{ 5 };
+	constexpr uint64_t SYNTHETIC_VERTICES{ 2'000'000 };
+
+	template <typename Fn>
+	double bestOfSeconds(const uint32_t runs, Fn&& fn)
+	{
+		double best{ 1e30 };
+		for (uint32_t i = 0; i < runs; ++i)
+		{
+			const auto start{ std::chrono::high_resolution_clock::now() };
+			fn();
+			const auto stop{ std::chrono::high_resolution_clock::now() };
+			best = std::min(best, std::chrono::duration<double>(stop - start).count());
+		}
+		return best;
+	}
+
+	// a height field laid out like the full vertex format, then its grid indices
+	std::vector<uint8_t> syntheticMeshImage(const uint64_t vertexCount)
+	{
+		const auto side{ static_cast<uint32_t>(std::sqrt(static_cast<double>(vertexCount))) };
+		std::vector<float> vertices;
+		vertices.reserve(static_cast<size_t>(side) * side * 16);
+		for (uint32_t y = 0; y < side; ++y)
+		{
+			for (uint32_t x = 0; x < side; ++x)
+			{
+				const float u{ static_cast<float>(x) / static_cast<float>(side) };
+				const float v{ static_cast<float>(y) / static_cast<float>(side) };
+				const float h{ std::sin(u * 31.0f) * std::cos(v * 17.0f) };
+				// position, color, normal, texCoord, each padded to 16 bytes like the aligned glm types
+				const float vertex[16]{ u * 10.0f, h, v * 10.0f, 0.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, u, v, 0.0f, 0.0f };
+				vertices.insert(vertices.end(), std::begin(vertex), std::end(vertex));
+			}
+		}
+
+		std::vector<uint32_t> indices;
+		indices.reserve(static_cast<size_t>(side - 1) * (side - 1) * 6);
+		for (uint32_t y = 0; y + 1 < side; ++y)
+		{
+			for (uint32_t x = 0; x + 1 < side; ++x)
+			{
+				const uint32_t i0{ y * side + x };
+				const uint32_t i2{ i0 + side };
+				indices.insert(indices.end(), { i0, i2, i0 + 1, i0 + 1, i2, i2 + 1 });
+			}
+		}
+
+		std::vector<uint8_t> image(vertices.size() * sizeof(float) + indices.size() * sizeof(uint32_t));
+		std::memcpy(image.data(), vertices.data(), vertices.size() * sizeof(float));
+		std::memcpy(image.data() + vertices.size() * sizeof(float), indices.data(), indices.size() * sizeof(uint32_t));
+		return image;
+	}
+
+	void benchImage(const std::string& name, std::span<const uint8_t> image)
+	{
+		const double megabytes{ static_cast<double>(image.size()) / (1024.0 * 1024.0) };
+		const double gigabytes{ megabytes / 1024.0 };
+
+		std::vector<uint8_t> stream;
+		const double compressSeconds{ bestOfSeconds(BENCH_RUNS, [&]()
+			{
+				Djinn::lzCompressStream(image, Djinn::LZ_DEFAULT_BLOCK_SIZE, stream);
+			}) };
+
+		std::vector<uint8_t> decoded(image.size());
+
+		// one thread walking the blocks, what a single streaming worker gets without the fan out
+		const auto header{ reinterpret_cast<const Djinn::LzStreamHeader*>(stream.data()) };
+		const auto offsets{ reinterpret_cast<const uint64_t*>(stream.data() + sizeof(Djinn::LzStreamHeader)) };
+		const double serialSeconds{ bestOfSeconds(BENCH_RUNS, [&]()
+			{
+				for (uint32_t i = 0; i < header->blockCount; ++i)
+				{
+					const size_t rawOffset{ static_cast<size_t>(i) * header->blockSize };
+					const auto raw{ std::span<uint8_t>{ decoded }.subspan(rawOffset, std::min<size_t>(header->blockSize, decoded.size() - rawOffset)) };
+					const std::span<const uint8_t> block{ stream.data() + offsets[i], offsets[i + 1] - offsets[i] };
+					if (block.size() == raw.size())
+					{
+						std::memcpy(raw.data(), block.data(), raw.size());
+					}
+					else
+					{
+						Djinn::lzDecompressBlock(block, raw);
+					}
+				}
+			}) };
+
+		bool roundTrip{ false };
+		const double parallelSeconds{ bestOfSeconds(BENCH_RUNS, [&]()
+			{
+				roundTrip = Djinn::lzDecompressStream(stream, decoded);
+			}) };
+		roundTrip = roundTrip && std::memcmp(decoded.data(), image.data(), image.size()) == 0;
+
+		spdlog::info("{} ({:.1f} MB, {} blocks)", name, megabytes, header->blockCount);
+		spdlog::info("  ratio           : {:.3f} ({} -> {} bytes)", static_cast<double>(image.size()) / static_cast<double>(stream.size()),
+			image.size(), stream.size());
+		spdlog::info("  compress        : {:8.1f} MB/s", megabytes / compressSeconds);
+		spdlog::info("  decode 1 thread : {:8.2f} GB/s", gigabytes / serialSeconds);
+		spdlog::info("  decode {:2} thread: {:8.2f} GB/s", Djinn::hardwareThreadCount(), gigabytes / parallelSeconds);
+
+		if (!roundTrip)
+		{
+			spdlog::warn("  decoded bytes differ!");
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		const auto image{ syntheticMeshImage(SYNTHETIC_VERTICES) };
+		benchImage("synthetic mesh", image);
+		return EXIT_SUCCESS;
+	}
+
+	for (int i = 1; i < argc; ++i)
+	{
+		Djinn::MappedFile file;
+		if (!file.Open(argv[i]))
+		{
+			spdlog::error("Cannot open {}", argv[i]);
+			continue;
+		}
+		benchImage(argv[i], { file.Data(), file.Size() });
+	}
+
+	return EXIT_SUCCESS;
+}
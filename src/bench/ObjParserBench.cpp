@@ -0,0 +1,136 @@
+// compares Djinn::parseObj against tinyobj::LoadObj
+// usage : obj_parser_bench [model.obj] [synthetic triangle count]
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+#include <spdlog/spdlog.h>
+
+#include "../core/ObjParser.h"
+
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace
+{
+	constexpr uint32_t BENCH_RUNS{ 3 };
+
+	template <typename Fn>
+	double bestOfSeconds(const uint32_t runs, Fn&& fn)
+	{
+		double best{ 1e30 };
+		for (uint32_t i = 0; i < runs; ++i)
+		{
+			const auto start{ std::chrono::high_resolution_clock::now() };
+			fn();
+			const auto stop{ std::chrono::high_resolution_clock::now() };
+			best = std::min(best, std::chrono::duration<double>(stop - start).count());
+		}
+		return best;
+	}
+
+	// square grid with positions and texcoords, two triangles per cell
+	void writeSyntheticObj(const std::string& path, const uint64_t triangleCount)
+	{
+		const auto cells{ static_cast<uint64_t>(std::ceil(std::sqrt(static_cast<double>(triangleCount) / 2.0))) };
+		const uint64_t side{ cells + 1 };
+
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		std::string line;
+		line.reserve(128);
+
+		for (uint64_t y = 0; y < side; ++y)
+		{
+			for (uint64_t x = 0; x < side; ++x)
+			{
+				const double u{ static_cast<double>(x) / static_cast<double>(cells) };
+				const double v{ static_cast<double>(y) / static_cast<double>(cells) };
+				line = "v " + std::to_string(u * 10.0) + " " + std::to_string(std::sin(u * 31.0) * std::cos(v * 17.0)) + " " + std::to_string(v * 10.0) + "\n";
+				line += "vt " + std::to_string(u) + " " + std::to_string(v) + "\n";
+				out.write(line.data(), static_cast<std::streamsize>(line.size()));
+			}
+		}
+
+		for (uint64_t y = 0; y < cells; ++y)
+		{
+			for (uint64_t x = 0; x < cells; ++x)
+			{
+				const uint64_t i0{ y * side + x + 1 };
+				const uint64_t i1{ i0 + 1 };
+				const uint64_t i2{ i0 + side };
+				const uint64_t i3{ i2 + 1 };
+				const auto corner = [](const uint64_t i) { return std::to_string(i) + "/" + std::to_string(i); };
+				line = "f " + corner(i0) + " " + corner(i2) + " " + corner(i1) + "\n";
+				line += "f " + corner(i1) + " " + corner(i2) + " " + corner(i3) + "\n";
+				out.write(line.data(), static_cast<std::streamsize>(line.size()));
+			}
+		}
+	}
+
+	void benchFile(const std::string& path)
+	{
+		std::error_code ec;
+		const auto fileSize{ std::filesystem::file_size(path, ec) };
+		if (ec)
+		{
+			spdlog::error("Cannot open {}", path);
+			return;
+		}
+		const double megabytes{ static_cast<double>(fileSize) / (1024.0 * 1024.0) };
+
+		size_t tinyTriangles{ 0 };
+		const double tinySeconds{ bestOfSeconds(BENCH_RUNS, [&]()
+			{
+				tinyobj::attrib_t attrib;
+				std::vector<tinyobj::shape_t> shapes;
+				std::vector<tinyobj::material_t> materials;
+				std::string err;
+				tinyobj::LoadObj(&attrib, &shapes, &materials, &err, path.c_str());
+
+				tinyTriangles = 0;
+				for (const auto& shape : shapes)
+				{
+					tinyTriangles += shape.mesh.indices.size() / 3;
+				}
+			}) };
+
+		size_t djinnTriangles{ 0 };
+		const double djinnSeconds{ bestOfSeconds(BENCH_RUNS, [&]()
+			{
+				Djinn::ObjMesh mesh;
+				Djinn::parseObj(path, mesh);
+				djinnTriangles = mesh.indices.size() / 3;
+			}) };
+
+		spdlog::info("{} ({:.1f} MB)", path, megabytes);
+		spdlog::info("  tinyobj  : {:8.3f} s  {:8.1f} MB/s  {} triangles", tinySeconds, megabytes / tinySeconds, tinyTriangles);
+		spdlog::info("  parseObj : {:8.3f} s  {:8.1f} MB/s  {} triangles", djinnSeconds, megabytes / djinnSeconds, djinnTriangles);
+		spdlog::info("  speedup  : {:.2f}x", tinySeconds / djinnSeconds);
+
+		if (tinyTriangles != djinnTriangles)
+		{
+			spdlog::warn("  triangle counts differ!");
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const std::string modelPath{ argc > 1 ? argv[1] : "res/model/viking_room.obj" };
+	const uint64_t syntheticTriangles{ argc > 2 ? std::stoull(argv[2]) : 10'000'000ULL };
+
+	benchFile(modelPath);
+
+	const auto syntheticPath{ (std::filesystem::temp_directory_path() / "djinn_synthetic.obj").string() };
+	spdlog::info("Writing synthetic mesh with {} triangles to {}", syntheticTriangles, syntheticPath);
+	writeSyntheticObj(syntheticPath, syntheticTriangles);
+
+	benchFile(syntheticPath);
+
+	std::error_code ec;
+	std::filesystem::remove(syntheticPath, ec);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,205 @@
+#include "AssetPack.h"
+#include "LzCodec.h"
+#include "../DjinnLib/Hash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <spdlog/spdlog.h>
+
+namespace
+{
+	constexpr uint64_t alignUp(const uint64_t value, const uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	void writePadding(std::ofstream& out, const uint64_t from, const uint64_t to)
+	{
+		constexpr char zeros[Djinn::ASSET_PACK_ALIGNMENT]{};
+		out.write(zeros, static_cast<std::streamsize>(to - from));
+	}
+
+	bool entryValid(const Djinn::AssetPackEntry& entry, const uint64_t fileSize)
+	{
+		return entry.nameLength < Djinn::ASSET_PACK_MAX_NAME &&
+			entry.type <= Djinn::PackEntryType::PACK_ENTRY_TEXTURE &&
+			entry.compression <= Djinn::PackCompression::PACK_COMPRESSION_LZ &&
+			(entry.compression != Djinn::PackCompression::PACK_COMPRESSION_NONE || entry.rawSize == entry.size) &&
+			entry.offset % Djinn::ASSET_PACK_ALIGNMENT == 0 &&
+			entry.offset <= fileSize && entry.size <= fileSize - entry.offset;
+	}
+}
+
+bool Djinn::AssetPack::Open(const std::string& path)
+{
+	Close();
+
+	if (!file.Open(path))
+	{
+		return false;
+	}
+
+	const uint64_t fileSize{ file.Size() };
+	if (fileSize < sizeof(AssetPackHeader))
+	{
+		Close();
+		return false;
+	}
+
+	const auto header{ reinterpret_cast<const AssetPackHeader*>(file.Data()) };
+	const bool valid{ header->magic == ASSET_PACK_MAGIC &&
+		header->version == ASSET_PACK_VERSION &&
+		header->tocOffset % alignof(AssetPackEntry) == 0 &&
+		header->tocOffset <= fileSize &&
+		header->entryCount <= (fileSize - header->tocOffset) / sizeof(AssetPackEntry) };
+
+	if (!valid)
+	{
+		spdlog::warn("Asset pack {} is malformed or from an older cook", path);
+		Close();
+		return false;
+	}
+
+	entries = { reinterpret_cast<const AssetPackEntry*>(file.Data() + header->tocOffset), header->entryCount };
+	for (const auto& entry : entries)
+	{
+		if (!entryValid(entry, fileSize))
+		{
+			spdlog::warn("Asset pack {} has a bad entry", path);
+			Close();
+			return false;
+		}
+	}
+
+	spdlog::info("Mapped asset pack {} ({} entries, {} bytes)", path, entries.size(), fileSize);
+	return true;
+}
+
+void Djinn::AssetPack::Close()
+{
+	entries = {};
+	file.Close();
+}
+
+bool Djinn::AssetPack::IsOpen() const
+{
+	return file.IsOpen();
+}
+
+std::span<const uint8_t> Djinn::AssetPack::Find(const std::string& name, const PackEntryType type, std::vector<uint8_t>& decoded) const
+{
+	const uint64_t nameHash{ HashFNV1a(name) };
+	auto it{ std::lower_bound(entries.begin(), entries.end(), nameHash,
+		[](const AssetPackEntry& entry, const uint64_t hash) { return entry.nameHash < hash; }) };
+
+	for (; it != entries.end() && it->nameHash == nameHash; ++it)
+	{
+		if (it->type == type && std::string_view{ it->name, it->nameLength } == name)
+		{
+			file.WillNeed(static_cast<size_t>(it->offset), static_cast<size_t>(it->size));
+			const std::span<const uint8_t> image{ file.Data() + it->offset, static_cast<size_t>(it->size) };
+			if (it->compression == PackCompression::PACK_COMPRESSION_NONE)
+			{
+				return image;
+			}
+
+			decoded.resize(static_cast<size_t>(it->rawSize));
+			if (lzStreamRawSize(image) != it->rawSize || !lzDecompressStream(image, decoded))
+			{
+				spdlog::warn("Asset pack entry {} is corrupt", name);
+				decoded.clear();
+				return {};
+			}
+			return decoded;
+		}
+	}
+	return {};
+}
+
+bool Djinn::AssetPack::Store(const std::string& path, std::span<const AssetPackInput> inputs, const PackCompression compression)
+{
+	// what goes into the pack for each input, the image itself or its block stream
+	std::vector<std::vector<uint8_t>> streams(inputs.size());
+	std::vector<std::span<const uint8_t>> payloads(inputs.size());
+	for (size_t i = 0; i < inputs.size(); ++i)
+	{
+		payloads[i] = inputs[i].image;
+		if (compression == PackCompression::PACK_COMPRESSION_LZ)
+		{
+			lzCompressStream(inputs[i].image, LZ_DEFAULT_BLOCK_SIZE, streams[i]);
+			if (streams[i].size() < inputs[i].image.size())
+			{
+				payloads[i] = streams[i];
+			}
+		}
+	}
+
+	std::vector<AssetPackEntry> toc(inputs.size());
+	uint64_t cursor{ alignUp(sizeof(AssetPackHeader), ASSET_PACK_ALIGNMENT) };
+	for (size_t i = 0; i < inputs.size(); ++i)
+	{
+		if (inputs[i].name.size() >= ASSET_PACK_MAX_NAME)
+		{
+			spdlog::error("Asset name {} is too long for the pack", inputs[i].name);
+			return false;
+		}
+
+		AssetPackEntry& entry{ toc[i] };
+		entry.nameHash = HashFNV1a(inputs[i].name);
+		entry.type = inputs[i].type;
+		entry.nameLength = static_cast<uint32_t>(inputs[i].name.size());
+		entry.offset = cursor;
+		entry.size = payloads[i].size();
+		entry.compression = payloads[i].data() == inputs[i].image.data() ? PackCompression::PACK_COMPRESSION_NONE : compression;
+		entry.rawSize = inputs[i].image.size();
+		std::memcpy(entry.name, inputs[i].name.data(), inputs[i].name.size());
+		cursor = alignUp(cursor + entry.size, ASSET_PACK_ALIGNMENT);
+	}
+
+	AssetPackHeader header{};
+	header.magic = ASSET_PACK_MAGIC;
+	header.version = ASSET_PACK_VERSION;
+	header.entryCount = static_cast<uint32_t>(toc.size());
+	header.tocOffset = cursor;
+
+	// write to a temporary and rename so a crash never leaves a half written pack behind
+	const std::string tempPath{ path + ".tmp" };
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+		{
+			return false;
+		}
+
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		uint64_t written{ sizeof(header) };
+		for (size_t i = 0; i < inputs.size(); ++i)
+		{
+			writePadding(out, written, toc[i].offset);
+			out.write(reinterpret_cast<const char*>(payloads[i].data()), static_cast<std::streamsize>(payloads[i].size()));
+			written = toc[i].offset + toc[i].size;
+		}
+		writePadding(out, written, header.tocOffset);
+
+		// sorted after the payload offsets are fixed, Find binary searches it
+		std::sort(toc.begin(), toc.end(), [](const AssetPackEntry& a, const AssetPackEntry& b) { return a.nameHash < b.nameHash; });
+		out.write(reinterpret_cast<const char*>(toc.data()), static_cast<std::streamsize>(toc.size() * sizeof(AssetPackEntry)));
+
+		if (!out.good())
+		{
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, path, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+
+	return true;
+}
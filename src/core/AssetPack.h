@@ -0,0 +1,87 @@
+#ifndef ASSET_PACK_INCLUDE_H
+#define ASSET_PACK_INCLUDE_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "../DjinnLib/MappedFile.h"
+
+namespace Djinn
+{
+	constexpr uint32_t ASSET_PACK_MAGIC{ 0x4b504a44 }; // "DJPK"
+	constexpr uint32_t ASSET_PACK_VERSION{ 2 };
+	// entries start on a page, the cache images inside keep their section alignment and are prefetched on their own
+	constexpr uint64_t ASSET_PACK_ALIGNMENT{ 4096 };
+	constexpr uint32_t ASSET_PACK_MAX_NAME{ 104 };
+
+	enum class PackEntryType : uint32_t
+	{
+		PACK_ENTRY_MESH,		// a mesh cache image, see MeshCache.h
+		PACK_ENTRY_TEXTURE		// a texture cache image, see TextureCache.h
+	};
+
+	// compressed entries hold an LZ block stream of the cache image, see LzCodec.h
+	enum class PackCompression : uint32_t
+	{
+		PACK_COMPRESSION_NONE,
+		PACK_COMPRESSION_LZ
+	};
+
+	struct AssetPackHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t reserved;
+		uint64_t tocOffset;
+	};
+
+	// the table of contents is sorted by nameHash
+	struct AssetPackEntry
+	{
+		uint64_t nameHash;
+		PackEntryType type;
+		uint32_t nameLength;
+		uint64_t offset;
+		uint64_t size;				// bytes in the pack
+		PackCompression compression;
+		uint32_t reserved;
+		uint64_t rawSize;			// bytes of the cache image, equals size when stored
+		char name[ASSET_PACK_MAX_NAME];
+	};
+
+	// what the cook tool writes, image is the cache file of the asset
+	struct AssetPackInput
+	{
+		std::string name;
+		PackEntryType type;
+		std::span<const uint8_t> image;
+	};
+
+	// every cooked asset in one mapped file, entries are handed out as spans into the mapping
+	class AssetPack
+	{
+	public:
+		// returns false if the pack doesn't exist or is malformed
+		bool Open(const std::string& path);
+		void Close();
+		bool IsOpen() const;
+
+		// empty if the pack doesn't have the asset, names are the loose file paths the pack was cooked from
+		// asks the OS to start reading the entry in, the loader touches it right after
+		// stored entries are views into the mapping, compressed ones are decoded in parallel into decoded
+		std::span<const uint8_t> Find(const std::string& name, const PackEntryType type, std::vector<uint8_t>& decoded) const;
+
+		// LZ entries that don't shrink are stored as is
+		static bool Store(const std::string& path, std::span<const AssetPackInput> inputs,
+			const PackCompression compression = PackCompression::PACK_COMPRESSION_NONE);
+
+	private:
+		MappedFile file;
+		std::span<const AssetPackEntry> entries;
+	};
+}
+
+#endif // ASSET_PACK_INCLUDE_H
@@ -0,0 +1,216 @@
+#include "AssetStreamer.h"
+#include "../DjinnLib/FileStamp.h"
+#include "../DjinnLib/Hash.h"
+#include "../DjinnLib/Parallel.h"
+
+#include <spdlog/spdlog.h>
+
+#include <filesystem>
+
+namespace
+{
+	// the path and the loose file's stamp, a stat is all a request costs before the caches are asked and an edited
+	// source gets a key of its own, assets that only exist in the pack are keyed on their path
+	// the path is normalized first so every spelling of one file shares its entry
+	uint64_t sourceKey(const std::string& path)
+	{
+		// absolute first, a relative path none of which exists (a pack only asset) comes back from weakly_canonical as is
+		std::error_code ec;
+		std::filesystem::path normalized{ std::filesystem::absolute(path, ec) };
+		if (!ec)
+		{
+			normalized = std::filesystem::weakly_canonical(normalized, ec);
+		}
+		if (ec)
+		{
+			normalized = std::filesystem::path{ path }.lexically_normal();
+		}
+
+		uint64_t key{ Djinn::HashFNV1a(normalized.generic_string()) };
+		Djinn::FileStamp stamp;
+		if (Djinn::queryFileStamp(path, stamp))
+		{
+			key = Djinn::HashCombine(Djinn::HashCombine(key, stamp.size), static_cast<uint64_t>(stamp.writeTime));
+		}
+		return key;
+	}
+}
+
+void Djinn::AssetStreamer::Init(const uint32_t threadCount)
+{
+	stopping = false;
+	const uint32_t count{ threadCount == 0 ? hardwareThreadCount() : threadCount };
+	workers.reserve(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		workers.emplace_back([this]() { workerLoop(); });
+	}
+}
+
+void Djinn::AssetStreamer::CleanUp()
+{
+	{
+		std::lock_guard lock{ jobMutex };
+		stopping = true;
+		pending -= jobs.size();
+		jobs.clear();
+	}
+	jobAvailable.notify_all();
+
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	workers.clear();
+
+	std::lock_guard lock{ completedMutex };
+	completedMeshes.clear();
+	completedTextures.clear();
+	pending = 0;
+
+	meshCache.Clear();
+	textureCache.Clear();
+
+	pack.Close();
+}
+
+bool Djinn::AssetStreamer::OpenPack(const std::string& path)
+{
+	return pack.Open(path);
+}
+
+void Djinn::AssetStreamer::RequestMesh(const std::string& path, const VertexFormat requestedFormat, const bool splitPositions)
+{
+	enqueue([this, path, requestedFormat, splitPositions]()
+		{
+			const uint64_t key{ HashCombine(HashCombine(sourceKey(path), static_cast<uint64_t>(requestedFormat)), splitPositions) };
+			bool created{ false };
+			auto mesh{ meshCache.FindOrCreate(key, [&]() -> std::unique_ptr<MeshAsset>
+				{
+					auto loaded{ std::make_unique<MeshAsset>() };
+					const bool packed{ pack.IsOpen() && loadPackedMeshAsset(pack, path, requestedFormat, splitPositions, *loaded) };
+					if (!packed && !loadMeshAsset(path, requestedFormat, splitPositions, *loaded))
+					{
+						return nullptr;
+					}
+					loaded->contentKey = key;
+					return loaded;
+				}, &created) };
+			if (mesh == nullptr)
+			{
+				--pending;
+				return;
+			}
+			if (!created)
+			{
+				spdlog::info("{} shares the already loaded {}", path, mesh->path);
+			}
+			std::lock_guard lock{ completedMutex };
+			completedMeshes.push_back(std::move(mesh));
+		});
+}
+
+void Djinn::AssetStreamer::RequestTexture(const std::string& path, const TextureFormat requestedFormat)
+{
+	enqueue([this, path, requestedFormat]()
+		{
+			const uint64_t key{ HashCombine(sourceKey(path), static_cast<uint64_t>(requestedFormat)) };
+			bool created{ false };
+			auto texture{ textureCache.FindOrCreate(key, [&]() -> std::unique_ptr<TextureAsset>
+				{
+					auto loaded{ std::make_unique<TextureAsset>() };
+					const bool packed{ pack.IsOpen() && loadPackedTextureAsset(pack, path, requestedFormat, *loaded) };
+					if (!packed && !loadTextureAsset(path, requestedFormat, *loaded))
+					{
+						return nullptr;
+					}
+					loaded->contentKey = key;
+					return loaded;
+				}, &created) };
+			if (texture == nullptr)
+			{
+				--pending;
+				return;
+			}
+			if (!created)
+			{
+				spdlog::info("{} shares the already loaded {}", path, texture->path);
+			}
+			std::lock_guard lock{ completedMutex };
+			completedTextures.push_back(std::move(texture));
+		});
+}
+
+std::shared_ptr<const Djinn::MeshAsset> Djinn::AssetStreamer::PopMesh()
+{
+	std::lock_guard lock{ completedMutex };
+	if (completedMeshes.empty())
+	{
+		return nullptr;
+	}
+	auto mesh{ std::move(completedMeshes.front()) };
+	completedMeshes.pop_front();
+	--pending;
+	return mesh;
+}
+
+std::shared_ptr<const Djinn::TextureAsset> Djinn::AssetStreamer::PopTexture()
+{
+	std::lock_guard lock{ completedMutex };
+	if (completedTextures.empty())
+	{
+		return nullptr;
+	}
+	auto texture{ std::move(completedTextures.front()) };
+	completedTextures.pop_front();
+	--pending;
+	return texture;
+}
+
+size_t Djinn::AssetStreamer::Pending() const
+{
+	return pending;
+}
+
+void Djinn::AssetStreamer::enqueue(std::function<void()>&& job)
+{
+	{
+		std::lock_guard lock{ jobMutex };
+		if (workers.empty())
+		{
+			spdlog::warn("Asset streamer is not running, dropping request");
+			return;
+		}
+		jobs.push_back(std::move(job));
+		++pending;
+	}
+	jobAvailable.notify_one();
+}
+
+void Djinn::AssetStreamer::workerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock lock{ jobMutex };
+			jobAvailable.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (stopping)
+			{
+				return;
+			}
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		try
+		{
+			job();
+		}
+		catch (const std::exception& e)
+		{
+			spdlog::error("Asset load failed: {}", e.what());
+			--pending;
+		}
+	}
+}
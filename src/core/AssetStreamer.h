@@ -0,0 +1,69 @@
+#ifndef ASSET_STREAMER_INCLUDE_H
+#define ASSET_STREAMER_INCLUDE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MeshAsset.h"
+#include "TextureAsset.h"
+#include "AssetPack.h"
+#include "ResourceCache.h"
+
+namespace Djinn
+{
+	// decodes assets on a pool of worker threads, the render thread polls for finished ones and uploads them
+	// failed loads are logged and dropped, whatever was bound before stays in use
+	class AssetStreamer
+	{
+	public:
+		void Init(const uint32_t threadCount = 0);		// 0 = hardware concurrency
+		// drops queued requests and joins the workers once their current job is done
+		void CleanUp();
+
+		// assets found in the pack are mapped from it, the rest load from their loose files
+		// call before the first request, the workers read the pack without locking
+		bool OpenPack(const std::string& path);
+
+		void RequestMesh(const std::string& path, const VertexFormat requestedFormat, const bool splitPositions);
+		void RequestTexture(const std::string& path, const TextureFormat requestedFormat);
+
+		// nullptr when nothing has finished since the last call
+		// repeated requests for the same unchanged file and settings share one decoded asset while any of them is held
+		std::shared_ptr<const MeshAsset> PopMesh();
+		std::shared_ptr<const TextureAsset> PopTexture();
+
+		// requests that are queued, decoding or waiting to be popped
+		size_t Pending() const;
+
+	private:
+		void enqueue(std::function<void()>&& job);
+		void workerLoop();
+
+		std::vector<std::thread> workers;
+		std::deque<std::function<void()>> jobs;
+		std::mutex jobMutex;
+		std::condition_variable jobAvailable;
+		bool stopping{ false };
+
+		std::deque<std::shared_ptr<const MeshAsset>> completedMeshes;
+		std::deque<std::shared_ptr<const TextureAsset>> completedTextures;
+		std::mutex completedMutex;
+
+		ResourceCache<MeshAsset> meshCache;
+		ResourceCache<TextureAsset> textureCache;
+
+		std::atomic<size_t> pending{ 0 };
+
+		AssetPack pack;
+	};
+}
+
+#endif // ASSET_STREAMER_INCLUDE_H
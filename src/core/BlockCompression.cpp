@@ -0,0 +1,585 @@
+#include "BlockCompression.h"
+#include "../DjinnLib/Parallel.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+	constexpr uint32_t BLOCK_TEXELS{ 16 };
+	// block rows per parallel band, a row of a 4k texture is 1024 blocks
+	constexpr size_t MIN_BLOCK_ROWS_PER_BAND{ 4 };
+
+	// BC7 4 bit index interpolation weights out of 64
+	constexpr std::array<uint32_t, 16> BC7_WEIGHTS{ 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	constexpr uint64_t alignUp(const uint64_t value, const uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	template <size_t N>
+	using Endpoint = std::array<float, N>;
+
+	// endpoints at the extremes of the principal axis of the block's colors
+	template <size_t N>
+	void fitEndpoints(const uint8_t* block, Endpoint<N>& e0, Endpoint<N>& e1)
+	{
+		Endpoint<N> mean{};
+		for (uint32_t i = 0; i < BLOCK_TEXELS; ++i)
+		{
+			for (size_t c = 0; c < N; ++c)
+			{
+				mean[c] += static_cast<float>(block[4 * i + c]);
+			}
+		}
+		for (auto& value : mean)
+		{
+			value /= static_cast<float>(BLOCK_TEXELS);
+		}
+
+		std::array<std::array<float, N>, N> covariance{};
+		for (uint32_t i = 0; i < BLOCK_TEXELS; ++i)
+		{
+			for (size_t a = 0; a < N; ++a)
+			{
+				const float da{ static_cast<float>(block[4 * i + a]) - mean[a] };
+				for (size_t b = 0; b < N; ++b)
+				{
+					covariance[a][b] += da * (static_cast<float>(block[4 * i + b]) - mean[b]);
+				}
+			}
+		}
+
+		// power iteration, seeded with the row of the channel that varies the most
+		size_t seed{ 0 };
+		for (size_t c = 1; c < N; ++c)
+		{
+			if (covariance[c][c] > covariance[seed][seed])
+			{
+				seed = c;
+			}
+		}
+		Endpoint<N> axis{ covariance[seed] };
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			Endpoint<N> next{};
+			float length{ 0.0f };
+			for (size_t a = 0; a < N; ++a)
+			{
+				for (size_t b = 0; b < N; ++b)
+				{
+					next[a] += covariance[a][b] * axis[b];
+				}
+				length = std::max(length, std::abs(next[a]));
+			}
+			if (length == 0.0f)
+			{
+				break;
+			}
+			for (size_t c = 0; c < N; ++c)
+			{
+				axis[c] = next[c] / length;
+			}
+		}
+
+		float axisLength{ 0.0f };
+		for (const auto value : axis)
+		{
+			axisLength += value * value;
+		}
+		axisLength = std::sqrt(axisLength);
+
+		float minProjection{ 0.0f };
+		float maxProjection{ 0.0f };
+		if (axisLength > 0.0f)
+		{
+			for (auto& value : axis)
+			{
+				value /= axisLength;
+			}
+			minProjection = std::numeric_limits<float>::max();
+			maxProjection = std::numeric_limits<float>::lowest();
+			for (uint32_t i = 0; i < BLOCK_TEXELS; ++i)
+			{
+				float projection{ 0.0f };
+				for (size_t c = 0; c < N; ++c)
+				{
+					projection += (static_cast<float>(block[4 * i + c]) - mean[c]) * axis[c];
+				}
+				minProjection = std::min(minProjection, projection);
+				maxProjection = std::max(maxProjection, projection);
+			}
+		}
+
+		for (size_t c = 0; c < N; ++c)
+		{
+			e0[c] = std::clamp(mean[c] + axis[c] * minProjection, 0.0f, 255.0f);
+			e1[c] = std::clamp(mean[c] + axis[c] * maxProjection, 0.0f, 255.0f);
+		}
+	}
+
+	// least squares endpoints for fixed per texel interpolation weights (0 = e0, 1 = e1)
+	template <size_t N>
+	bool refitEndpoints(const uint8_t* block, const std::array<float, BLOCK_TEXELS>& weights, Endpoint<N>& e0, Endpoint<N>& e1)
+	{
+		float aa{ 0.0f };
+		float ab{ 0.0f };
+		float bb{ 0.0f };
+		Endpoint<N> ax{};
+		Endpoint<N> bx{};
+		for (uint32_t i = 0; i < BLOCK_TEXELS; ++i)
+		{
+			const float b{ weights[i] };
+			const float a{ 1.0f - b };
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (size_t c = 0; c < N; ++c)
+			{
+				ax[c] += a * static_cast<float>(block[4 * i + c]);
+				bx[c] += b * static_cast<float>(block[4 * i + c]);
+			}
+		}
+
+		const float determinant{ aa * bb - ab * ab };
+		if (std::abs(determinant) < 1e-6f)
+		{
+			return false;
+		}
+		for (size_t c = 0; c < N; ++c)
+		{
+			e0[c] = std::clamp((bb * ax[c] - ab * bx[c]) / determinant, 0.0f, 255.0f);
+			e1[c] = std::clamp((aa * bx[c] - ab * ax[c]) / determinant, 0.0f, 255.0f);
+		}
+		return true;
+	}
+
+	uint16_t packColor565(const Endpoint<3>& color)
+	{
+		const auto r{ static_cast<uint32_t>(std::lround(color[0] * 31.0f / 255.0f)) };
+		const auto g{ static_cast<uint32_t>(std::lround(color[1] * 63.0f / 255.0f)) };
+		const auto b{ static_cast<uint32_t>(std::lround(color[2] * 31.0f / 255.0f)) };
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	std::array<int32_t, 3> unpackColor565(const uint16_t color)
+	{
+		const int32_t r{ (color >> 11) & 31 };
+		const int32_t g{ (color >> 5) & 63 };
+		const int32_t b{ color & 31 };
+		return { (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2) };
+	}
+
+	struct ColorBlockBC1
+	{
+		uint16_t color0;
+		uint16_t color1;
+		uint32_t indices;
+		uint32_t error;
+	};
+
+	// 4 color mode needs color0 > color1, equal endpoints fall back to index 0 everywhere
+	ColorBlockBC1 quantizeBC1(const uint8_t* block, const Endpoint<3>& e0, const Endpoint<3>& e1)
+	{
+		ColorBlockBC1 result{ packColor565(e0), packColor565(e1), 0, 0 };
+		if (result.color0 < result.color1)
+		{
+			std::swap(result.color0, result.color1);
+		}
+
+		const auto c0{ unpackColor565(result.color0) };
+		const auto c1{ unpackColor565(result.color1) };
+		std::array<std::array<int32_t, 3>, 4> palette{ c0, c1 };
+		for (size_t c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (2 * c0[c] + c1[c]) / 3;
+			palette[3][c] = (c0[c] + 2 * c1[c]) / 3;
+		}
+		const uint32_t paletteSize{ result.color0 == result.color1 ? 1u : 4u };
+
+		for (uint32_t i = 0; i < BLOCK_TEXELS; ++i)
+		{
+			uint32_t bestIndex{ 0 };
+			uint32_t bestError{ UINT32_MAX };
+			for (uint32_t p = 0; p < paletteSize; ++p)
+			{
+				uint32_t error{ 0 };
+				for (size_t c = 0; c < 3; ++c)
+				{
+					const int32_t d{ static_cast<int32_t>(block[4 * i + c]) - palette[p][c] };
+					error += static_cast<uint32_t>(d * d);
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = p;
+				}
+			}
+			result.indices |= bestIndex << (2 * i);
+			result.error += bestError;
+		}
+		return result;
+	}
+
+	void encodeColorBC1(const uint8_t* block, uint8_t* destination)
+	{
+		Endpoint<3> e0;
+		Endpoint<3> e1;
+		fitEndpoints<3>(block, e0, e1);
+		ColorBlockBC1 best{ quantizeBC1(block, e0, e1) };
+
+		// one least squares pass over the chosen indices usually recovers most of the quantization loss
+		constexpr std::array<float, 4> indexWeights{ 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		std::array<float, BLOCK_TEXELS> weights{};
+		for (uint32_t i = 0; i < BLOCK_TEXELS; ++i)
+		{
+			weights[i] = indexWeights[(best.indices >> (2 * i)) & 3];
+		}
+		const auto c0{ unpackColor565(best.color0) };
+		const auto c1{ unpackColor565(best.color1) };
+		for (size_t c = 0; c < 3; ++c)
+		{
+			e0[c] = static_cast<float>(c0[c]);
+			e1[c] = static_cast<float>(c1[c]);
+		}
+		if (best.color0 != best.color1 && refitEndpoints<3>(block, weights, e0, e1))
+		{
+			const ColorBlockBC1 refit{ quantizeBC1(block, e0, e1) };
+			if (refit.error < best.error)
+			{
+				best = refit;
+			}
+		}
+
+		std::memcpy(destination + 0, &best.color0, sizeof(uint16_t));
+		std::memcpy(destination + 2, &best.color1, sizeof(uint16_t));
+		std::memcpy(destination + 4, &best.indices, sizeof(uint32_t));
+	}
+
+	// BC4 style alpha block, 8 interpolated values between max and min
+	void encodeAlphaBC3(const uint8_t* block, uint8_t* destination)
+	{
+		uint8_t alpha0{ 0 };
+		uint8_t alpha1{ 255 };
+		for (uint32_t i = 0; i < BLOCK_TEXELS; ++i)
+		{
+			alpha0 = std::max(alpha0, block[4 * i + 3]);
+			alpha1 = std::min(alpha1, block[4 * i + 3]);
+		}
+
+		std::array<int32_t, 8> palette{ alpha0, alpha1 };
+		for (int32_t i = 2; i < 8; ++i)
+		{
+			palette[static_cast<size_t>(i)] = ((8 - i) * alpha0 + (i - 1) * alpha1) / 7;
+		}
+
+		uint64_t indices{ 0 };
+		if (alpha0 != alpha1)
+		{
+			for (uint32_t i = 0; i < BLOCK_TEXELS; ++i)
+			{
+				uint64_t bestIndex{ 0 };
+				int32_t bestError{ INT32_MAX };
+				for (size_t p = 0; p < palette.size(); ++p)
+				{
+					const int32_t error{ std::abs(static_cast<int32_t>(block[4 * i + 3]) - palette[p]) };
+					if (error < bestError)
+					{
+						bestError = error;
+						bestIndex = p;
+					}
+				}
+				indices |= bestIndex << (3 * i);
+			}
+		}
+
+		destination[0] = alpha0;
+		destination[1] = alpha1;
+		for (int i = 0; i < 6; ++i)
+		{
+			destination[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+		}
+	}
+
+	struct EndpointBC7
+	{
+		std::array<uint32_t, 4> value;		// 7 bits per channel
+		uint32_t pBit;
+	};
+
+	// mode 6 endpoints are 7 bits per channel plus a shared low bit, pick the low bit that fits best
+	EndpointBC7 quantizeEndpointBC7(const Endpoint<4>& endpoint)
+	{
+		EndpointBC7 best{};
+		float bestError{ std::numeric_limits<float>::max() };
+		for (uint32_t p = 0; p < 2; ++p)
+		{
+			EndpointBC7 candidate{};
+			candidate.pBit = p;
+			float error{ 0.0f };
+			for (size_t c = 0; c < 4; ++c)
+			{
+				const float q{ std::round((endpoint[c] - static_cast<float>(p)) * 0.5f) };
+				candidate.value[c] = static_cast<uint32_t>(std::clamp(q, 0.0f, 127.0f));
+				const float d{ static_cast<float>(candidate.value[c] * 2 + p) - endpoint[c] };
+				error += d * d;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				best = candidate;
+			}
+		}
+		return best;
+	}
+
+	struct BlockBC7
+	{
+		EndpointBC7 e0;
+		EndpointBC7 e1;
+		std::array<uint32_t, BLOCK_TEXELS> indices;
+		uint32_t error;
+	};
+
+	BlockBC7 quantizeBC7(const uint8_t* block, const Endpoint<4>& e0, const Endpoint<4>& e1)
+	{
+		BlockBC7 result{ quantizeEndpointBC7(e0), quantizeEndpointBC7(e1), {}, 0 };
+
+		std::array<std::array<int32_t, 4>, 16> palette{};
+		for (size_t w = 0; w < BC7_WEIGHTS.size(); ++w)
+		{
+			for (size_t c = 0; c < 4; ++c)
+			{
+				const uint32_t v0{ result.e0.value[c] * 2 + result.e0.pBit };
+				const uint32_t v1{ result.e1.value[c] * 2 + result.e1.pBit };
+				palette[w][c] = static_cast<int32_t>(((64 - BC7_WEIGHTS[w]) * v0 + BC7_WEIGHTS[w] * v1 + 32) >> 6);
+			}
+		}
+
+		for (uint32_t i = 0; i < BLOCK_TEXELS; ++i)
+		{
+			uint32_t bestIndex{ 0 };
+			uint32_t bestError{ UINT32_MAX };
+			for (uint32_t p = 0; p < palette.size(); ++p)
+			{
+				uint32_t error{ 0 };
+				for (size_t c = 0; c < 4; ++c)
+				{
+					const int32_t d{ static_cast<int32_t>(block[4 * i + c]) - palette[p][c] };
+					error += static_cast<uint32_t>(d * d);
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = p;
+				}
+			}
+			result.indices[i] = bestIndex;
+			result.error += bestError;
+		}
+		return result;
+	}
+
+	// little endian bit packing into the 128 bit block
+	class BlockWriter
+	{
+	public:
+		explicit BlockWriter(uint8_t* destination)
+			: p_destination(destination)
+		{
+			std::memset(p_destination, 0, 16);
+		}
+
+		void Put(const uint32_t value, const uint32_t bits)
+		{
+			for (uint32_t i = 0; i < bits; ++i, ++position)
+			{
+				p_destination[position >> 3] |= static_cast<uint8_t>(((value >> i) & 1) << (position & 7));
+			}
+		}
+
+	private:
+		uint8_t* p_destination;
+		uint32_t position{ 0 };
+	};
+}
+
+bool Djinn::isBlockCompressed(const TextureFormat format)
+{
+	return format == TextureFormat::TEXTURE_FORMAT_BC1 || format == TextureFormat::TEXTURE_FORMAT_BC3 || format == TextureFormat::TEXTURE_FORMAT_BC7;
+}
+
+uint32_t Djinn::blockBytes(const TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::TEXTURE_FORMAT_BC1:
+		return 8;
+	case TextureFormat::TEXTURE_FORMAT_BC3:
+	case TextureFormat::TEXTURE_FORMAT_BC7:
+		return 16;
+	case TextureFormat::TEXTURE_FORMAT_R8:
+		return 1;
+	case TextureFormat::TEXTURE_FORMAT_RG8:
+		return 2;
+	default:
+		return 4;
+	}
+}
+
+uint64_t Djinn::textureLevelSize(const TextureFormat format, const uint32_t width, const uint32_t height)
+{
+	if (!isBlockCompressed(format))
+	{
+		return static_cast<uint64_t>(width) * height * blockBytes(format);
+	}
+	return static_cast<uint64_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+uint32_t Djinn::textureChannels(const TextureFormat format)
+{
+	return isBlockCompressed(format) ? 4 : blockBytes(format);
+}
+
+Djinn::TextureFormat Djinn::chooseTextureFormat(const TextureFormat requestedFormat, std::span<const uint8_t> level0, const uint32_t channels)
+{
+	// grey data is lossless at no more bytes per texel than the block format would take
+	if (channels <= 2)
+	{
+		const TextureFormat greyFormat{ channels == 1 ? TextureFormat::TEXTURE_FORMAT_R8 : TextureFormat::TEXTURE_FORMAT_RG8 };
+		if (!isBlockCompressed(requestedFormat) || blockBytes(greyFormat) * BLOCK_TEXELS <= blockBytes(requestedFormat))
+		{
+			return greyFormat;
+		}
+	}
+
+	if (requestedFormat != TextureFormat::TEXTURE_FORMAT_BC1 || channels % 2 != 0)
+	{
+		return requestedFormat;
+	}
+	// alpha is the last channel of grey + alpha and RGBA sources
+	for (size_t i = channels - 1; i < level0.size(); i += channels)
+	{
+		if (level0[i] != 255)
+		{
+			return TextureFormat::TEXTURE_FORMAT_BC3;
+		}
+	}
+	return requestedFormat;
+}
+
+void Djinn::encodeBlockBC1(const uint8_t* block, uint8_t* destination)
+{
+	encodeColorBC1(block, destination);
+}
+
+void Djinn::encodeBlockBC3(const uint8_t* block, uint8_t* destination)
+{
+	encodeAlphaBC3(block, destination);
+	encodeColorBC1(block, destination + 8);
+}
+
+void Djinn::encodeBlockBC7(const uint8_t* block, uint8_t* destination)
+{
+	Endpoint<4> e0;
+	Endpoint<4> e1;
+	fitEndpoints<4>(block, e0, e1);
+	BlockBC7 best{ quantizeBC7(block, e0, e1) };
+
+	std::array<float, BLOCK_TEXELS> weights{};
+	for (uint32_t i = 0; i < BLOCK_TEXELS; ++i)
+	{
+		weights[i] = static_cast<float>(BC7_WEIGHTS[best.indices[i]]) / 64.0f;
+	}
+	if (refitEndpoints<4>(block, weights, e0, e1))
+	{
+		const BlockBC7 refit{ quantizeBC7(block, e0, e1) };
+		if (refit.error < best.error)
+		{
+			best = refit;
+		}
+	}
+
+	// the anchor texel's index drops its top bit, flip the endpoints if it is set
+	if (best.indices[0] & 8)
+	{
+		std::swap(best.e0, best.e1);
+		for (auto& index : best.indices)
+		{
+			index = 15 - index;
+		}
+	}
+
+	BlockWriter writer{ destination };
+	writer.Put(1u << 6, 7);		// mode 6
+	for (size_t c = 0; c < 4; ++c)
+	{
+		writer.Put(best.e0.value[c], 7);
+		writer.Put(best.e1.value[c], 7);
+	}
+	writer.Put(best.e0.pBit, 1);
+	writer.Put(best.e1.pBit, 1);
+	writer.Put(best.indices[0], 3);
+	for (uint32_t i = 1; i < BLOCK_TEXELS; ++i)
+	{
+		writer.Put(best.indices[i], 4);
+	}
+}
+
+void Djinn::compressMipChain(std::span<const uint8_t> pixels, std::span<const MipLevel> levels, const TextureFormat format,
+	std::vector<uint8_t>& blocks, std::vector<MipLevel>& blockLevels)
+{
+	assert(isBlockCompressed(format));
+
+	blockLevels.clear();
+	uint64_t offset{ 0 };
+	for (const auto& level : levels)
+	{
+		MipLevel blockLevel{ level };
+		blockLevel.offset = offset;
+		blockLevel.size = textureLevelSize(format, level.width, level.height);
+		blockLevels.push_back(blockLevel);
+		offset = alignUp(offset + blockLevel.size, MIP_LEVEL_ALIGNMENT);
+	}
+	blocks.assign(offset, 0);
+
+	const auto encodeBlock{ format == TextureFormat::TEXTURE_FORMAT_BC1 ? encodeBlockBC1 :
+		format == TextureFormat::TEXTURE_FORMAT_BC3 ? encodeBlockBC3 : encodeBlockBC7 };
+	const size_t bytesPerBlock{ blockBytes(format) };
+
+	for (size_t l = 0; l < levels.size(); ++l)
+	{
+		const MipLevel& source{ levels[l] };
+		const MipLevel& target{ blockLevels[l] };
+		const uint8_t* sourcePixels{ pixels.data() + source.offset };
+		uint8_t* targetBlocks{ blocks.data() + target.offset };
+		const uint32_t blocksX{ (source.width + 3) / 4 };
+		const uint32_t blocksY{ (source.height + 3) / 4 };
+
+		parallelForBands(blocksY, MIN_BLOCK_ROWS_PER_BAND, [&](const size_t begin, const size_t end)
+			{
+				std::array<uint8_t, 4 * BLOCK_TEXELS> block{};
+				for (size_t by = begin; by < end; ++by)
+				{
+					for (uint32_t bx = 0; bx < blocksX; ++bx)
+					{
+						for (uint32_t y = 0; y < 4; ++y)
+						{
+							const size_t sourceY{ std::min(4 * by + y, size_t{ source.height } - 1) };
+							for (uint32_t x = 0; x < 4; ++x)
+							{
+								const size_t sourceX{ std::min(size_t{ 4 } * bx + x, size_t{ source.width } - 1) };
+								std::memcpy(block.data() + 4 * (4 * y + x), sourcePixels + 4 * (sourceY * source.width + sourceX), 4);
+							}
+						}
+						encodeBlock(block.data(), targetBlocks + (by * blocksX + bx) * bytesPerBlock);
+					}
+				}
+			});
+	}
+}
@@ -0,0 +1,46 @@
+#ifndef BLOCK_COMPRESSION_INCLUDE_H
+#define BLOCK_COMPRESSION_INCLUDE_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "MipGen.h"
+
+namespace Djinn
+{
+	// texel layout of a texture pyramid, the BC formats store 4x4 blocks
+	enum class TextureFormat : uint32_t
+	{
+		TEXTURE_FORMAT_RGBA8,
+		TEXTURE_FORMAT_BC1,		// 8 bytes per block, opaque RGB
+		TEXTURE_FORMAT_BC3,		// 16 bytes per block, BC1 color plus interpolated alpha
+		TEXTURE_FORMAT_BC7,		// 16 bytes per block, mode 6 only (single subset RGBA)
+		TEXTURE_FORMAT_R8,		// grey, sampled as (r, r, r, 1)
+		TEXTURE_FORMAT_RG8		// grey and alpha, sampled as (r, r, r, g)
+	};
+
+	bool isBlockCompressed(const TextureFormat format);
+	// bytes per block, or per texel for the uncompressed formats
+	uint32_t blockBytes(const TextureFormat format);
+	uint64_t textureLevelSize(const TextureFormat format, const uint32_t width, const uint32_t height);
+	// channels stored per texel of an uncompressed format, 4 for the BC formats which are encoded from RGBA8
+	uint32_t textureChannels(const TextureFormat format);
+
+	// level0 is in the source layout, 1 to 4 channels per texel
+	// grey sources keep R8 / RG8 unless the requested format is smaller, 3 and 4 channel sources get the requested format
+	// BC1 is upgraded to BC3 for textures that aren't fully opaque
+	TextureFormat chooseTextureFormat(const TextureFormat requestedFormat, std::span<const uint8_t> level0, const uint32_t channels);
+
+	// a block is 16 RGBA8 texels in row order
+	void encodeBlockBC1(const uint8_t* block, uint8_t* destination);
+	void encodeBlockBC3(const uint8_t* block, uint8_t* destination);
+	void encodeBlockBC7(const uint8_t* block, uint8_t* destination);
+
+	// encodes every level of an RGBA8 pyramid, block rows of each level are encoded in parallel
+	// edge blocks of levels that aren't a multiple of 4 repeat the last row / column
+	void compressMipChain(std::span<const uint8_t> pixels, std::span<const MipLevel> levels, const TextureFormat format,
+		std::vector<uint8_t>& blocks, std::vector<MipLevel>& blockLevels);
+}
+
+#endif // BLOCK_COMPRESSION_INCLUDE_H
@@ -1,7 +1,22 @@
 #include "Buffer.h"
 #include "Memory.h"
+#include "UploadContext.h"
 #include "../DjinnLib/Array.h"
 
+#include <algorithm>
+
+namespace
+{
+	constexpr VkDeviceSize LARGE_MAPPABLE_HEAP{ 1ull << 30 };
+
+	// resizable BAR and unified memory take any upload, a plain 256 MiB BAR window only small ones so it isn't used up by a few meshes
+	bool preferDirectUpload(Djinn::Context* p_context, const VkDeviceSize uploadSize)
+	{
+		const VkDeviceSize heapSize{ Djinn::mappableDeviceLocalHeap(p_context) };
+		return heapSize > LARGE_MAPPABLE_HEAP || (heapSize != 0 && uploadSize <= p_context->renderConfig.directUploadLimit);
+	}
+}
+
 Djinn::Buffer::Buffer(Djinn::Context* p_context, const BufferCreateInfo createInfo)
 {
 	Init(p_context, createInfo);
@@ -11,21 +26,52 @@ void Djinn::Buffer::Init(Djinn::Context* p_context, const BufferCreateInfo creat
 {
 	size = createInfo.size;
 
-	// TODO add functionality for memory pools and custom allocators
-	createBuffer(p_context, createInfo.size, createInfo.offset,
+	createBuffer(p_context, createInfo.size,
 		createInfo.usage, createInfo.properties, createInfo.sharingMode,
-		buffer, bufferMemory);
+		buffer, allocation, createInfo.preferredProperties);
 }
 
 void Djinn::Buffer::CleanUp(Djinn::Context* p_context)
 {
 	vkDestroyBuffer(p_context->gpuInfo.device, buffer, nullptr);
-	vkFreeMemory(p_context->gpuInfo.device, bufferMemory, nullptr);
+	p_context->p_allocator->Free(allocation);
+}
+
+void Djinn::Buffer::Write(const VkDeviceSize offset, const VkDeviceSize dataSize, const void* src)
+{
+	assert(allocation.data != nullptr && offset + dataSize <= size);
+	memcpy(allocation.data + offset, src, static_cast<size_t>(dataSize));
+
+	if (dirtyBegin == dirtyEnd)
+	{
+		dirtyBegin = offset;
+		dirtyEnd = offset + dataSize;
+	}
+	else
+	{
+		dirtyBegin = std::min(dirtyBegin, offset);
+		dirtyEnd = std::max(dirtyEnd, offset + dataSize);
+	}
+}
+
+void Djinn::Buffer::Flush(Djinn::Context* p_context)
+{
+	if (dirtyBegin != dirtyEnd)
+	{
+		p_context->p_allocator->Flush(allocation, dirtyBegin, dirtyEnd - dirtyBegin);
+	}
+	dirtyBegin = 0;
+	dirtyEnd = 0;
+}
+
+void Djinn::Buffer::Invalidate(Djinn::Context* p_context, const VkDeviceSize offset, const VkDeviceSize dataSize) const
+{
+	p_context->p_allocator->Invalidate(allocation, offset, dataSize);
 }
 
-void Djinn::createBuffer(Djinn::Context* p_context, const VkDeviceSize size, const VkDeviceSize offset,
+void Djinn::createBuffer(Djinn::Context* p_context, const VkDeviceSize size,
 	VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, const VkSharingMode sharingMode,
-	VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+	VkBuffer& buffer, VulkanAllocation_t& allocation, const VkMemoryPropertyFlags preferredProperties)
 {
 	//QueueFamilyIndices queueFamilyIndices{ findQueueFamilies(p_context->physicalDevice, p_context->surface) };
 	Djinn::Array1D<uint32_t, 2> queueFamilies{ p_context->queueFamilyIndices.graphicsFamily.value(), p_context->queueFamilyIndices.transferFamily.value() };
@@ -42,52 +88,47 @@ void Djinn::createBuffer(Djinn::Context* p_context, const VkDeviceSize size, con
 	auto result{ vkCreateBuffer(p_context->gpuInfo.device, &bufferCreateInfo, nullptr, &buffer) };
 	DJINN_VK_ASSERT(result);
 
-	VkMemoryRequirements memRequirements;
-	vkGetBufferMemoryRequirements(p_context->gpuInfo.device, buffer, &memRequirements);
-
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = findMemoryType(p_context, memRequirements.memoryTypeBits, properties);
-
-	// TODO : make custom allocator that manages this memory and passes offsets
-	result = vkAllocateMemory(p_context->gpuInfo.device, &allocInfo, nullptr, &bufferMemory);
-	DJINN_VK_ASSERT(result);
-
-	vkBindBufferMemory(p_context->gpuInfo.device, buffer, bufferMemory, offset);
+	allocateBufferMemory(p_context, buffer, properties, allocation, preferredProperties);
 }
 
 void Djinn::copyBuffer(Context* p_context, VkBuffer srcBuffer, VkBuffer dstBuffer, const VkDeviceSize size)
 {
-	VkCommandBuffer commandBuffer{ beginSingleTimeCommands(p_context, p_context->transferCommandPool) };
-
-	VkBufferCopy copyRegion;
-	copyRegion.srcOffset = 0;
-	copyRegion.dstOffset = 0;
-	copyRegion.size = size;
-	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-	endSingleTimeCommands(p_context, p_context->transferCommandPool, commandBuffer, p_context->transferQueue);
-
+	p_context->p_uploads->CopyBuffer(srcBuffer, dstBuffer, size);
 }
 
 void Djinn::copyBuffer(Context* p_context, Buffer srcBuffer, Buffer dstBuffer, const VkDeviceSize size)
 {
-	VkCommandBuffer commandBuffer{ beginSingleTimeCommands(p_context, p_context->transferCommandPool) };
-
-	VkBufferCopy copyRegion;
-	copyRegion.srcOffset = 0;
-	copyRegion.dstOffset = 0;
-	copyRegion.size = size;
-	vkCmdCopyBuffer(commandBuffer, srcBuffer.buffer, dstBuffer.buffer, 1, &copyRegion);
+	p_context->p_uploads->CopyBuffer(srcBuffer.buffer, dstBuffer.buffer, size);
+}
 
-	endSingleTimeCommands(p_context, p_context->transferCommandPool, commandBuffer, p_context->transferQueue);
+void Djinn::copyDataToMappedBuffer(Djinn::Context* p_context, Djinn::Buffer& stagingBuffer, const VkDeviceSize bufferSize, const VkDeviceSize offset, const void* src)
+{
+	stagingBuffer.Write(offset, bufferSize, src);
+	stagingBuffer.Flush(p_context);
 }
 
-void Djinn::copyDataToMappedBuffer(Djinn::Context* p_context, Djinn::Buffer& stagingBuffer, const VkDeviceSize bufferSize, const VkDeviceSize offset, void* src)
+void Djinn::uploadDeviceLocal(Djinn::Context* p_context, Djinn::Buffer& buffer, const VkBufferUsageFlags usage, const VkSharingMode sharingMode,
+	std::span<const std::byte> bytes)
 {
-	void* dest;
-	vkMapMemory(p_context->gpuInfo.device, stagingBuffer.bufferMemory, 0, bufferSize, 0, &dest);
-	memcpy(dest, src, static_cast<size_t>(bufferSize));
-	vkUnmapMemory(p_context->gpuInfo.device, stagingBuffer.bufferMemory);
-}
\ No newline at end of file
+	const VkDeviceSize bufferSize{ bytes.size() };
+
+	BufferCreateInfo bufferCreateInfo{};
+	bufferCreateInfo.size = bufferSize;
+	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage;
+	bufferCreateInfo.properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	bufferCreateInfo.preferredProperties = preferDirectUpload(p_context, bufferSize) ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT : 0;
+	bufferCreateInfo.sharingMode = sharingMode;
+	buffer.Init(p_context, bufferCreateInfo);
+
+	// landed in mappable memory, host writes are visible to every later submission once flushed
+	if (buffer.allocation.data != nullptr)
+	{
+		buffer.Write(0, bufferSize, bytes.data());
+		buffer.Flush(p_context);
+		p_context->uploadStats.directBytes += bufferSize;
+		return;
+	}
+
+	p_context->p_uploads->CopyToBuffer(buffer.buffer, 0, bytes);
+	p_context->uploadStats.stagedBytes += bufferSize;
+}
@@ -4,16 +4,19 @@
 #include <vulkan/vulkan.h>
 #include "Context.h"
 #include "SwapChain.h"
-#include "Commands.h"
+#include "Memory.h"
+
+#include <cstddef>
+#include <span>
 
 namespace Djinn
 {
 	struct BufferCreateInfo
 	{
 		VkDeviceSize size{ 0 };
-		VkDeviceSize offset {0};
 		VkBufferUsageFlags usage{0};
 		VkMemoryPropertyFlags properties{ 0 };
+		VkMemoryPropertyFlags preferredProperties{ 0 };	// added to properties when the buffer can live in such memory
 		VkSharingMode sharingMode{ VK_SHARING_MODE_CONCURRENT };
 	};
 
@@ -26,18 +29,37 @@ namespace Djinn
 		void Init(Djinn::Context* p_context, const BufferCreateInfo createInfo);
 		void CleanUp(Djinn::Context* p_context);
 
+		// host visible buffers are mapped once at creation, writes go straight to the mapping
+		// on memory that isn't HOST_COHERENT the written span is gathered and Flush sends it in one vkFlushMappedMemoryRanges
+		void Write(const VkDeviceSize offset, const VkDeviceSize dataSize, const void* src);
+		void Flush(Djinn::Context* p_context);
+		// before reading what the device wrote to [offset, offset + dataSize)
+		void Invalidate(Djinn::Context* p_context, const VkDeviceSize offset, const VkDeviceSize dataSize) const;
+
 		VkBuffer buffer {VK_NULL_HANDLE};
-		VkDeviceMemory bufferMemory{VK_NULL_HANDLE};
+		VulkanAllocation_t allocation{};
 		VkDeviceSize size{ 0 };
+
+	private:
+		// bytes written since the last Flush, empty when dirtyBegin == dirtyEnd
+		VkDeviceSize dirtyBegin{ 0 };
+		VkDeviceSize dirtyEnd{ 0 };
 	};
 
-	void createBuffer(Djinn::Context* p_context, const VkDeviceSize size, const VkDeviceSize offset,
+	void createBuffer(Djinn::Context* p_context, const VkDeviceSize size,
 		VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, const VkSharingMode sharingMode,
-		VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+		VkBuffer& buffer, VulkanAllocation_t& allocation, const VkMemoryPropertyFlags preferredProperties = 0);
+
+	// creates a device local buffer holding bytes, usage gets TRANSFER_DST added
+	// uploads that fit the policy go to DEVICE_LOCAL | HOST_VISIBLE memory and are written in place, the rest through a staging copy
+	// the copy is recorded into the open upload batch, where the bytes went is counted in the context's uploadStats
+	void uploadDeviceLocal(Djinn::Context* p_context, Djinn::Buffer& buffer, const VkBufferUsageFlags usage, const VkSharingMode sharingMode,
+		std::span<const std::byte> bytes);
 
+	// recorded into the open upload batch, both buffers have to outlive it
 	void copyBuffer(Djinn::Context* p_context, VkBuffer srcBuffer, VkBuffer dstBuffer, const VkDeviceSize size);
 	void copyBuffer(Djinn::Context* p_context, Djinn::Buffer srcBuffer, Djinn::Buffer dstBuffer, const VkDeviceSize size);
-	void copyDataToMappedBuffer(Djinn::Context* p_context, Djinn::Buffer& stagingBuffer, const VkDeviceSize bufferSize, const VkDeviceSize offset, void* src);
+	void copyDataToMappedBuffer(Djinn::Context* p_context, Djinn::Buffer& stagingBuffer, const VkDeviceSize bufferSize, const VkDeviceSize offset, const void* src);
 
 }
 
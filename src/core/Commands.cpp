@@ -1,36 +0,0 @@
-#include "Commands.h"
-
-VkCommandBuffer Djinn::beginSingleTimeCommands(Context* p_context, VkCommandPool& commandPool)
-{
-	VkCommandBufferAllocateInfo allocateInfo{};
-	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocateInfo.commandPool = commandPool;
-	allocateInfo.commandBufferCount = 1;
-
-	VkCommandBuffer commandBuffer;
-	vkAllocateCommandBuffers(p_context->gpuInfo.device, &allocateInfo, &commandBuffer);
-
-	VkCommandBufferBeginInfo beginInfo{};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-	return commandBuffer;
-}
-
-void Djinn::endSingleTimeCommands(Context* p_context, VkCommandPool& commandPool, VkCommandBuffer commandBuffer, VkQueue submitQueue)
-{
-	vkEndCommandBuffer(commandBuffer);
-
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
-
-	vkQueueSubmit(submitQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(submitQueue);
-
-	vkFreeCommandBuffers(p_context->gpuInfo.device, commandPool, 1, &commandBuffer);
-}
\ No newline at end of file
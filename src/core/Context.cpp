@@ -467,6 +467,12 @@ VkPhysicalDeviceFeatures Djinn::Context::populateDeviceFeatures()
 	// enable wireframe
 	deviceFeatures.fillModeNonSolid = VK_TRUE;
 
+	// block compressed textures, optional
+	VkPhysicalDeviceFeatures supportedFeatures{};
+	vkGetPhysicalDeviceFeatures(gpuInfo.gpu, &supportedFeatures);
+	deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+	gpuInfo.textureCompressionBC = supportedFeatures.textureCompressionBC == VK_TRUE;
+
 	return deviceFeatures;
 }
 
@@ -7,6 +7,7 @@
 #include "defs.h"
 #include "core.h"
 #include "IO.h"
+#include "BlockCompression.h"
 #include <vector>
 #include <vulkan/vulkan.h>
 
@@ -14,9 +15,41 @@
 
 namespace Djinn
 {
+	class VulkanAllocator;
+	class UploadContext;
+
 	struct RendererConfig
 	{
 		VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT; // default to 1 sample
+		bool compactVertices{ false };		// quantized 16 byte vertices when the mesh allows it
+		bool splitPositions{ false };		// positions in their own vertex stream, depth only passes fetch nothing else
+		bool depthPrepass{ false };			// lay down depth with a position only pass before shading
+		float lodPixelError{ 1.0f };		// coarsest LOD whose error stays under this many pixels is drawn
+		// falls back to RGBA8 when the device has no BC support, BC1 is upgraded to BC3 for textures with alpha
+		// grey sources stay R8 / RG8 unless the requested format is smaller
+		TextureFormat textureFormat{ TextureFormat::TEXTURE_FORMAT_BC7 };
+		// bytes of texture mips uploaded per frame while a texture streams in, at least one level always goes up
+		uint64_t textureUploadBudget{ 4 << 20 };
+		// sample the texture through a fixed cache of pages filled from a low resolution feedback pass, see core/VirtualTexture.h
+		bool virtualTexturing{ false };
+		uint32_t virtualCacheSlots{ 16 };	// the page cache is this many pages on a side, at most 256
+		uint32_t virtualPageBudget{ 16 };	// pages uploaded per frame
+		// device memory is reserved per memory type in blocks of these sizes and sub-allocated, see core/Memory.h
+		VkDeviceSize deviceLocalBlockSize{ 256ull << 20 };
+		VkDeviceSize hostVisibleBlockSize{ 64ull << 20 };
+		// bytes of uniform and per draw data a frame can push through the frame ring
+		VkDeviceSize frameDataSize{ 256 << 10 };
+		// largest buffer uploadDeviceLocal writes in place when device local memory is only mappable through a small BAR window
+		VkDeviceSize directUploadLimit{ 4 << 20 };
+		// staging ring the upload context records copies from, larger uploads get a staging buffer of their own
+		VkDeviceSize uploadStagingSize{ 32ull << 20 };
+	};
+
+	// bytes uploadDeviceLocal wrote straight into the final buffer and bytes that went through a staging copy
+	struct UploadStats
+	{
+		uint64_t directBytes{ 0 };
+		uint64_t stagedBytes{ 0 };
 	};
 
 	struct GPU_Info
@@ -25,6 +58,7 @@ namespace Djinn
 		VkDevice device;
 		VkPhysicalDeviceMemoryProperties memProperties;
 		VkPhysicalDeviceProperties gpuProperties;
+		bool textureCompressionBC{ false };
 	};
 
 	class Context
@@ -62,6 +96,11 @@ namespace Djinn
 		VkSurfaceKHR surface{ VK_NULL_HANDLE };
 
 		GPU_Info gpuInfo{};
+		// owned by the engine, every Buffer and Image takes its memory from here
+		VulkanAllocator* p_allocator{ nullptr };
+		UploadStats uploadStats{};
+		// owned by the engine, staged copies are recorded here and go to the GPU with the next frame
+		UploadContext* p_uploads{ nullptr };
 		QueueFamilyIndices queueFamilyIndices;
 
 		VkQueue graphicsQueue{ VK_NULL_HANDLE };
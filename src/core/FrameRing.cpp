@@ -0,0 +1,69 @@
+#include "FrameRing.h"
+
+#include <algorithm>
+
+void Djinn::FrameRing::Init(Context* p_context, const VkDeviceSize size, const uint32_t count, const VkBufferUsageFlags usage,
+	const VkSharingMode sharingMode)
+{
+	// every range starts at an offset the descriptor types the buffer is used as can take
+	const VkPhysicalDeviceLimits& limits{ p_context->gpuInfo.gpuProperties.limits };
+	alignment = 1;
+	if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+	{
+		alignment = std::max(alignment, limits.minUniformBufferOffsetAlignment);
+	}
+	if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+	{
+		alignment = std::max(alignment, limits.minStorageBufferOffsetAlignment);
+	}
+
+	regionSize = (size + alignment - 1) & ~(alignment - 1);
+	regionCount = count;
+	// dynamic offsets are 32 bit
+	assert(regionSize * regionCount <= UINT32_MAX);
+
+	BufferCreateInfo createInfo{};
+	createInfo.size = regionSize * regionCount;
+	createInfo.usage = usage;
+	createInfo.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	createInfo.sharingMode = sharingMode;
+	buffer.Init(p_context, createInfo);
+
+	BeginFrame(0);
+}
+
+void Djinn::FrameRing::CleanUp(Context* p_context)
+{
+	buffer.CleanUp(p_context);
+	buffer = {};
+}
+
+void Djinn::FrameRing::BeginFrame(const uint32_t region)
+{
+	assert(region < regionCount);
+	regionStart = region * regionSize;
+	head = regionStart;
+}
+
+Djinn::byte* Djinn::FrameRing::Allocate(const VkDeviceSize allocSize, uint32_t& offset)
+{
+	const VkDeviceSize start{ (head + alignment - 1) & ~(alignment - 1) };
+	if (start + allocSize > regionStart + regionSize)
+	{
+		return nullptr;
+	}
+
+	head = start + allocSize;
+	offset = static_cast<uint32_t>(start);
+	return buffer.allocation.data + start;
+}
+
+void Djinn::FrameRing::Flush(Context* p_context)
+{
+	p_context->p_allocator->Flush(buffer.allocation, regionStart, head - regionStart);
+}
+
+VkDeviceSize Djinn::FrameRing::Used() const
+{
+	return head - regionStart;
+}
@@ -0,0 +1,52 @@
+#ifndef FRAME_RING_INCLUDE_H
+#define FRAME_RING_INCLUDE_H
+
+#include "Buffer.h"
+
+#include <cstring>
+
+namespace Djinn
+{
+	// one persistently mapped buffer cut into a region per frame, a frame hands out aligned ranges of its region with a pointer bump
+	// ranges are bound through dynamic descriptor offsets, the descriptor sets never change
+	// BeginFrame may only start a region over once the submission that last read it has finished
+	class FrameRing
+	{
+	public:
+		// count regions of at least size bytes each
+		void Init(Context* p_context, const VkDeviceSize size, const uint32_t count, const VkBufferUsageFlags usage,
+			const VkSharingMode sharingMode);
+		void CleanUp(Context* p_context);
+
+		void BeginFrame(const uint32_t region);
+		// nullptr when the frame's region is full, offset is from the start of the buffer and goes straight into vkCmdBindDescriptorSets
+		byte* Allocate(const VkDeviceSize allocSize, uint32_t& offset);
+
+		template <typename T>
+		uint32_t Push(const T& value)
+		{
+			uint32_t offset{ 0 };
+			byte* dest{ Allocate(sizeof(T), offset) };
+			assert(dest != nullptr);
+			memcpy(dest, &value, sizeof(T));
+			return offset;
+		}
+
+		// everything pushed this frame in one flush, nothing to do on coherent memory
+		void Flush(Context* p_context);
+
+		// bytes of the current region handed out so far, padding included
+		VkDeviceSize Used() const;
+
+		Buffer buffer;
+
+	private:
+		VkDeviceSize regionSize{ 0 };
+		uint32_t regionCount{ 0 };
+		VkDeviceSize alignment{ 1 };
+		VkDeviceSize head{ 0 };
+		VkDeviceSize regionStart{ 0 };
+	};
+}
+
+#endif // FRAME_RING_INCLUDE_H
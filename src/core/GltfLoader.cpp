@@ -0,0 +1,318 @@
+#include "GltfLoader.h"
+#include "Json.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	struct GlbHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t length;
+	};
+
+	struct GlbChunkHeader
+	{
+		uint32_t length;
+		uint32_t type;
+	};
+
+	constexpr uint32_t GLTF_MODE_TRIANGLES{ 4 };
+
+	uint32_t componentCount(const std::string& type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		return 0;
+	}
+
+	template <typename T>
+	T readComponent(const uint8_t* p)
+	{
+		T value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	// 0 when the key is missing, -1 when its value isn't an integer Integer can represent
+	int64_t optionalSize(const Djinn::JsonValue& json, std::string_view key)
+	{
+		return json.Find(key) == nullptr ? 0 : json.Integer(key, -1);
+	}
+
+	// -1 when the key is missing, INT32_MAX when its value isn't an index an int32_t holds, past any accessor count so
+	// a bad reference fails the lookup instead of passing as a missing one
+	int32_t optionalIndex(const Djinn::JsonValue& json, std::string_view key)
+	{
+		if (json.Find(key) == nullptr)
+		{
+			return -1;
+		}
+		const int64_t index{ json.Integer(key, -1) };
+		return index >= 0 && index <= INT32_MAX ? static_cast<int32_t>(index) : INT32_MAX;
+	}
+
+	// resolves an accessor through its view, false for layouts the loader doesn't read
+	bool resolveAccessor(const Djinn::JsonValue& json, const Djinn::JsonValue* views, const uint64_t binarySize, Djinn::GltfAccessor& accessor)
+	{
+		const int64_t viewIndex{ json.Integer("bufferView", -1) };
+		const int64_t count{ json.Integer("count", -1) };
+		const int64_t byteOffset{ optionalSize(json, "byteOffset") };
+		if (json.Find("sparse") != nullptr || viewIndex < 0 || views == nullptr || static_cast<size_t>(viewIndex) >= views->elements.size())
+		{
+			return false;
+		}
+		const Djinn::JsonValue& view{ views->elements[static_cast<size_t>(viewIndex)] };
+		const int64_t viewOffset{ optionalSize(view, "byteOffset") };
+		const int64_t viewLength{ view.Integer("byteLength", -1) };
+		const int64_t viewStride{ optionalSize(view, "byteStride") };
+		if (view.Integer("buffer", 0) != 0 || count < 0 || count > UINT32_MAX || byteOffset < 0 || viewOffset < 0 || viewLength < 0 ||
+			viewStride < 0 || viewStride > UINT32_MAX)
+		{
+			return false;
+		}
+
+		const Djinn::JsonValue* type{ json.Find("type") };
+		accessor.components = type != nullptr ? componentCount(type->string) : 0;
+		// anything past uint32_t would wrap onto a valid type, 0 has no component size
+		const int64_t componentType{ json.Integer("componentType", 0) };
+		accessor.componentType = static_cast<Djinn::GltfComponentType>(componentType >= 0 && componentType <= UINT32_MAX ? componentType : 0);
+		accessor.count = static_cast<uint32_t>(count);
+		const Djinn::JsonValue* normalized{ json.Find("normalized") };
+		accessor.normalized = normalized != nullptr && normalized->boolean;
+		if (accessor.components == 0 || Djinn::gltfComponentSize(accessor.componentType) == 0)
+		{
+			return false;
+		}
+
+		accessor.offset = static_cast<uint64_t>(viewOffset) + static_cast<uint64_t>(byteOffset);
+		accessor.stride = viewStride != 0 ? static_cast<uint32_t>(viewStride) : accessor.ElementSize();
+		if (accessor.stride < accessor.ElementSize())
+		{
+			return false;
+		}
+
+		// the last element has to end inside both the view and the chunk
+		const uint64_t extent{ accessor.count == 0 ? 0 : static_cast<uint64_t>(accessor.count - 1) * accessor.stride + accessor.ElementSize() };
+		const uint64_t viewEnd{ static_cast<uint64_t>(viewOffset) + static_cast<uint64_t>(viewLength) };
+		if (viewEnd > binarySize || accessor.offset > viewEnd || extent > viewEnd - accessor.offset)
+		{
+			return false;
+		}
+
+		const Djinn::JsonValue* min{ json.Find("min") };
+		const Djinn::JsonValue* max{ json.Find("max") };
+		accessor.hasBounds = min != nullptr && max != nullptr && min->elements.size() >= 3 && max->elements.size() >= 3;
+		for (size_t i = 0; accessor.hasBounds && i < 3; ++i)
+		{
+			accessor.min[i] = static_cast<float>(min->elements[i].number);
+			accessor.max[i] = static_cast<float>(max->elements[i].number);
+		}
+		return true;
+	}
+}
+
+uint32_t Djinn::gltfComponentSize(const GltfComponentType type)
+{
+	switch (type)
+	{
+	case GltfComponentType::GLTF_COMPONENT_BYTE:
+	case GltfComponentType::GLTF_COMPONENT_UNSIGNED_BYTE:
+		return 1;
+	case GltfComponentType::GLTF_COMPONENT_SHORT:
+	case GltfComponentType::GLTF_COMPONENT_UNSIGNED_SHORT:
+		return 2;
+	case GltfComponentType::GLTF_COMPONENT_UNSIGNED_INT:
+	case GltfComponentType::GLTF_COMPONENT_FLOAT:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+bool Djinn::GltfFile::Open(const std::string& path)
+{
+	Close();
+	if (!file.Open(path) || file.Size() < sizeof(GlbHeader) + sizeof(GlbChunkHeader))
+	{
+		spdlog::error("Cannot open {}", path);
+		return false;
+	}
+
+	const uint8_t* data{ file.Data() };
+	const auto header{ readComponent<GlbHeader>(data) };
+	// the declared length is what the chunks are bounded by, it has to cover the JSON chunk header and stay inside the mapping
+	if (header.magic != GLB_MAGIC || header.version != GLB_VERSION || header.length > file.Size() ||
+		header.length < sizeof(GlbHeader) + sizeof(GlbChunkHeader))
+	{
+		spdlog::error("{} is not a glTF 2.0 binary", path);
+		return false;
+	}
+
+	// the JSON chunk comes first, the optional BIN chunk right after it
+	uint64_t cursor{ sizeof(GlbHeader) };
+	const auto jsonChunk{ readComponent<GlbChunkHeader>(data + cursor) };
+	cursor += sizeof(GlbChunkHeader);
+	if (jsonChunk.type != GLB_CHUNK_JSON || jsonChunk.length > header.length - cursor)
+	{
+		spdlog::error("{} has no JSON chunk", path);
+		return false;
+	}
+	const std::string_view jsonText{ reinterpret_cast<const char*>(data + cursor), jsonChunk.length };
+	cursor += jsonChunk.length;
+
+	if (cursor + sizeof(GlbChunkHeader) <= header.length)
+	{
+		const auto binChunk{ readComponent<GlbChunkHeader>(data + cursor) };
+		cursor += sizeof(GlbChunkHeader);
+		if (binChunk.type == GLB_CHUNK_BIN && binChunk.length <= header.length - cursor)
+		{
+			binary = { data + cursor, binChunk.length };
+		}
+	}
+
+	JsonValue json;
+	if (!parseJson(jsonText, json) || !json.IsObject())
+	{
+		spdlog::error("Malformed glTF JSON in {}", path);
+		return false;
+	}
+
+	const JsonValue* views{ json.Find("bufferViews") };
+	if (const JsonValue* list{ json.Find("accessors") })
+	{
+		accessors.resize(list->elements.size());
+		for (size_t i = 0; i < accessors.size(); ++i)
+		{
+			if (!resolveAccessor(list->elements[i], views, binary.size(), accessors[i]))
+			{
+				// sparse accessors, external buffers and views past the chunk aren't read, they end up empty
+				accessors[i] = {};
+			}
+		}
+	}
+
+	const auto usable{ [this](const int32_t index) { return index < 0 || (static_cast<size_t>(index) < accessors.size() && accessors[static_cast<size_t>(index)].components != 0); } };
+	const auto scalarIndices{ [this](const int32_t index)
+		{
+			if (index < 0)
+			{
+				return true;
+			}
+			const GltfAccessor& accessor{ accessors[static_cast<size_t>(index)] };
+			return accessor.components == 1 && accessor.componentType != GltfComponentType::GLTF_COMPONENT_FLOAT &&
+				accessor.componentType != GltfComponentType::GLTF_COMPONENT_BYTE && accessor.componentType != GltfComponentType::GLTF_COMPONENT_SHORT;
+		} };
+	if (const JsonValue* meshes{ json.Find("meshes") })
+	{
+		for (const JsonValue& mesh : meshes->elements)
+		{
+			const JsonValue* list{ mesh.Find("primitives") };
+			for (size_t i = 0; list != nullptr && i < list->elements.size(); ++i)
+			{
+				const JsonValue& primitive{ list->elements[i] };
+				const JsonValue* attributes{ primitive.Find("attributes") };
+				if (primitive.Integer("mode", GLTF_MODE_TRIANGLES) != GLTF_MODE_TRIANGLES || attributes == nullptr)
+				{
+					continue;
+				}
+
+				GltfPrimitive triangles{};
+				triangles.position = optionalIndex(*attributes, "POSITION");
+				triangles.normal = optionalIndex(*attributes, "NORMAL");
+				triangles.texCoord = optionalIndex(*attributes, "TEXCOORD_0");
+				triangles.color = optionalIndex(*attributes, "COLOR_0");
+				triangles.indices = optionalIndex(primitive, "indices");
+				triangles.material = optionalIndex(primitive, "material");
+				if (triangles.position < 0 || !usable(triangles.position) || !usable(triangles.normal) || !usable(triangles.texCoord) ||
+					!usable(triangles.color) || !usable(triangles.indices) || !scalarIndices(triangles.indices))
+				{
+					spdlog::warn("{} has a primitive with accessors that can't be read, skipping it", path);
+					continue;
+				}
+				primitives.push_back(triangles);
+			}
+		}
+	}
+
+	if (primitives.empty())
+	{
+		spdlog::error("{} has no triangles", path);
+		return false;
+	}
+	return true;
+}
+
+void Djinn::GltfFile::Close()
+{
+	file.Close();
+	binary = {};
+	accessors.clear();
+	primitives.clear();
+}
+
+std::span<const uint8_t> Djinn::GltfFile::Binary() const
+{
+	return binary;
+}
+
+std::span<const Djinn::GltfAccessor> Djinn::GltfFile::Accessors() const
+{
+	return accessors;
+}
+
+std::span<const Djinn::GltfPrimitive> Djinn::GltfFile::Primitives() const
+{
+	return primitives;
+}
+
+void Djinn::GltfFile::ReadFloats(const GltfAccessor& accessor, const uint32_t element, float* values) const
+{
+	const uint8_t* p{ binary.data() + accessor.offset + static_cast<uint64_t>(element) * accessor.stride };
+	const uint32_t size{ gltfComponentSize(accessor.componentType) };
+	for (uint32_t c = 0; c < accessor.components; ++c, p += size)
+	{
+		const bool normalized{ accessor.normalized };
+		switch (accessor.componentType)
+		{
+		case GltfComponentType::GLTF_COMPONENT_BYTE:
+			values[c] = normalized ? std::max(readComponent<int8_t>(p) / 127.0f, -1.0f) : readComponent<int8_t>(p);
+			break;
+		case GltfComponentType::GLTF_COMPONENT_UNSIGNED_BYTE:
+			values[c] = normalized ? readComponent<uint8_t>(p) / 255.0f : readComponent<uint8_t>(p);
+			break;
+		case GltfComponentType::GLTF_COMPONENT_SHORT:
+			values[c] = normalized ? std::max(readComponent<int16_t>(p) / 32767.0f, -1.0f) : readComponent<int16_t>(p);
+			break;
+		case GltfComponentType::GLTF_COMPONENT_UNSIGNED_SHORT:
+			values[c] = normalized ? readComponent<uint16_t>(p) / 65535.0f : readComponent<uint16_t>(p);
+			break;
+		case GltfComponentType::GLTF_COMPONENT_UNSIGNED_INT:
+			values[c] = static_cast<float>(readComponent<uint32_t>(p));
+			break;
+		case GltfComponentType::GLTF_COMPONENT_FLOAT:
+			values[c] = readComponent<float>(p);
+			break;
+		}
+	}
+}
+
+uint32_t Djinn::GltfFile::ReadIndex(const GltfAccessor& accessor, const uint32_t element) const
+{
+	const uint8_t* p{ binary.data() + accessor.offset + static_cast<uint64_t>(element) * accessor.stride };
+	switch (accessor.componentType)
+	{
+	case GltfComponentType::GLTF_COMPONENT_UNSIGNED_BYTE:
+		return readComponent<uint8_t>(p);
+	case GltfComponentType::GLTF_COMPONENT_UNSIGNED_SHORT:
+		return readComponent<uint16_t>(p);
+	default:
+		return readComponent<uint32_t>(p);
+	}
+}
@@ -0,0 +1,85 @@
+#ifndef GLTF_LOADER_INCLUDE_H
+#define GLTF_LOADER_INCLUDE_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "../DjinnLib/MappedFile.h"
+
+namespace Djinn
+{
+	constexpr uint32_t GLB_MAGIC{ 0x46546c67 };			// "glTF"
+	constexpr uint32_t GLB_VERSION{ 2 };
+	constexpr uint32_t GLB_CHUNK_JSON{ 0x4e4f534a };	// "JSON"
+	constexpr uint32_t GLB_CHUNK_BIN{ 0x004e4942 };		// "BIN\0"
+
+	enum class GltfComponentType : uint32_t
+	{
+		GLTF_COMPONENT_BYTE = 5120,
+		GLTF_COMPONENT_UNSIGNED_BYTE = 5121,
+		GLTF_COMPONENT_SHORT = 5122,
+		GLTF_COMPONENT_UNSIGNED_SHORT = 5123,
+		GLTF_COMPONENT_UNSIGNED_INT = 5125,
+		GLTF_COMPONENT_FLOAT = 5126
+	};
+
+	uint32_t gltfComponentSize(const GltfComponentType type);
+
+	// an accessor resolved through its buffer view, offset is bytes into the binary chunk
+	struct GltfAccessor
+	{
+		uint64_t offset{ 0 };
+		uint32_t count{ 0 };
+		uint32_t stride{ 0 };		// the view's byteStride, or the element size when the view is tightly packed
+		GltfComponentType componentType{ GltfComponentType::GLTF_COMPONENT_FLOAT };
+		uint32_t components{ 0 };
+		bool normalized{ false };
+		// required for positions by the spec, not every exporter writes them
+		bool hasBounds{ false };
+		float min[3]{};
+		float max[3]{};
+
+		uint32_t ElementSize() const { return components * gltfComponentSize(componentType); }
+		// tightly packed, the data can be used as a plain array
+		bool Packed() const { return stride == ElementSize(); }
+	};
+
+	// a triangle list, accessor indices are -1 for attributes the primitive doesn't have
+	struct GltfPrimitive
+	{
+		int32_t position{ -1 };
+		int32_t normal{ -1 };
+		int32_t texCoord{ -1 };
+		int32_t color{ -1 };
+		int32_t indices{ -1 };
+		int32_t material{ -1 };
+	};
+
+	// a .glb mapped whole, the JSON chunk is parsed and every accessor bounds checked, vertex data isn't touched
+	// only buffer 0 (the binary chunk) is supported, node transforms are ignored
+	class GltfFile
+	{
+	public:
+		bool Open(const std::string& path);
+		void Close();
+
+		std::span<const uint8_t> Binary() const;
+		std::span<const GltfAccessor> Accessors() const;
+		// the triangle primitives of every mesh, points and lines are skipped
+		std::span<const GltfPrimitive> Primitives() const;
+
+		// element of an accessor as floats, normalized integers map to [0, 1] or [-1, 1]
+		void ReadFloats(const GltfAccessor& accessor, const uint32_t element, float* values) const;
+		uint32_t ReadIndex(const GltfAccessor& accessor, const uint32_t element) const;
+
+	private:
+		MappedFile file;
+		std::span<const uint8_t> binary;
+		std::vector<GltfAccessor> accessors;
+		std::vector<GltfPrimitive> primitives;
+	};
+}
+
+#endif // GLTF_LOADER_INCLUDE_H
@@ -20,6 +20,12 @@ Djinn::GraphicsPipeline Djinn::GraphicsPipelineBuilder::BuildPipeline(Djinn::Con
 	VkPipelineLayout newPipelineLayout{ VK_NULL_HANDLE };
 	viewport = initViewPort(p_swapchain);
 	scissor = initScissor(p_swapchain);
+	if (config.extent.width != 0)
+	{
+		viewport.width = static_cast<float>(config.extent.width);
+		viewport.height = static_cast<float>(config.extent.height);
+		scissor.extent = config.extent;
+	}
 
 	//std::vector<ShaderLoader> shaderLoaders;
 	//for (const auto& createInfo : config.shaderLoadersCreateInfo)
@@ -33,6 +39,25 @@ Djinn::GraphicsPipeline Djinn::GraphicsPipelineBuilder::BuildPipeline(Djinn::Con
 		shaderStageInfo.push_back(initPipelineShaderStageCreateInfo(shaderLoader));
 	}
 
+	if (!config.vertexBindings.empty())
+	{
+		vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(config.vertexBindings.size());
+		vertexInputInfo.pVertexBindingDescriptions = config.vertexBindings.data();
+		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(config.vertexAttributes.size());
+		vertexInputInfo.pVertexAttributeDescriptions = config.vertexAttributes.data();
+	}
+
+	depthStencilCreateInfo.depthCompareOp = config.depthCompareOp;
+	if (!config.colorWrites)
+	{
+		colorBlendAttachment.colorWriteMask = 0;
+		colorBlendAttachment.blendEnable = VK_FALSE;
+	}
+	if (!config.blending)
+	{
+		colorBlendAttachment.blendEnable = VK_FALSE;
+	}
+
 	inputAssemblyInfo = initInputAssemblyCreateInfo(config.primitiveTopology);
 	rasterizerInfo = initRasterizationStateCreateInfo(config.polygonMode);
 	multisamplingInfo = initMultiSamplingStageCreateInfo(config.msaaSamples);
@@ -87,15 +112,15 @@ VkPipelineShaderStageCreateInfo Djinn::GraphicsPipelineBuilder::initPipelineShad
 
 VkPipelineVertexInputStateCreateInfo Djinn::GraphicsPipelineBuilder::initVertexInputStageCreateInfo()
 {
-	const static auto bindingDescription{ Vertex::getBindingDescription() };
-	const static auto attributeDescriptions{ Vertex::getAttributeDescriptions() };
+	constexpr static auto bindingDescription{ vertexBindingDescription<Vertex>() };
+	constexpr static auto attributeDescriptions{ vertexAttributeDescriptions<Vertex>() };
 
 	VkPipelineVertexInputStateCreateInfo info{};
 	info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 	info.vertexBindingDescriptionCount = 1;
 	info.pVertexBindingDescriptions = &bindingDescription;
-	info.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.NumElem());
-	info.pVertexAttributeDescriptions = attributeDescriptions.Ptr();
+	info.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+	info.pVertexAttributeDescriptions = attributeDescriptions.data();
 
 	return info;
 }
@@ -6,6 +6,7 @@
 
 #include "../DjinnLib/Array.h"
 #include "../ShaderLoader.h"
+#include "VertexLayout.h"
  
 namespace Djinn
 {
@@ -17,9 +18,25 @@ namespace Djinn
 		VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
 		VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
 		VkPrimitiveTopology primitiveTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+		bool colorWrites = true;		// false for depth only passes
+		bool blending = true;			// integer attachments can't blend
+		VkExtent2D extent{ 0, 0 };		// viewport and scissor, 0 = the swapchain extent
 		VkRenderPass renderPass;
 		std::vector<ShaderLoader> shaderLoaders;
 		std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
+		// empty = the full Vertex layout
+		std::vector<VkVertexInputBindingDescription> vertexBindings;
+		std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+
+		// vertex input for pipelines that always draw one vertex struct
+		template <typename VertexType>
+		void SetVertexLayout()
+		{
+			constexpr auto attributes{ vertexAttributeDescriptions<VertexType>() };
+			vertexBindings.assign(1, vertexBindingDescription<VertexType>());
+			vertexAttributes.assign(attributes.begin(), attributes.end());
+		}
 	};
 
 	struct GraphicsPipeline
@@ -13,7 +13,7 @@ void Djinn::Image::CleanUp(Context* p_context)
 {
 	vkDestroyImageView(p_context->gpuInfo.device, imageView, nullptr);
 	vkDestroyImage(p_context->gpuInfo.device, image, nullptr);
-	vkFreeMemory(p_context->gpuInfo.device, imageMemory, nullptr);
+	p_context->p_allocator->Free(allocation);
 }
 
 void Djinn::Image::Init(Context* p_context, const ImageCreateInfo& createInfo)
@@ -40,18 +40,7 @@ void Djinn::Image::Init(Context* p_context, const ImageCreateInfo& createInfo)
 	///////////////////////////////////////////////////////////////////////////////////////////////////////
 	// ALLOCATE IMAGE MEM
 
-	VkMemoryRequirements memRequirements;
-	vkGetImageMemoryRequirements(p_context->gpuInfo.device, image, &memRequirements);
-
-	VkMemoryAllocateInfo allocateInfo{};
-	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocateInfo.allocationSize = memRequirements.size;
-	allocateInfo.memoryTypeIndex = findMemoryType(p_context, memRequirements.memoryTypeBits, createInfo.memoryFlags);
-
-	result = vkAllocateMemory(p_context->gpuInfo.device, &allocateInfo, nullptr, &imageMemory);
-	DJINN_VK_ASSERT(result);
-
-	vkBindImageMemory(p_context->gpuInfo.device, image, imageMemory, 0);
+	allocateImageMemory(p_context, image, createInfo.tiling, createInfo.memoryFlags, allocation);
 
 	///////////////////////////////////////////////////////////////////////////////////////////////////////
 	// CREATE IMAGE VIEW
@@ -71,7 +60,7 @@ void Djinn::Image::Init(Context* p_context, const ImageCreateInfo& createInfo)
 	DJINN_VK_ASSERT(result);
 }
 
-void Djinn::createImage(Context* p_context, SwapChain* p_swapChain, const uint32_t width, const uint32_t height, const uint32_t mipLevels, const VkFormat format, const VkSampleCountFlagBits numSamples, const VkImageTiling tiling, const VkImageUsageFlags flags, const VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory)
+void Djinn::createImage(Context* p_context, SwapChain* p_swapChain, const uint32_t width, const uint32_t height, const uint32_t mipLevels, const VkFormat format, const VkSampleCountFlagBits numSamples, const VkImageTiling tiling, const VkImageUsageFlags flags, const VkMemoryPropertyFlags properties, VkImage& image, VulkanAllocation_t& allocation)
 {
 	VkImageCreateInfo imageCreateInfo{};
 	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -92,22 +81,11 @@ void Djinn::createImage(Context* p_context, SwapChain* p_swapChain, const uint32
 	auto result{ vkCreateImage(p_context->gpuInfo.device, &imageCreateInfo, nullptr, &image) };
 	DJINN_VK_ASSERT(result);
 
-	VkMemoryRequirements memRequirements;
-	vkGetImageMemoryRequirements(p_context->gpuInfo.device, image, &memRequirements);
-
-	VkMemoryAllocateInfo allocateInfo{};
-	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocateInfo.allocationSize = memRequirements.size;
-	allocateInfo.memoryTypeIndex = findMemoryType(p_context, memRequirements.memoryTypeBits, properties);
-
-	result = vkAllocateMemory(p_context->gpuInfo.device, &allocateInfo, nullptr, &imageMemory);
-	DJINN_VK_ASSERT(result);
-
-	result = vkBindImageMemory(p_context->gpuInfo.device, image, imageMemory, 0);
-	DJINN_VK_ASSERT(result);
+	allocateImageMemory(p_context, image, tiling, properties, allocation);
 }
 
-VkImageView Djinn::createImageView(Context* p_context, const VkImage image, const VkFormat format, const VkImageAspectFlags aspectFlags, const uint32_t mipLevels)
+VkImageView Djinn::createImageView(Context* p_context, const VkImage image, const VkFormat format, const VkImageAspectFlags aspectFlags, const uint32_t mipLevels,
+	const VkComponentMapping components)
 {
 	VkImageView imageView;
 
@@ -116,6 +94,7 @@ VkImageView Djinn::createImageView(Context* p_context, const VkImage image, cons
 	viewCreateInfo.image = image;
 	viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
 	viewCreateInfo.format = format;
+	viewCreateInfo.components = components;
 	viewCreateInfo.subresourceRange.aspectMask = aspectFlags;
 	viewCreateInfo.subresourceRange.baseMipLevel = 0;
 	viewCreateInfo.subresourceRange.levelCount = mipLevels;
@@ -127,3 +106,35 @@ VkImageView Djinn::createImageView(Context* p_context, const VkImage image, cons
 
 	return imageView;
 }
+
+VkFormat Djinn::textureVkFormat(const TextureFormat format, const bool srgb)
+{
+	switch (format)
+	{
+	case TextureFormat::TEXTURE_FORMAT_BC1:
+		return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+	case TextureFormat::TEXTURE_FORMAT_BC3:
+		return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+	case TextureFormat::TEXTURE_FORMAT_BC7:
+		return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+	case TextureFormat::TEXTURE_FORMAT_R8:
+		return srgb ? VK_FORMAT_R8_SRGB : VK_FORMAT_R8_UNORM;
+	case TextureFormat::TEXTURE_FORMAT_RG8:
+		return srgb ? VK_FORMAT_R8G8_SRGB : VK_FORMAT_R8G8_UNORM;
+	default:
+		return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+	}
+}
+
+VkComponentMapping Djinn::textureComponentMapping(const TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::TEXTURE_FORMAT_R8:
+		return { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_ONE };
+	case TextureFormat::TEXTURE_FORMAT_RG8:
+		return { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G };
+	default:
+		return {};
+	}
+}
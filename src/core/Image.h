@@ -6,14 +6,19 @@
 #include <vulkan/vulkan.h>
 #include "Context.h"
 #include "SwapChain.h"
+#include "Memory.h"
 
 
 namespace Djinn
 {
 	void createImage(Context* p_context, SwapChain* p_swapChain, const uint32_t width, const uint32_t height, const uint32_t mipLevels, const VkFormat format,
 		const VkSampleCountFlagBits numSamples, const VkImageTiling tiling, const VkImageUsageFlags flags,
-		const VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
-	VkImageView createImageView(Context* p_context, const VkImage image, const VkFormat format, const VkImageAspectFlags aspectFlags, const uint32_t mipLevels);
+		const VkMemoryPropertyFlags properties, VkImage& image, VulkanAllocation_t& allocation);
+	VkImageView createImageView(Context* p_context, const VkImage image, const VkFormat format, const VkImageAspectFlags aspectFlags, const uint32_t mipLevels,
+		const VkComponentMapping components = {});
+	VkFormat textureVkFormat(const TextureFormat format, const bool srgb);
+	// view swizzle that makes every format sample as RGBA, grey goes to all three color channels
+	VkComponentMapping textureComponentMapping(const TextureFormat format);
 
 	struct ImageCreateInfo
 	{
@@ -41,7 +46,7 @@ namespace Djinn
 	public:
 		VkImage image					{ VK_NULL_HANDLE };
 		VkImageView imageView			{ VK_NULL_HANDLE };
-		VkDeviceMemory imageMemory		{ VK_NULL_HANDLE };
+		VulkanAllocation_t allocation	{};
 	};
 }
 
@@ -0,0 +1,288 @@
+#include "Json.h"
+
+#include <charconv>
+#include <cmath>
+
+namespace
+{
+	constexpr uint32_t MAX_DEPTH{ 64 };
+
+	class JsonReader
+	{
+	public:
+		explicit JsonReader(std::string_view text)
+			: p(text.data()), end(text.data() + text.size())
+		{}
+
+		bool Document(Djinn::JsonValue& value)
+		{
+			if (!readValue(value, 0))
+			{
+				return false;
+			}
+			skipSpace();
+			return p == end;
+		}
+
+	private:
+		void skipSpace()
+		{
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+			{
+				++p;
+			}
+		}
+
+		bool literal(std::string_view word)
+		{
+			if (static_cast<size_t>(end - p) < word.size() || std::string_view{ p, word.size() } != word)
+			{
+				return false;
+			}
+			p += word.size();
+			return true;
+		}
+
+		bool readValue(Djinn::JsonValue& value, const uint32_t depth)
+		{
+			skipSpace();
+			if (p == end || depth > MAX_DEPTH)
+			{
+				return false;
+			}
+
+			switch (*p)
+			{
+			case '{':
+				return readObject(value, depth);
+			case '[':
+				return readArray(value, depth);
+			case '"':
+				value.type = Djinn::JsonType::JSON_STRING;
+				return readString(value.string);
+			case 't':
+				value.type = Djinn::JsonType::JSON_BOOL;
+				value.boolean = true;
+				return literal("true");
+			case 'f':
+				value.type = Djinn::JsonType::JSON_BOOL;
+				value.boolean = false;
+				return literal("false");
+			case 'n':
+				value.type = Djinn::JsonType::JSON_NULL;
+				return literal("null");
+			default:
+				return readNumber(value);
+			}
+		}
+
+		bool readObject(Djinn::JsonValue& value, const uint32_t depth)
+		{
+			value.type = Djinn::JsonType::JSON_OBJECT;
+			++p;
+			skipSpace();
+			if (p < end && *p == '}')
+			{
+				++p;
+				return true;
+			}
+
+			while (true)
+			{
+				skipSpace();
+				std::string key;
+				if (p == end || *p != '"' || !readString(key))
+				{
+					return false;
+				}
+				skipSpace();
+				if (p == end || *p++ != ':')
+				{
+					return false;
+				}
+
+				value.members.emplace_back(std::move(key), Djinn::JsonValue{});
+				if (!readValue(value.members.back().second, depth + 1))
+				{
+					return false;
+				}
+
+				skipSpace();
+				if (p == end)
+				{
+					return false;
+				}
+				if (*p == '}')
+				{
+					++p;
+					return true;
+				}
+				if (*p++ != ',')
+				{
+					return false;
+				}
+			}
+		}
+
+		bool readArray(Djinn::JsonValue& value, const uint32_t depth)
+		{
+			value.type = Djinn::JsonType::JSON_ARRAY;
+			++p;
+			skipSpace();
+			if (p < end && *p == ']')
+			{
+				++p;
+				return true;
+			}
+
+			while (true)
+			{
+				value.elements.emplace_back();
+				if (!readValue(value.elements.back(), depth + 1))
+				{
+					return false;
+				}
+
+				skipSpace();
+				if (p == end)
+				{
+					return false;
+				}
+				if (*p == ']')
+				{
+					++p;
+					return true;
+				}
+				if (*p++ != ',')
+				{
+					return false;
+				}
+			}
+		}
+
+		bool readNumber(Djinn::JsonValue& value)
+		{
+			value.type = Djinn::JsonType::JSON_NUMBER;
+			const auto [next, error] { std::from_chars(p, end, value.number) };
+			if (error != std::errc{} || next == p)
+			{
+				return false;
+			}
+			p = next;
+			return true;
+		}
+
+		void appendUtf8(std::string& out, const uint32_t codePoint)
+		{
+			if (codePoint < 0x80)
+			{
+				out += static_cast<char>(codePoint);
+			}
+			else if (codePoint < 0x800)
+			{
+				out += static_cast<char>(0xc0 | (codePoint >> 6));
+				out += static_cast<char>(0x80 | (codePoint & 0x3f));
+			}
+			else
+			{
+				out += static_cast<char>(0xe0 | (codePoint >> 12));
+				out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+				out += static_cast<char>(0x80 | (codePoint & 0x3f));
+			}
+		}
+
+		// surrogate pairs are written as two 3 byte sequences, names in a glTF header never need them
+		bool readString(std::string& out)
+		{
+			++p;
+			while (p < end && *p != '"')
+			{
+				if (*p != '\\')
+				{
+					out += *p++;
+					continue;
+				}
+
+				if (++p == end)
+				{
+					return false;
+				}
+				const char escaped{ *p++ };
+				switch (escaped)
+				{
+				case '"': out += '"'; break;
+				case '\\': out += '\\'; break;
+				case '/': out += '/'; break;
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				case 't': out += '\t'; break;
+				case 'u':
+				{
+					uint32_t codePoint{ 0 };
+					if (end - p < 4 || std::from_chars(p, p + 4, codePoint, 16).ptr != p + 4)
+					{
+						return false;
+					}
+					p += 4;
+					appendUtf8(out, codePoint);
+					break;
+				}
+				default:
+					return false;
+				}
+			}
+
+			if (p == end)
+			{
+				return false;
+			}
+			++p;
+			return true;
+		}
+
+		const char* p;
+		const char* end;
+	};
+}
+
+const Djinn::JsonValue* Djinn::JsonValue::Find(std::string_view key) const
+{
+	for (const auto& [name, value] : members)
+	{
+		if (name == key)
+		{
+			return &value;
+		}
+	}
+	return nullptr;
+}
+
+double Djinn::JsonValue::Number(std::string_view key, const double fallback) const
+{
+	const JsonValue* value{ Find(key) };
+	return value != nullptr && value->type == JsonType::JSON_NUMBER ? value->number : fallback;
+}
+
+int64_t Djinn::JsonValue::Integer(std::string_view key, const int64_t fallback) const
+{
+	const JsonValue* value{ Find(key) };
+	if (value == nullptr || value->type != JsonType::JSON_NUMBER)
+	{
+		return fallback;
+	}
+	// nan, inf and anything outside [-2^63, 2^63) have no int64 to cast to
+	const double n{ value->number };
+	if (!std::isfinite(n) || n < -9223372036854775808.0 || n >= 9223372036854775808.0)
+	{
+		return fallback;
+	}
+	return static_cast<int64_t>(n);
+}
+
+bool Djinn::parseJson(std::string_view text, JsonValue& value)
+{
+	value = {};
+	return JsonReader{ text }.Document(value);
+}
@@ -0,0 +1,46 @@
+#ifndef JSON_INCLUDE_H
+#define JSON_INCLUDE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Djinn
+{
+	enum class JsonType : uint32_t
+	{
+		JSON_NULL,
+		JSON_BOOL,
+		JSON_NUMBER,
+		JSON_STRING,
+		JSON_ARRAY,
+		JSON_OBJECT
+	};
+
+	// DOM of a small document like a glTF header, numbers are doubles and \u escapes are kept as UTF-8
+	struct JsonValue
+	{
+		JsonType type{ JsonType::JSON_NULL };
+		bool boolean{ false };
+		double number{ 0.0 };
+		std::string string;
+		std::vector<JsonValue> elements;
+		// in document order, lookups are linear
+		std::vector<std::pair<std::string, JsonValue>> members;
+
+		// nullptr if this isn't an object or has no such member
+		const JsonValue* Find(std::string_view key) const;
+		// the member as a number, fallback if it is missing or not a number
+		double Number(std::string_view key, const double fallback) const;
+		int64_t Integer(std::string_view key, const int64_t fallback) const;
+		bool IsArray() const { return type == JsonType::JSON_ARRAY; }
+		bool IsObject() const { return type == JsonType::JSON_OBJECT; }
+	};
+
+	// false on malformed input or nesting deeper than 64
+	bool parseJson(std::string_view text, JsonValue& value);
+}
+
+#endif // JSON_INCLUDE_H
@@ -0,0 +1,373 @@
+#include "LzCodec.h"
+#include "../DjinnLib/Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+
+namespace
+{
+	constexpr uint32_t MIN_MATCH{ 4 };
+	// the last match starts this far from the end and the last bytes are always literals, as in LZ4
+	constexpr size_t MATCH_FIND_LIMIT{ 12 };
+	constexpr size_t LAST_LITERALS{ 5 };
+	constexpr size_t MAX_OFFSET{ 65535 };
+	constexpr uint32_t HASH_BITS{ 12 };
+	// misses before the match search starts skipping ahead, keeps incompressible data fast
+	constexpr uint32_t SKIP_TRIGGER{ 6 };
+	// blocks per decode band, so small streams stay on the calling thread
+	constexpr size_t MIN_BLOCKS_PER_BAND{ 4 };
+
+	uint32_t read32(const uint8_t* p)
+	{
+		uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	// copies length bytes in 16 byte chunks, may write up to 15 bytes past the end
+	// callers check there is that much room, source chunks never overlap the chunk being written
+	void wildCopy(uint8_t* out, const uint8_t* in, const size_t length)
+	{
+		uint8_t* const end{ out + length };
+		do
+		{
+			std::memcpy(out, in, 16);
+			out += 16;
+			in += 16;
+		} while (out < end);
+	}
+
+	uint32_t hashSequence(const uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	uint8_t* writeLength(uint8_t* out, size_t length)
+	{
+		for (; length >= 255; length -= 255)
+		{
+			*out++ = 255;
+		}
+		*out++ = static_cast<uint8_t>(length);
+		return out;
+	}
+
+	uint8_t* writeSequence(uint8_t* out, const uint8_t* literals, const size_t literalLength, const size_t offset, const size_t matchLength)
+	{
+		uint8_t* token{ out++ };
+		*token = static_cast<uint8_t>(std::min<size_t>(literalLength, 15) << 4);
+		if (literalLength >= 15)
+		{
+			out = writeLength(out, literalLength - 15);
+		}
+		std::memcpy(out, literals, literalLength);
+		out += literalLength;
+
+		// the final sequence is literals only
+		if (matchLength == 0)
+		{
+			return out;
+		}
+
+		*out++ = static_cast<uint8_t>(offset);
+		*out++ = static_cast<uint8_t>(offset >> 8);
+
+		const size_t length{ matchLength - MIN_MATCH };
+		*token |= static_cast<uint8_t>(std::min<size_t>(length, 15));
+		if (length >= 15)
+		{
+			out = writeLength(out, length - 15);
+		}
+		return out;
+	}
+
+	bool readLength(const uint8_t*& in, const uint8_t* end, size_t& length)
+	{
+		uint8_t byte;
+		do
+		{
+			if (in == end)
+			{
+				return false;
+			}
+			byte = *in++;
+			length += byte;
+		} while (byte == 255);
+		return true;
+	}
+
+	std::span<const uint64_t> blockOffsets(std::span<const uint8_t> stream, const Djinn::LzStreamHeader& header)
+	{
+		return { reinterpret_cast<const uint64_t*>(stream.data() + sizeof(Djinn::LzStreamHeader)), static_cast<size_t>(header.blockCount) + 1 };
+	}
+
+	const Djinn::LzStreamHeader* streamHeader(std::span<const uint8_t> stream)
+	{
+		if (stream.size() < sizeof(Djinn::LzStreamHeader))
+		{
+			return nullptr;
+		}
+
+		const auto header{ reinterpret_cast<const Djinn::LzStreamHeader*>(stream.data()) };
+		const uint64_t expectedBlocks{ header->blockSize == 0 ? 0 : (header->rawSize + header->blockSize - 1) / header->blockSize };
+		const uint64_t tableSize{ (static_cast<uint64_t>(header->blockCount) + 1) * sizeof(uint64_t) };
+		const bool valid{ header->magic == Djinn::LZ_STREAM_MAGIC &&
+			header->blockSize != 0 &&
+			header->blockCount == expectedBlocks &&
+			tableSize <= stream.size() - sizeof(Djinn::LzStreamHeader) };
+
+		return valid ? header : nullptr;
+	}
+}
+
+size_t Djinn::lzCompressBound(const size_t rawSize)
+{
+	return rawSize + rawSize / 255 + 16;
+}
+
+size_t Djinn::lzCompressBlock(std::span<const uint8_t> source, uint8_t* destination)
+{
+	const uint8_t* base{ source.data() };
+	const size_t size{ source.size() };
+	uint8_t* out{ destination };
+
+	size_t anchor{ 0 };
+	if (size > MATCH_FIND_LIMIT)
+	{
+		// positions are stored + 1, 0 = empty slot
+		std::vector<uint32_t> table(size_t{ 1 } << HASH_BITS, 0);
+		const size_t matchLimit{ size - LAST_LITERALS };
+		const size_t searchLimit{ size - MATCH_FIND_LIMIT };
+
+		size_t position{ 0 };
+		uint32_t misses{ 0 };
+		while (position < searchLimit)
+		{
+			const uint32_t sequence{ read32(base + position) };
+			uint32_t& slot{ table[hashSequence(sequence)] };
+			const size_t candidate{ slot };
+			slot = static_cast<uint32_t>(position + 1);
+
+			if (candidate == 0 || position - (candidate - 1) > MAX_OFFSET || read32(base + candidate - 1) != sequence)
+			{
+				position += 1 + (misses++ >> SKIP_TRIGGER);
+				continue;
+			}
+			misses = 0;
+
+			size_t match{ candidate - 1 };
+			size_t length{ MIN_MATCH };
+			while (position + length < matchLimit && base[match + length] == base[position + length])
+			{
+				++length;
+			}
+			// grow backwards into the pending literals
+			while (position > anchor && match > 0 && base[position - 1] == base[match - 1])
+			{
+				--position;
+				--match;
+				++length;
+			}
+
+			out = writeSequence(out, base + anchor, position - anchor, position - match, length);
+			position += length;
+			anchor = position;
+		}
+	}
+
+	out = writeSequence(out, base + anchor, size - anchor, 0, 0);
+	return static_cast<size_t>(out - destination);
+}
+
+bool Djinn::lzDecompressBlock(std::span<const uint8_t> source, std::span<uint8_t> destination)
+{
+	const uint8_t* in{ source.data() };
+	const uint8_t* const inEnd{ in + source.size() };
+	uint8_t* out{ destination.data() };
+	uint8_t* const outBegin{ out };
+	uint8_t* const outEnd{ out + destination.size() };
+
+	while (in < inEnd)
+	{
+		const uint8_t token{ *in++ };
+
+		size_t literalLength{ static_cast<size_t>(token >> 4) };
+		if (literalLength == 15 && !readLength(in, inEnd, literalLength))
+		{
+			return false;
+		}
+		if (literalLength > static_cast<size_t>(inEnd - in) || literalLength > static_cast<size_t>(outEnd - out))
+		{
+			return false;
+		}
+		if (static_cast<size_t>(inEnd - in) >= literalLength + 16 && static_cast<size_t>(outEnd - out) >= literalLength + 16)
+		{
+			wildCopy(out, in, literalLength);
+		}
+		else
+		{
+			std::memcpy(out, in, literalLength);
+		}
+		in += literalLength;
+		out += literalLength;
+
+		// the last sequence ends after its literals
+		if (in == inEnd)
+		{
+			break;
+		}
+
+		if (inEnd - in < 2)
+		{
+			return false;
+		}
+		const size_t offset{ static_cast<size_t>(in[0]) | (static_cast<size_t>(in[1]) << 8) };
+		in += 2;
+		if (offset == 0 || offset > static_cast<size_t>(out - outBegin))
+		{
+			return false;
+		}
+
+		size_t matchLength{ static_cast<size_t>(token & 15) };
+		if (matchLength == 15 && !readLength(in, inEnd, matchLength))
+		{
+			return false;
+		}
+		matchLength += MIN_MATCH;
+		if (matchLength > static_cast<size_t>(outEnd - out))
+		{
+			return false;
+		}
+
+		const uint8_t* match{ out - offset };
+		if (offset >= 16 && static_cast<size_t>(outEnd - out) >= matchLength + 16)
+		{
+			wildCopy(out, match, matchLength);
+			out += matchLength;
+		}
+		else if (offset >= matchLength)
+		{
+			std::memcpy(out, match, matchLength);
+			out += matchLength;
+		}
+		else if (offset >= 8)
+		{
+			// overlapping, but every 8 byte chunk reads bytes that were written before it
+			uint8_t* const end{ out + matchLength };
+			for (; end - out >= 8; out += 8, match += 8)
+			{
+				std::memcpy(out, match, 8);
+			}
+			while (out < end)
+			{
+				*out++ = *match++;
+			}
+		}
+		else
+		{
+			// short offsets repeat a pattern, byte by byte is the only safe copy
+			for (size_t i = 0; i < matchLength; ++i)
+			{
+				*out++ = *match++;
+			}
+		}
+	}
+
+	return out == outEnd;
+}
+
+void Djinn::lzCompressStream(std::span<const uint8_t> source, const uint32_t blockSize, std::vector<uint8_t>& stream)
+{
+	// the decoder rejects such a stream anyway, and the block count below would divide by it
+	assert(blockSize != 0);
+	const size_t blockCount{ (source.size() + blockSize - 1) / blockSize };
+
+	// each block compresses into its own worst case slot, then the slots are packed
+	const size_t bound{ lzCompressBound(blockSize) };
+	std::vector<uint8_t> scratch(blockCount * bound);
+	std::vector<size_t> sizes(blockCount);
+	parallelForBands(blockCount, 1, [&](const size_t begin, const size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				const size_t rawOffset{ i * blockSize };
+				const auto raw{ source.subspan(rawOffset, std::min<size_t>(blockSize, source.size() - rawOffset)) };
+				uint8_t* slot{ scratch.data() + i * bound };
+				sizes[i] = lzCompressBlock(raw, slot);
+				// store blocks that didn't shrink, the decoder tells them apart by size
+				if (sizes[i] >= raw.size())
+				{
+					std::memcpy(slot, raw.data(), raw.size());
+					sizes[i] = raw.size();
+				}
+			}
+		});
+
+	LzStreamHeader header{};
+	header.magic = LZ_STREAM_MAGIC;
+	header.blockSize = blockSize;
+	header.blockCount = static_cast<uint32_t>(blockCount);
+	header.rawSize = source.size();
+
+	std::vector<uint64_t> offsets(blockCount + 1);
+	offsets[0] = sizeof(LzStreamHeader) + offsets.size() * sizeof(uint64_t);
+	for (size_t i = 0; i < blockCount; ++i)
+	{
+		offsets[i + 1] = offsets[i] + sizes[i];
+	}
+
+	stream.resize(offsets.back());
+	std::memcpy(stream.data(), &header, sizeof(header));
+	std::memcpy(stream.data() + sizeof(header), offsets.data(), offsets.size() * sizeof(uint64_t));
+	for (size_t i = 0; i < blockCount; ++i)
+	{
+		std::memcpy(stream.data() + offsets[i], scratch.data() + i * bound, sizes[i]);
+	}
+}
+
+uint64_t Djinn::lzStreamRawSize(std::span<const uint8_t> stream)
+{
+	const auto header{ streamHeader(stream) };
+	return header == nullptr ? 0 : header->rawSize;
+}
+
+bool Djinn::lzDecompressStream(std::span<const uint8_t> stream, std::span<uint8_t> destination)
+{
+	const auto header{ streamHeader(stream) };
+	if (header == nullptr || header->rawSize != destination.size())
+	{
+		return false;
+	}
+
+	const auto offsets{ blockOffsets(stream, *header) };
+	std::atomic<bool> valid{ true };
+	parallelForBands(header->blockCount, MIN_BLOCKS_PER_BAND, [&](const size_t begin, const size_t end)
+		{
+			for (size_t i = begin; i < end && valid; ++i)
+			{
+				const uint64_t rawOffset{ i * header->blockSize };
+				const auto raw{ destination.subspan(static_cast<size_t>(rawOffset),
+					static_cast<size_t>(std::min<uint64_t>(header->blockSize, header->rawSize - rawOffset))) };
+
+				if (offsets[i] > offsets[i + 1] || offsets[i + 1] > stream.size())
+				{
+					valid = false;
+					break;
+				}
+				const auto block{ stream.subspan(offsets[i], offsets[i + 1] - offsets[i]) };
+
+				if (block.size() == raw.size())
+				{
+					std::memcpy(raw.data(), block.data(), raw.size());
+				}
+				else if (!lzDecompressBlock(block, raw))
+				{
+					valid = false;
+				}
+			}
+		});
+
+	return valid;
+}
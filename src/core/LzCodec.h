@@ -0,0 +1,43 @@
+#ifndef LZ_CODEC_INCLUDE_H
+#define LZ_CODEC_INCLUDE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Djinn
+{
+	constexpr uint32_t LZ_STREAM_MAGIC{ 0x535a4c44 }; // "DLZS"
+	// big enough to keep the ratio, small enough that a texture splits across every worker
+	constexpr uint32_t LZ_DEFAULT_BLOCK_SIZE{ 256 * 1024 };
+
+	// a block stream : this header, blockCount + 1 offsets from the stream start, then the blocks
+	// blocks are independent LZ4 style sequences, a block whose size equals its raw size is stored as is
+	struct LzStreamHeader
+	{
+		uint32_t magic;
+		uint32_t blockSize;
+		uint32_t blockCount;
+		uint32_t reserved;
+		uint64_t rawSize;
+	};
+
+	// worst case size of one compressed block, incompressible input only grows by the literal run lengths
+	size_t lzCompressBound(const size_t rawSize);
+
+	// LZ4 block format, greedy matching with a 4K entry hash table, returns the compressed size
+	// destination must hold lzCompressBound(source.size()) bytes
+	size_t lzCompressBlock(std::span<const uint8_t> source, uint8_t* destination);
+	// false if the block is malformed or doesn't decode to exactly destination.size() bytes
+	bool lzDecompressBlock(std::span<const uint8_t> source, std::span<uint8_t> destination);
+
+	// blocks are compressed in parallel, blockSize must not be 0
+	void lzCompressStream(std::span<const uint8_t> source, const uint32_t blockSize, std::vector<uint8_t>& stream);
+	// raw size recorded in the stream header, 0 if the header is malformed
+	uint64_t lzStreamRawSize(std::span<const uint8_t> stream);
+	// decodes every block straight into destination, blocks are spread over the hardware threads
+	bool lzDecompressStream(std::span<const uint8_t> stream, std::span<uint8_t> destination);
+}
+
+#endif // LZ_CODEC_INCLUDE_H
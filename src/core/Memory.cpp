@@ -1,5 +1,50 @@
 #include "Memory.h"
 
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+namespace
+{
+	constexpr VkDeviceSize SMALL_HEAP_SIZE{ 1ull << 30 };
+
+	VkDeviceSize alignUp(const VkDeviceSize value, const VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// whether the last byte of a and the first byte of b fall on the same page, b has to start after a
+	bool onSamePage(const VkDeviceSize offsetA, const VkDeviceSize sizeA, const VkDeviceSize offsetB, const VkDeviceSize pageSize)
+	{
+		const VkDeviceSize endPageA{ (offsetA + sizeA - 1) & ~(pageSize - 1) };
+		const VkDeviceSize startPageB{ offsetB & ~(pageSize - 1) };
+		return endPageA == startPageB;
+	}
+
+	// linear and optimal resources can't share a bufferImageGranularity page, buffers count as linear
+	// an image of unknown tiling conflicts with every other image
+	bool isGranularityConflict(Djinn::AllocationType a, Djinn::AllocationType b)
+	{
+		if (a > b)
+		{
+			std::swap(a, b);
+		}
+
+		switch (a)
+		{
+		case Djinn::AllocationType::ALLOCATION_TYPE_BUFFER:
+			return b == Djinn::AllocationType::ALLOCATION_TYPE_IMAGE || b == Djinn::AllocationType::ALLOCATION_TYPE_IMAGE_OPTIMAL;
+		case Djinn::AllocationType::ALLOCATION_TYPE_IMAGE:
+			return b == Djinn::AllocationType::ALLOCATION_TYPE_IMAGE || b == Djinn::AllocationType::ALLOCATION_TYPE_IMAGE_LINEAR ||
+				b == Djinn::AllocationType::ALLOCATION_TYPE_IMAGE_OPTIMAL;
+		case Djinn::AllocationType::ALLOCATION_TYPE_IMAGE_LINEAR:
+			return b == Djinn::AllocationType::ALLOCATION_TYPE_IMAGE_OPTIMAL;
+		default:
+			return false;
+		}
+	}
+}
+
 uint32_t Djinn::findMemoryType(Context* p_context, const uint32_t typeFilter, const VkMemoryPropertyFlags properties)
 {
 	const auto memProperties = p_context->gpuInfo.memProperties;
@@ -16,4 +61,434 @@ uint32_t Djinn::findMemoryType(Context* p_context, const uint32_t typeFilter, co
 	throw std::runtime_error("Failed to find suitable memory type!");
 
 	return 0;
-}
\ No newline at end of file
+}
+
+bool Djinn::hasMemoryType(Context* p_context, const uint32_t typeFilter, const VkMemoryPropertyFlags properties)
+{
+	const VkPhysicalDeviceMemoryProperties& memProperties{ p_context->gpuInfo.memProperties };
+	for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i)
+	{
+		if ((typeFilter & (1 << i)) && ((memProperties.memoryTypes[i].propertyFlags & properties) == properties))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+VkDeviceSize Djinn::mappableDeviceLocalHeap(Context* p_context)
+{
+	constexpr VkMemoryPropertyFlags mappable{ VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT };
+	const VkPhysicalDeviceMemoryProperties& memProperties{ p_context->gpuInfo.memProperties };
+
+	VkDeviceSize largest{ 0 };
+	for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i)
+	{
+		if ((memProperties.memoryTypes[i].propertyFlags & mappable) == mappable)
+		{
+			largest = std::max(largest, memProperties.memoryHeaps[memProperties.memoryTypes[i].heapIndex].size);
+		}
+	}
+	return largest;
+}
+
+Djinn::VulkanBlock::VulkanBlock(const uint32_t typeIndex, const VkDeviceSize blockBytes, const VkMemoryPropertyFlags propertyFlags)
+	: memoryTypeIndex(typeIndex), size(blockBytes), hostVisible((propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0),
+	hostCoherent((propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0)
+{}
+
+Djinn::VulkanBlock::~VulkanBlock()
+{
+	// Shutdown releases the memory, the chunk list is all that can be left
+	chunk_t* current{ head };
+	while (current != nullptr)
+	{
+		chunk_t* next{ current->next };
+		delete current;
+		current = next;
+	}
+}
+
+VkResult Djinn::VulkanBlock::Init(VkDevice device)
+{
+	VkMemoryAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.allocationSize = size;
+	allocateInfo.memoryTypeIndex = memoryTypeIndex;
+
+	auto result{ vkAllocateMemory(device, &allocateInfo, nullptr, &deviceMemory) };
+	if (result != VK_SUCCESS)
+	{
+		return result;
+	}
+
+	if (hostVisible)
+	{
+		void* mapped;
+		result = vkMapMemory(device, deviceMemory, 0, VK_WHOLE_SIZE, 0, &mapped);
+		if (result != VK_SUCCESS)
+		{
+			vkFreeMemory(device, deviceMemory, nullptr);
+			deviceMemory = VK_NULL_HANDLE;
+			return result;
+		}
+		data = static_cast<byte*>(mapped);
+	}
+
+	head = new chunk_t{ nextBlockID++, size, 0, AllocationType::ALLOCATION_TYPE_FREE, nullptr, nullptr };
+	return VK_SUCCESS;
+}
+
+void Djinn::VulkanBlock::Shutdown(VkDevice device)
+{
+	if (data != nullptr)
+	{
+		vkUnmapMemory(device, deviceMemory);
+		data = nullptr;
+	}
+	vkFreeMemory(device, deviceMemory, nullptr);
+	deviceMemory = VK_NULL_HANDLE;
+}
+
+bool Djinn::VulkanBlock::Allocate(const VkDeviceSize allocSize, const VkDeviceSize alignment, const VkDeviceSize granularity,
+	const AllocationType allocType, VulkanAllocation_t& allocation)
+{
+	if (size - allocated < allocSize)
+	{
+		return false;
+	}
+
+	for (chunk_t* current = head; current != nullptr; current = current->next)
+	{
+		if (current->type != AllocationType::ALLOCATION_TYPE_FREE || current->size < allocSize)
+		{
+			continue;
+		}
+
+		// free chunks are merged, so both neighbours of a free chunk hold resources
+		VkDeviceSize offset{ alignUp(current->offset, alignment) };
+		const chunk_t* prev{ current->prev };
+		if (granularity > 1 && prev != nullptr && onSamePage(prev->offset, prev->size, offset, granularity) && isGranularityConflict(prev->type, allocType))
+		{
+			offset = alignUp(offset, granularity);
+		}
+
+		const VkDeviceSize padding{ offset - current->offset };
+		if (padding + allocSize > current->size)
+		{
+			continue;
+		}
+
+		const chunk_t* next{ current->next };
+		if (granularity > 1 && next != nullptr && onSamePage(offset, allocSize, next->offset, granularity) && isGranularityConflict(allocType, next->type))
+		{
+			continue;
+		}
+
+		// the padding stays inside the used chunk, it is less than one alignment or granularity page
+		const VkDeviceSize used{ padding + allocSize };
+		if (current->size > used)
+		{
+			chunk_t* remainder{ new chunk_t{ nextBlockID++, current->size - used, current->offset + used,
+				AllocationType::ALLOCATION_TYPE_FREE, current, current->next } };
+			if (current->next != nullptr)
+			{
+				current->next->prev = remainder;
+			}
+			current->next = remainder;
+			current->size = used;
+		}
+		current->type = allocType;
+		allocated += current->size;
+
+		allocation.block = this;
+		allocation.ID = current->id;
+		allocation.deviceMemory = deviceMemory;
+		allocation.offset = offset;
+		allocation.size = allocSize;
+		allocation.data = data != nullptr ? data + offset : nullptr;
+		return true;
+	}
+
+	return false;
+}
+
+void Djinn::VulkanBlock::Free(VulkanAllocation_t& allocation)
+{
+	chunk_t* current{ head };
+	while (current != nullptr && current->id != allocation.ID)
+	{
+		current = current->next;
+	}
+	assert(current != nullptr && current->type != AllocationType::ALLOCATION_TYPE_FREE);
+
+	current->type = AllocationType::ALLOCATION_TYPE_FREE;
+	allocated -= current->size;
+
+	chunk_t* prev{ current->prev };
+	if (prev != nullptr && prev->type == AllocationType::ALLOCATION_TYPE_FREE)
+	{
+		prev->size += current->size;
+		prev->next = current->next;
+		if (current->next != nullptr)
+		{
+			current->next->prev = prev;
+		}
+		delete current;
+		current = prev;
+	}
+
+	chunk_t* next{ current->next };
+	if (next != nullptr && next->type == AllocationType::ALLOCATION_TYPE_FREE)
+	{
+		current->size += next->size;
+		current->next = next->next;
+		if (next->next != nullptr)
+		{
+			next->next->prev = current;
+		}
+		delete next;
+	}
+
+	allocation = {};
+}
+
+Djinn::VulkanMemoryStats Djinn::VulkanBlock::Stats() const
+{
+	VulkanMemoryStats stats{};
+	stats.blockCount = 1;
+	stats.reserved = size;
+	stats.used = allocated;
+	for (const chunk_t* current = head; current != nullptr; current = current->next)
+	{
+		if (current->type == AllocationType::ALLOCATION_TYPE_FREE)
+		{
+			++stats.freeRanges;
+			stats.largestFreeRange = std::max(stats.largestFreeRange, current->size);
+		}
+		else
+		{
+			++stats.allocationCount;
+		}
+	}
+
+	const VkDeviceSize freeBytes{ size - allocated };
+	stats.fragmentation = freeBytes > 0 ? 1.0f - static_cast<float>(stats.largestFreeRange) / static_cast<float>(freeBytes) : 0.0f;
+	return stats;
+}
+
+bool Djinn::VulkanBlock::IsEmpty() const
+{
+	return allocated == 0;
+}
+
+bool Djinn::VulkanBlock::NeedsFlush() const
+{
+	return hostVisible && !hostCoherent;
+}
+
+void Djinn::VulkanAllocator::Init(Context* context)
+{
+	p_context = context;
+	bufferImageGranularity = std::max<VkDeviceSize>(p_context->gpuInfo.gpuProperties.limits.bufferImageGranularity, 1);
+	nonCoherentAtomSize = std::max<VkDeviceSize>(p_context->gpuInfo.gpuProperties.limits.nonCoherentAtomSize, 1);
+}
+
+void Djinn::VulkanAllocator::CleanUp()
+{
+	const std::lock_guard<std::mutex> lock{ mutex };
+	for (auto& typeBlocks : blocks)
+	{
+		for (VulkanBlock* block : typeBlocks)
+		{
+			if (!block->IsEmpty())
+			{
+				spdlog::warn("Releasing a memory block of type {} with {} bytes still allocated", block->memoryTypeIndex, block->allocated);
+			}
+			block->Shutdown(p_context->gpuInfo.device);
+			delete block;
+		}
+		typeBlocks.clear();
+	}
+}
+
+// heaps of a GiB or less (BAR memory, small integrated carve outs) get an eighth of the heap per block
+VkDeviceSize Djinn::VulkanAllocator::blockSize(const uint32_t memoryTypeIndex) const
+{
+	const VkPhysicalDeviceMemoryProperties& memProperties{ p_context->gpuInfo.memProperties };
+	const VkMemoryType& memoryType{ memProperties.memoryTypes[memoryTypeIndex] };
+	const VkDeviceSize heapSize{ memProperties.memoryHeaps[memoryType.heapIndex].size };
+
+	const bool hostVisible{ (memoryType.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0 };
+	const VkDeviceSize preferred{ hostVisible ? p_context->renderConfig.hostVisibleBlockSize : p_context->renderConfig.deviceLocalBlockSize };
+	return heapSize <= SMALL_HEAP_SIZE ? std::min(preferred, heapSize / 8) : preferred;
+}
+
+Djinn::VulkanAllocation_t Djinn::VulkanAllocator::Allocate(const VkMemoryRequirements& requirements, const VkMemoryPropertyFlags properties,
+	const AllocationType allocType)
+{
+	const uint32_t memoryTypeIndex{ findMemoryType(p_context, requirements.memoryTypeBits, properties) };
+	const VkMemoryPropertyFlags propertyFlags{ p_context->gpuInfo.memProperties.memoryTypes[memoryTypeIndex].propertyFlags };
+	VkDeviceSize alignment{ std::max<VkDeviceSize>(requirements.alignment, 1) };
+	VkDeviceSize allocSize{ requirements.size };
+	// a flush or invalidate widened to whole atoms must not reach into a neighbour's bytes
+	if ((propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+	{
+		alignment = std::max(alignment, nonCoherentAtomSize);
+		allocSize = (allocSize + nonCoherentAtomSize - 1) & ~(nonCoherentAtomSize - 1);
+	}
+
+	const std::lock_guard<std::mutex> lock{ mutex };
+	VulkanAllocation_t allocation{};
+	std::vector<VulkanBlock*>& typeBlocks{ blocks[memoryTypeIndex] };
+	for (VulkanBlock* block : typeBlocks)
+	{
+		if (block->Allocate(allocSize, alignment, bufferImageGranularity, allocType, allocation))
+		{
+			return allocation;
+		}
+	}
+
+	auto block{ new VulkanBlock(memoryTypeIndex, std::max(blockSize(memoryTypeIndex), allocSize), propertyFlags) };
+	if (block->Init(p_context->gpuInfo.device) != VK_SUCCESS)
+	{
+		delete block;
+		throw std::runtime_error("Failed to allocate device memory!");
+	}
+	typeBlocks.push_back(block);
+
+	const bool allocated{ block->Allocate(allocSize, alignment, bufferImageGranularity, allocType, allocation) };
+	assert(allocated);
+	DJINN_UNUSED(allocated);
+	return allocation;
+}
+
+void Djinn::VulkanAllocator::Free(VulkanAllocation_t& allocation)
+{
+	VulkanBlock* block{ allocation.block };
+	if (block == nullptr)
+	{
+		return;
+	}
+
+	const std::lock_guard<std::mutex> lock{ mutex };
+	block->Free(allocation);
+	if (!block->IsEmpty())
+	{
+		return;
+	}
+
+	// keep one default sized block per type around so a free / allocate pair doesn't go back to the driver
+	std::vector<VulkanBlock*>& typeBlocks{ blocks[block->memoryTypeIndex] };
+	if (typeBlocks.size() == 1 && block->size == blockSize(block->memoryTypeIndex))
+	{
+		return;
+	}
+	typeBlocks.erase(std::find(typeBlocks.begin(), typeBlocks.end(), block));
+	block->Shutdown(p_context->gpuInfo.device);
+	delete block;
+}
+
+bool Djinn::VulkanAllocator::mappedRange(const VulkanAllocation_t& allocation, const VkDeviceSize offset, const VkDeviceSize size,
+	VkMappedMemoryRange& range) const
+{
+	if (allocation.block == nullptr || !allocation.block->NeedsFlush() || size == 0)
+	{
+		return false;
+	}
+	assert(offset + size <= allocation.size);
+
+	// allocations in non coherent memory start on an atom and cover whole atoms, the widened range stays inside
+	const VkDeviceSize begin{ (allocation.offset + offset) & ~(nonCoherentAtomSize - 1) };
+	const VkDeviceSize end{ std::min((allocation.offset + offset + size + nonCoherentAtomSize - 1) & ~(nonCoherentAtomSize - 1),
+		allocation.block->size) };
+
+	range = {};
+	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.memory = allocation.deviceMemory;
+	range.offset = begin;
+	range.size = end - begin;
+	return true;
+}
+
+void Djinn::VulkanAllocator::Flush(const VulkanAllocation_t& allocation, const VkDeviceSize offset, const VkDeviceSize size) const
+{
+	VkMappedMemoryRange range;
+	if (mappedRange(allocation, offset, size, range))
+	{
+		auto result{ vkFlushMappedMemoryRanges(p_context->gpuInfo.device, 1, &range) };
+		DJINN_VK_ASSERT(result);
+	}
+}
+
+void Djinn::VulkanAllocator::Invalidate(const VulkanAllocation_t& allocation, const VkDeviceSize offset, const VkDeviceSize size) const
+{
+	VkMappedMemoryRange range;
+	if (mappedRange(allocation, offset, size, range))
+	{
+		auto result{ vkInvalidateMappedMemoryRanges(p_context->gpuInfo.device, 1, &range) };
+		DJINN_VK_ASSERT(result);
+	}
+}
+
+Djinn::VulkanMemoryStats Djinn::VulkanAllocator::Stats() const
+{
+	const std::lock_guard<std::mutex> lock{ mutex };
+	VulkanMemoryStats stats{};
+	VkDeviceSize contiguous{ 0 };
+	for (const auto& typeBlocks : blocks)
+	{
+		for (const VulkanBlock* block : typeBlocks)
+		{
+			const VulkanMemoryStats blockStats{ block->Stats() };
+			stats.blockCount += blockStats.blockCount;
+			stats.allocationCount += blockStats.allocationCount;
+			stats.freeRanges += blockStats.freeRanges;
+			stats.reserved += blockStats.reserved;
+			stats.used += blockStats.used;
+			stats.largestFreeRange = std::max(stats.largestFreeRange, blockStats.largestFreeRange);
+			contiguous += blockStats.largestFreeRange;
+		}
+	}
+
+	const VkDeviceSize freeBytes{ stats.reserved - stats.used };
+	stats.fragmentation = freeBytes > 0 ? 1.0f - static_cast<float>(contiguous) / static_cast<float>(freeBytes) : 0.0f;
+	return stats;
+}
+
+void Djinn::VulkanAllocator::LogStats() const
+{
+	const VulkanMemoryStats stats{ Stats() };
+	constexpr double MiB{ 1024.0 * 1024.0 };
+	spdlog::info("Device memory: {} blocks, {} allocations, {:.1f} of {:.1f} MiB used, {} free ranges (largest {:.1f} MiB, fragmentation {:.2f})",
+		stats.blockCount, stats.allocationCount, static_cast<double>(stats.used) / MiB, static_cast<double>(stats.reserved) / MiB,
+		stats.freeRanges, static_cast<double>(stats.largestFreeRange) / MiB, stats.fragmentation);
+}
+
+void Djinn::allocateBufferMemory(Context* p_context, VkBuffer buffer, const VkMemoryPropertyFlags properties, VulkanAllocation_t& allocation,
+	const VkMemoryPropertyFlags preferredProperties)
+{
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(p_context->gpuInfo.device, buffer, &memRequirements);
+
+	const VkMemoryPropertyFlags flags{ hasMemoryType(p_context, memRequirements.memoryTypeBits, properties | preferredProperties) ?
+		properties | preferredProperties : properties };
+	allocation = p_context->p_allocator->Allocate(memRequirements, flags, AllocationType::ALLOCATION_TYPE_BUFFER);
+
+	auto result{ vkBindBufferMemory(p_context->gpuInfo.device, buffer, allocation.deviceMemory, allocation.offset) };
+	DJINN_VK_ASSERT(result);
+}
+
+void Djinn::allocateImageMemory(Context* p_context, VkImage image, const VkImageTiling tiling, const VkMemoryPropertyFlags properties,
+	VulkanAllocation_t& allocation)
+{
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(p_context->gpuInfo.device, image, &memRequirements);
+
+	const AllocationType allocType{ tiling == VK_IMAGE_TILING_OPTIMAL ? AllocationType::ALLOCATION_TYPE_IMAGE_OPTIMAL :
+		tiling == VK_IMAGE_TILING_LINEAR ? AllocationType::ALLOCATION_TYPE_IMAGE_LINEAR : AllocationType::ALLOCATION_TYPE_IMAGE };
+	allocation = p_context->p_allocator->Allocate(memRequirements, properties, allocType);
+
+	auto result{ vkBindImageMemory(p_context->gpuInfo.device, image, allocation.deviceMemory, allocation.offset) };
+	DJINN_VK_ASSERT(result);
+}
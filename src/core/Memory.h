@@ -7,6 +7,8 @@
 #include "../DjinnLib/Array.h"
 #include "../external/vk_mem_alloc.h"
 
+#include <array>
+#include <mutex>
 #include <vector>
 
 namespace Djinn
@@ -33,6 +35,7 @@ namespace Djinn
 		MEMORY_USAGE_GPU_TO_CPU
 	};
 
+	// ordered so a conflict check only has to look at the smaller of two types
 	enum class AllocationType
 	{
 		ALLOCATION_TYPE_FREE,
@@ -43,9 +46,15 @@ namespace Djinn
 	};
 
 	uint32_t findMemoryType(Context* p_context, const uint32_t typeFilter, const VkMemoryPropertyFlags properties);
+	// findMemoryType without the throw
+	bool hasMemoryType(Context* p_context, const uint32_t typeFilter, const VkMemoryPropertyFlags properties);
+	// size of the largest heap behind a DEVICE_LOCAL | HOST_VISIBLE memory type, 0 when the device has none
+	// a BAR window is usually 256 MiB, resizable BAR and unified memory expose the whole of device memory
+	VkDeviceSize mappableDeviceLocalHeap(Context* p_context);
 
 	class VulkanBlock;
 
+	// a range of a block, data already points at offset and is only set for host visible memory
 	struct VulkanAllocation_t
 	{
 		VulkanBlock*		block = nullptr;
@@ -56,36 +65,100 @@ namespace Djinn
 		byte*				data = nullptr;
 	};
 
+	// used counts alignment padding, fragmentation is the share of free bytes outside each block's largest free range
+	// 0 while every block's free space is a single range
+	struct VulkanMemoryStats
+	{
+		uint32_t blockCount{ 0 };
+		uint32_t allocationCount{ 0 };
+		uint32_t freeRanges{ 0 };
+		VkDeviceSize reserved{ 0 };
+		VkDeviceSize used{ 0 };
+		VkDeviceSize largestFreeRange{ 0 };
+		float fragmentation{ 0.0f };
+	};
+
+	// one vkAllocateMemory, split into a list of chunks ordered by offset, neighbouring free chunks are always merged
+	// host visible blocks stay mapped for their whole life
 	class VulkanBlock
 	{
 		friend class VulkanAllocator;
 	public:
+		VulkanBlock(const uint32_t typeIndex, const VkDeviceSize blockBytes, const VkMemoryPropertyFlags propertyFlags);
+		~VulkanBlock();
+
+		VkResult Init(VkDevice device);
+		void Shutdown(VkDevice device);
+
+		// first fit, a resource of a conflicting type on the same granularity page as a neighbour is pushed to the next page
+		bool Allocate(const VkDeviceSize allocSize, const VkDeviceSize alignment, const VkDeviceSize granularity,
+			const AllocationType allocType, VulkanAllocation_t& allocation);
+		void Free(VulkanAllocation_t& allocation);
+		VulkanMemoryStats Stats() const;
+		bool IsEmpty() const;
+		// host visible memory without HOST_COHERENT, writes need a flush and reads an invalidate
+		bool NeedsFlush() const;
+
 	private:
 		struct chunk_t
 		{
 			uint32_t id;
 			VkDeviceSize size;
 			VkDeviceSize offset;
+			AllocationType type;
 			chunk_t* prev;
 			chunk_t* next;
 		};
 
-		chunk_t* head;
+		chunk_t* head{ nullptr };
 
-		uint32_t nextBlockID;
+		uint32_t nextBlockID{ 0 };
 		uint32_t memoryTypeIndex;
 		VkDeviceSize size = 0;
 		VkDeviceSize allocated = 0;
-		byte* data;
-
+		VkDeviceMemory deviceMemory{ VK_NULL_HANDLE };
+		bool hostVisible;
+		bool hostCoherent;
+		byte* data{ nullptr };
 	};
 
-	//using Array1D<std::vector< VulkanBlock* >, 
-
+	// sub-allocates buffers and images from large per memory type blocks instead of one vkAllocateMemory each
+	// resources larger than a block get a block of their own, empty blocks are released except the last one of a type
 	class VulkanAllocator
 	{
+	public:
+		void Init(Context* context);
+		void CleanUp();
+
+		// throws when no memory type fits or the device is out of memory, like findMemoryType
+		VulkanAllocation_t Allocate(const VkMemoryRequirements& requirements, const VkMemoryPropertyFlags properties, const AllocationType allocType);
+		void Free(VulkanAllocation_t& allocation);
+
+		// make CPU writes to [offset, offset + size) of the allocation visible to the device, or device writes to the CPU
+		// both do nothing on coherent memory, ranges are widened to nonCoherentAtomSize
+		void Flush(const VulkanAllocation_t& allocation, const VkDeviceSize offset, const VkDeviceSize size) const;
+		void Invalidate(const VulkanAllocation_t& allocation, const VkDeviceSize offset, const VkDeviceSize size) const;
 
+		VulkanMemoryStats Stats() const;
+		void LogStats() const;
+
+	private:
+		bool mappedRange(const VulkanAllocation_t& allocation, const VkDeviceSize offset, const VkDeviceSize size, VkMappedMemoryRange& range) const;
+		VkDeviceSize blockSize(const uint32_t memoryTypeIndex) const;
+
+		Context* p_context{ nullptr };
+		VkDeviceSize bufferImageGranularity{ 1 };
+		VkDeviceSize nonCoherentAtomSize{ 1 };
+		std::array<std::vector<VulkanBlock*>, VK_MAX_MEMORY_TYPES> blocks;
+		mutable std::mutex mutex;
 	};
+
+	// allocate through the context's allocator and bind at the allocation's offset
+	// preferred flags are added to properties when one of the buffer's memory types has them all, they're dropped otherwise
+	void allocateBufferMemory(Context* p_context, VkBuffer buffer, const VkMemoryPropertyFlags properties, VulkanAllocation_t& allocation,
+		const VkMemoryPropertyFlags preferredProperties = 0);
+	void allocateImageMemory(Context* p_context, VkImage image, const VkImageTiling tiling, const VkMemoryPropertyFlags properties,
+		VulkanAllocation_t& allocation);
 }
 
-#endif // MEMORY_INCLUDE_H
\ No newline at end of file
+#endif // MEMORY_INCLUDE_H
@@ -0,0 +1,433 @@
+#include "MeshAsset.h"
+#include "ObjParser.h"
+#include "VertexWeld.h"
+#include "VertexCompression.h"
+#include "MeshOptimize.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <filesystem>
+
+namespace
+{
+	void buildMeshStreams(const VertexFormat requestedFormat, const bool splitPositions, Djinn::MeshAsset& mesh)
+	{
+		MeshStreams& streams{ mesh.streams };
+		streams = {};
+		streams.bounds = Djinn::computeBounds(mesh.vertices);
+		streams.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+		streams.indexCount = static_cast<uint32_t>(mesh.indices.size());
+
+		const bool compact{ requestedFormat == VertexFormat::VERTEX_FORMAT_COMPACT &&
+			Djinn::compressVertices(mesh.vertices, streams.bounds, mesh.compactVertices) };
+		if (compact)
+		{
+			streams.vertexFormat = VertexFormat::VERTEX_FORMAT_COMPACT;
+			streams.vertexStride = sizeof(CompactVertex);
+			streams.vertexBytes = std::as_bytes(std::span<const CompactVertex>{ mesh.compactVertices });
+			mesh.dequantize = Djinn::dequantizeTransform(streams.bounds);
+		}
+		else
+		{
+			if (requestedFormat == VertexFormat::VERTEX_FORMAT_COMPACT)
+			{
+				spdlog::warn("{} has per vertex colors, falling back to the full vertex format", mesh.path);
+			}
+			streams.vertexFormat = VertexFormat::VERTEX_FORMAT_FULL;
+			streams.vertexStride = sizeof(Vertex);
+			streams.vertexBytes = std::as_bytes(std::span<const Vertex>{ mesh.vertices });
+			mesh.dequantize = glm::mat4{ 1.0f };
+		}
+
+		if (Djinn::fitsIndex16(mesh.vertices.size()))
+		{
+			Djinn::packIndices16(mesh.indices, mesh.indices16);
+			streams.indexSize = sizeof(uint16_t);
+			streams.indexBytes = std::as_bytes(std::span<const uint16_t>{ mesh.indices16 });
+		}
+		else
+		{
+			streams.indexSize = sizeof(uint32_t);
+			streams.indexBytes = std::as_bytes(std::span<const uint32_t>{ mesh.indices });
+		}
+
+		if (splitPositions)
+		{
+			const uint32_t positionSize{ Djinn::vertexLayoutInfo(streams.vertexFormat).positionSize };
+			Djinn::splitVertexStream(streams.vertexBytes, streams.vertexStride, positionSize, mesh.positionData, mesh.attributeData);
+			streams.positionStride = positionSize;
+			streams.positionBytes = mesh.positionData;
+			streams.vertexStride -= positionSize;
+			streams.vertexBytes = mesh.attributeData;
+		}
+
+		spdlog::info("Mesh streams: {} vertices x {} + {} bytes, {} indices x {} bytes", streams.vertexCount,
+			streams.positionStride, streams.vertexStride, streams.indexCount, streams.indexSize);
+	}
+
+	bool isGlb(const std::string& path)
+	{
+		return std::filesystem::path(path).extension() == ".glb";
+	}
+
+	bool floatAccessor(const Djinn::GltfAccessor& accessor, const uint32_t components)
+	{
+		return accessor.componentType == Djinn::GltfComponentType::GLTF_COMPONENT_FLOAT && accessor.components == components;
+	}
+
+	// the accessors become the vertex input as they are, every stream views the mapped binary chunk
+	// false if anything would need converting first
+	bool bindGltfStreams(Djinn::MeshAsset& mesh)
+	{
+		const Djinn::GltfFile& glb{ mesh.glb };
+		if (glb.Primitives().size() != 1)
+		{
+			return false;
+		}
+		const Djinn::GltfPrimitive& primitive{ glb.Primitives()[0] };
+		if (primitive.normal < 0 || primitive.texCoord < 0 || primitive.color >= 0 || primitive.indices < 0)
+		{
+			return false;
+		}
+
+		const auto accessors{ glb.Accessors() };
+		const Djinn::GltfAccessor& position{ accessors[static_cast<size_t>(primitive.position)] };
+		const Djinn::GltfAccessor& normal{ accessors[static_cast<size_t>(primitive.normal)] };
+		const Djinn::GltfAccessor& texCoord{ accessors[static_cast<size_t>(primitive.texCoord)] };
+		const Djinn::GltfAccessor& indices{ accessors[static_cast<size_t>(primitive.indices)] };
+		const bool indexType{ indices.componentType == Djinn::GltfComponentType::GLTF_COMPONENT_UNSIGNED_SHORT ||
+			indices.componentType == Djinn::GltfComponentType::GLTF_COMPONENT_UNSIGNED_INT };
+		if (!floatAccessor(position, 3) || !floatAccessor(normal, 3) || !floatAccessor(texCoord, 2) || !position.hasBounds ||
+			normal.count != position.count || texCoord.count != position.count || !indexType || !indices.Packed() || indices.count % 3 != 0 ||
+			position.count == 0 || indices.count == 0)
+		{
+			return false;
+		}
+
+		// the indices go to the GPU unchecked otherwise, convertGltf rejects the file when one is out of range
+		for (uint32_t i = 0; i < indices.count; ++i)
+		{
+			if (glb.ReadIndex(indices, i) >= position.count)
+			{
+				return false;
+			}
+		}
+
+		// one upload covers every attribute, the bindings start at their accessor's offset inside it
+		const Djinn::GltfAccessor* attributes[]{ &position, &normal, &texCoord };
+		uint64_t begin{ UINT64_MAX };
+		uint64_t end{ 0 };
+		for (const auto* accessor : attributes)
+		{
+			begin = std::min(begin, accessor->offset);
+			end = std::max(end, accessor->offset + static_cast<uint64_t>(accessor->count - 1) * accessor->stride + accessor->ElementSize());
+		}
+
+		MeshStreams& streams{ mesh.streams };
+		streams = {};
+		streams.vertexFormat = VertexFormat::VERTEX_FORMAT_GLTF;
+		streams.vertexCount = position.count;
+		streams.vertexBytes = std::as_bytes(glb.Binary().subspan(begin, end - begin));
+		streams.attributeStreams =
+		{
+			VertexAttributeStream{ 0, VK_FORMAT_R32G32B32_SFLOAT, position.stride, static_cast<uint32_t>(position.offset - begin) },
+			VertexAttributeStream{ 2, VK_FORMAT_R32G32B32_SFLOAT, normal.stride, static_cast<uint32_t>(normal.offset - begin) },
+			VertexAttributeStream{ 3, VK_FORMAT_R32G32_SFLOAT, texCoord.stride, static_cast<uint32_t>(texCoord.offset - begin) }
+		};
+		streams.indexSize = Djinn::gltfComponentSize(indices.componentType);
+		streams.indexCount = indices.count;
+		streams.indexBytes = std::as_bytes(glb.Binary().subspan(static_cast<size_t>(indices.offset), static_cast<size_t>(indices.count) * streams.indexSize));
+		streams.bounds.min = { position.min[0], position.min[1], position.min[2] };
+		streams.bounds.max = { position.max[0], position.max[1], position.max[2] };
+
+		mesh.meshlets = {};
+		mesh.lods = { Djinn::MeshLod{ 0, indices.count, 0.0f } };
+		mesh.submeshes = { Djinn::Submesh{ 0, indices.count,
+			primitive.material >= 0 ? static_cast<uint32_t>(primitive.material) : Djinn::NO_MATERIAL, 0, 0, streams.bounds } };
+		mesh.submeshLods = mesh.lods;
+		mesh.dequantize = glm::mat4{ 1.0f };
+		return true;
+	}
+
+	// every primitive appended into one indexed vertex list as a submesh of its own, missing attributes get the OBJ defaults
+	bool convertGltf(const Djinn::GltfFile& glb, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+		std::vector<Djinn::Submesh>& submeshes)
+	{
+		const auto accessors{ glb.Accessors() };
+		for (const Djinn::GltfPrimitive& primitive : glb.Primitives())
+		{
+			const Djinn::GltfAccessor& position{ accessors[static_cast<size_t>(primitive.position)] };
+			const auto attribute{ [&](const int32_t index) -> const Djinn::GltfAccessor*
+				{
+					return index >= 0 && accessors[static_cast<size_t>(index)].count >= position.count ? &accessors[static_cast<size_t>(index)] : nullptr;
+				} };
+			const Djinn::GltfAccessor* normal{ attribute(primitive.normal) };
+			const Djinn::GltfAccessor* texCoord{ attribute(primitive.texCoord) };
+			const Djinn::GltfAccessor* color{ attribute(primitive.color) };
+
+			const auto base{ static_cast<uint32_t>(vertices.size()) };
+			Djinn::Submesh submesh{};
+			submesh.indexOffset = static_cast<uint32_t>(indices.size());
+			submesh.material = primitive.material >= 0 ? static_cast<uint32_t>(primitive.material) : Djinn::NO_MATERIAL;
+			for (uint32_t i = 0; i < position.count; ++i)
+			{
+				float values[4]{};
+				Vertex vertex{};
+				glb.ReadFloats(position, i, values);
+				vertex.position = { values[0], values[1], values[2] };
+				vertex.color = { 1.0f, 1.0f, 1.0f };
+				vertex.normal = { 1.0f, 1.0f, 1.0f };
+				if (normal != nullptr)
+				{
+					glb.ReadFloats(*normal, i, values);
+					vertex.normal = { values[0], values[1], values[2] };
+				}
+				if (texCoord != nullptr)
+				{
+					glb.ReadFloats(*texCoord, i, values);
+					vertex.texCoord = { values[0], values[1] };
+				}
+				if (color != nullptr)
+				{
+					glb.ReadFloats(*color, i, values);
+					vertex.color = { values[0], values[1], values[2] };
+				}
+				vertices.push_back(vertex);
+			}
+
+			if (primitive.indices < 0)
+			{
+				for (uint32_t i = 0; i + 2 < position.count; i += 3)
+				{
+					indices.insert(indices.end(), { base + i, base + i + 1, base + i + 2 });
+				}
+			}
+			else
+			{
+				const Djinn::GltfAccessor& primitiveIndices{ accessors[static_cast<size_t>(primitive.indices)] };
+				for (uint32_t i = 0; i + 2 < primitiveIndices.count; i += 3)
+				{
+					uint32_t triangle[3];
+					for (uint32_t corner = 0; corner < 3; ++corner)
+					{
+						triangle[corner] = glb.ReadIndex(primitiveIndices, i + corner);
+					}
+					if (triangle[0] >= position.count || triangle[1] >= position.count || triangle[2] >= position.count)
+					{
+						return false;
+					}
+					indices.insert(indices.end(), { base + triangle[0], base + triangle[1], base + triangle[2] });
+				}
+			}
+
+			submesh.indexCount = static_cast<uint32_t>(indices.size()) - submesh.indexOffset;
+			if (submesh.indexCount > 0)
+			{
+				submeshes.push_back(submesh);
+			}
+		}
+		return !indices.empty();
+	}
+
+	void bindCachedMesh(Djinn::MeshAsset& mesh)
+	{
+		mesh.streams = mesh.cache.Streams();
+		mesh.meshlets = mesh.cache.Meshlets();
+		mesh.lods.assign(mesh.cache.Lods().begin(), mesh.cache.Lods().end());
+		mesh.submeshes.assign(mesh.cache.Submeshes().begin(), mesh.cache.Submeshes().end());
+		mesh.submeshLods.assign(mesh.cache.SubmeshLods().begin(), mesh.cache.SubmeshLods().end());
+		if (mesh.streams.vertexFormat == VertexFormat::VERTEX_FORMAT_COMPACT)
+		{
+			mesh.dequantize = Djinn::dequantizeTransform(mesh.streams.bounds);
+		}
+	}
+}
+
+bool Djinn::loadMeshAsset(const std::string& path, const VertexFormat requestedFormat, const bool splitPositions, MeshAsset& mesh)
+{
+	mesh.path = path;
+
+	// a valid cache is mapped and uploaded as is, skipping parsing and vertex dedup
+	if (mesh.cache.Load(path, requestedFormat, splitPositions))
+	{
+		bindCachedMesh(mesh);
+		spdlog::info("Loaded {} from mesh cache", path);
+		return true;
+	}
+
+	if (isGlb(path))
+	{
+		if (!mesh.glb.Open(path))
+		{
+			spdlog::error("Failed to load model: {}", path);
+			return false;
+		}
+		// quantizing is per vertex work the caller asked for, only the full format can take the accessors as they are
+		if (requestedFormat == VertexFormat::VERTEX_FORMAT_FULL && bindGltfStreams(mesh))
+		{
+			spdlog::info("Mapped {} in place ({} vertices, {} indices x {} bytes)", path, mesh.streams.vertexCount,
+				mesh.streams.indexCount, mesh.streams.indexSize);
+			return true;
+		}
+
+		const bool converted{ convertGltf(mesh.glb, mesh.vertices, mesh.indices, mesh.submeshes) };
+		mesh.glb.Close();
+		if (!converted)
+		{
+			spdlog::error("Failed to load model: {}", path);
+			return false;
+		}
+		spdlog::info("Converted {} ({} vertices, {} primitives)", path, mesh.vertices.size(), mesh.submeshes.size());
+		return processMesh(path, requestedFormat, splitPositions, mesh);
+	}
+
+	ObjMesh objMesh;
+	if (!parseObj(path, objMesh) || objMesh.indices.empty())
+	{
+		spdlog::error("Failed to load model: {}", path);
+		return false;
+	}
+
+	const auto fetchCorner = [&objMesh](const size_t corner)
+	{
+		const auto& index{ objMesh.indices[corner] };
+		Vertex vertex{};
+
+		const auto position{ 3 * static_cast<size_t>(index.position) };
+		vertex.position =
+		{
+			objMesh.positions[position + 0],
+			objMesh.positions[position + 1],
+			objMesh.positions[position + 2]
+		};
+
+		if (index.texCoord >= 0)
+		{
+			const auto texCoord{ 2 * static_cast<size_t>(index.texCoord) };
+			vertex.texCoord =
+			{
+				objMesh.texCoords[texCoord + 0],
+				1.0f - objMesh.texCoords[texCoord + 1]
+			};
+		}
+
+		vertex.color = { 1.0f, 1.0f, 1.0f };
+		vertex.normal = { 1.0f, 1.0f, 1.0f };
+		return vertex;
+	};
+
+	const auto weldStats{ weldVertices(objMesh.indices.size(), fetchCorner, mesh.vertices, mesh.indices) };
+	spdlog::info("Welded {} of {} vertices into {} unique ({} shards)", weldStats.weldedVertices,
+		weldStats.inputVertices, weldStats.uniqueVertices, weldStats.shards);
+
+	// welding keeps one index per corner, so the shapes map straight onto index ranges
+	mesh.submeshes.clear();
+	for (size_t i = 0; i < objMesh.shapes.size(); ++i)
+	{
+		const uint32_t end{ i + 1 < objMesh.shapes.size() ? objMesh.shapes[i + 1].firstIndex : static_cast<uint32_t>(mesh.indices.size()) };
+		Submesh submesh{};
+		submesh.indexOffset = objMesh.shapes[i].firstIndex;
+		submesh.indexCount = end - submesh.indexOffset;
+		submesh.material = objMesh.shapes[i].material;
+		mesh.submeshes.push_back(submesh);
+	}
+
+	return processMesh(path, requestedFormat, splitPositions, mesh);
+}
+
+// vertices and indices are filled in, the rest of the pipeline is the same whatever the source
+bool Djinn::processMesh(const std::string& path, const VertexFormat requestedFormat, const bool splitPositions, MeshAsset& mesh)
+{
+	if (mesh.submeshes.empty())
+	{
+		mesh.submeshes = { Submesh{ 0, static_cast<uint32_t>(mesh.indices.size()) } };
+	}
+
+	const auto optimizeStats{ optimizeMesh(mesh.vertices, mesh.indices, mesh.submeshes) };
+	spdlog::info("Vertex cache ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f} ({} overdraw clusters)",
+		optimizeStats.before.acmr, optimizeStats.after.acmr, optimizeStats.before.atvr, optimizeStats.after.atvr,
+		optimizeStats.clusters);
+
+	for (Submesh& submesh : mesh.submeshes)
+	{
+		submesh.bounds = indexedBounds(mesh.vertices, std::span<const uint32_t>{ mesh.indices }.subspan(submesh.indexOffset, submesh.indexCount));
+	}
+	spdlog::info("{} submeshes", mesh.submeshes.size());
+
+	buildMeshlets(mesh.vertices, mesh.indices, mesh.submeshes, mesh.meshletData);
+	mesh.meshlets = mesh.meshletData.View();
+	spdlog::info("Built {} meshlets ({} vertices / {} triangles max)", mesh.meshlets.meshlets.size(),
+		MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES);
+
+	// meshlets cover LOD 0, the index buffer gets every level back to back
+	std::vector<uint32_t> lodIndices;
+	generateLods(mesh.vertices, mesh.indices, mesh.submeshes, mesh.lods, mesh.submeshLods, lodIndices);
+	mesh.indices.swap(lodIndices);
+	for (size_t lod = 0; lod < mesh.lods.size(); ++lod)
+	{
+		spdlog::info("LOD {}: {} triangles, error {:.5f}", lod, mesh.lods[lod].indexCount / 3, mesh.lods[lod].error);
+	}
+
+	buildMeshStreams(requestedFormat, splitPositions, mesh);
+
+	if (!MeshCache::Store(path, requestedFormat, mesh.streams, mesh.meshlets, mesh.lods, mesh.submeshes, mesh.submeshLods))
+	{
+		spdlog::warn("Failed to write mesh cache for {}", path);
+	}
+	return true;
+}
+
+bool Djinn::loadPackedMeshAsset(const AssetPack& pack, const std::string& path, const VertexFormat requestedFormat,
+	const bool splitPositions, MeshAsset& mesh)
+{
+	mesh.path = path;
+
+	if (!mesh.cache.LoadPacked(pack.Find(path, PackEntryType::PACK_ENTRY_MESH, mesh.packedData), requestedFormat, splitPositions))
+	{
+		return false;
+	}
+
+	bindCachedMesh(mesh);
+	spdlog::info("Loaded {} from asset pack", path);
+	return true;
+}
+
+void Djinn::buildPlaceholderMesh(const VertexFormat requestedFormat, const bool splitPositions, MeshAsset& mesh)
+{
+	mesh.path = "placeholder";
+	mesh.vertices.clear();
+	for (uint32_t corner = 0; corner < 8; ++corner)
+	{
+		Vertex vertex{};
+		vertex.position =
+		{
+			(corner & 1) ? 0.5f : -0.5f,
+			(corner & 2) ? 0.5f : -0.5f,
+			(corner & 4) ? 0.5f : -0.5f
+		};
+		vertex.color = { 1.0f, 1.0f, 1.0f };
+		vertex.normal = { 1.0f, 1.0f, 1.0f };
+		mesh.vertices.push_back(vertex);
+	}
+
+	// two counter clockwise triangles per face, seen from outside
+	mesh.indices =
+	{
+		0, 2, 3, 0, 3, 1,	// -z
+		4, 5, 7, 4, 7, 6,	// +z
+		0, 1, 5, 0, 5, 4,	// -y
+		2, 6, 7, 2, 7, 3,	// +y
+		0, 4, 6, 0, 6, 2,	// -x
+		1, 3, 7, 1, 7, 5	// +x
+	};
+
+	mesh.submeshes = { Submesh{ 0, static_cast<uint32_t>(mesh.indices.size()) } };
+	mesh.submeshes[0].bounds = indexedBounds(mesh.vertices, mesh.indices);
+	buildMeshlets(mesh.vertices, mesh.indices, mesh.submeshes, mesh.meshletData);
+	mesh.meshlets = mesh.meshletData.View();
+	mesh.lods = { MeshLod{ 0, static_cast<uint32_t>(mesh.indices.size()), 0.0f } };
+	mesh.submeshLods = mesh.lods;
+
+	buildMeshStreams(requestedFormat, splitPositions, mesh);
+}
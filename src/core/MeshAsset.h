@@ -0,0 +1,65 @@
+#ifndef MESH_ASSET_INCLUDE_H
+#define MESH_ASSET_INCLUDE_H
+
+#include <string>
+#include <vector>
+
+#include "Primitives.h"
+#include "MeshCache.h"
+#include "Meshlet.h"
+#include "MeshLod.h"
+#include "AssetPack.h"
+#include "GltfLoader.h"
+
+namespace Djinn
+{
+	// a model ready for upload, streams and meshlets view either the vectors or the mapped cache
+	// the views point into the asset itself, keep it at a stable address (the streamer hands out shared_ptrs)
+	struct MeshAsset
+	{
+		std::string path;
+		// source bytes and import settings, equal keys are the same mesh, 0 for the placeholder
+		uint64_t contentKey{ 0 };
+
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		std::vector<CompactVertex> compactVertices;
+		std::vector<uint16_t> indices16;
+		// positions and the remaining attributes when the streams are split
+		std::vector<std::byte> positionData;
+		std::vector<std::byte> attributeData;
+		MeshCache cache;
+		// a compressed pack entry decoded, the cache views it instead of the mapping
+		std::vector<uint8_t> packedData;
+		// a .glb whose accessors are used in place, the streams view its binary chunk
+		GltfFile glb;
+
+		MeshStreams streams;
+		MeshletData meshletData;
+		MeshletView meshlets;
+		std::vector<MeshLod> lods;
+		// one per OBJ shape or glTF primitive, submeshLods holds lods.size() rows of one range per submesh
+		std::vector<Submesh> submeshes;
+		std::vector<MeshLod> submeshLods;
+		// folded into the model matrix, identity unless positions are quantized
+		glm::mat4 dequantize{ 1.0f };
+	};
+
+	// parse, weld, optimize, cluster and simplify, or map the cache if it is current
+	// a .glb whose single primitive already has float position, normal and uv accessors is mapped and used as is
+	// (VERTEX_FORMAT_GLTF, no meshlets or LODs), any other glTF layout is converted and processed like an OBJ
+	// splitPositions stores positions in a stream of their own, for passes that read nothing else
+	// touches nothing but the asset and the cache file, safe to run on any thread
+	bool loadMeshAsset(const std::string& path, const VertexFormat requestedFormat, const bool splitPositions, MeshAsset& mesh);
+	// optimize, cluster, simplify and build the streams of mesh.vertices / mesh.indices, then write the cache
+	// mesh.submeshes may split the indices into ranges, every step keeps them apart; empty means one for everything
+	bool processMesh(const std::string& path, const VertexFormat requestedFormat, const bool splitPositions, MeshAsset& mesh);
+	// maps the cooked mesh out of the pack, false if it isn't there in the requested layout
+	bool loadPackedMeshAsset(const AssetPack& pack, const std::string& path, const VertexFormat requestedFormat,
+		const bool splitPositions, MeshAsset& mesh);
+
+	// unit cube drawn until the real mesh is resident
+	void buildPlaceholderMesh(const VertexFormat requestedFormat, const bool splitPositions, MeshAsset& mesh);
+}
+
+#endif // MESH_ASSET_INCLUDE_H
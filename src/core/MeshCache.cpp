@@ -0,0 +1,331 @@
+#include "MeshCache.h"
+#include "../DjinnLib/FileStamp.h"
+
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <spdlog/spdlog.h>
+
+namespace
+{
+	constexpr uint64_t alignUp(const uint64_t value, const uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	void writePadding(std::ofstream& out, const uint64_t from, const uint64_t to)
+	{
+		constexpr char zeros[Djinn::MESH_CACHE_ALIGNMENT]{};
+		out.write(zeros, static_cast<std::streamsize>(to - from));
+	}
+
+	bool sectionInBounds(const uint64_t offset, const uint64_t size, const uint64_t fileSize)
+	{
+		return offset % Djinn::MESH_CACHE_ALIGNMENT == 0 && offset <= fileSize && size <= fileSize - offset;
+	}
+
+	bool rangeInBounds(const uint64_t offset, const uint64_t count, const uint64_t total)
+	{
+		return offset <= total && count <= total - offset;
+	}
+
+	// the stored ranges go straight into draws and the meshlet buffers, a stale or corrupt one must not reach past them
+	bool lodsInBounds(std::span<const Djinn::MeshLod> lods, const uint64_t indexCount)
+	{
+		for (const auto& lod : lods)
+		{
+			if (!rangeInBounds(lod.indexOffset, lod.indexCount, indexCount))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool submeshesInBounds(std::span<const Djinn::Submesh> submeshes, const uint64_t indexCount, const uint64_t meshletCount)
+	{
+		for (const auto& submesh : submeshes)
+		{
+			if (!rangeInBounds(submesh.indexOffset, submesh.indexCount, indexCount) ||
+				!rangeInBounds(submesh.meshletOffset, submesh.meshletCount, meshletCount))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool meshletsInBounds(const Djinn::MeshletView& view)
+	{
+		for (const auto& meshlet : view.meshlets)
+		{
+			if (meshlet.vertexCount > Djinn::MESHLET_MAX_VERTICES || meshlet.triangleCount > Djinn::MESHLET_MAX_TRIANGLES ||
+				!rangeInBounds(meshlet.vertexOffset, meshlet.vertexCount, view.vertices.size()) ||
+				!rangeInBounds(meshlet.triangleOffset, uint64_t{ meshlet.triangleCount } * 3, view.triangles.size()))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	template <typename T>
+	std::span<const T> sectionView(const uint8_t* data, const uint64_t offset, const uint64_t count)
+	{
+		return { reinterpret_cast<const T*>(data + offset), static_cast<size_t>(count) };
+	}
+
+	template <typename T>
+	void writeSection(std::ofstream& out, uint64_t& cursor, const uint64_t offset, std::span<const T> data)
+	{
+		writePadding(out, cursor, offset);
+		out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size_bytes()));
+		cursor = offset + data.size_bytes();
+	}
+}
+
+std::string Djinn::MeshCache::CachePath(const std::string& sourcePath)
+{
+	return sourcePath + MESH_CACHE_EXTENSION;
+}
+
+bool Djinn::MeshCache::Load(const std::string& sourcePath, const VertexFormat requestedFormat, const bool splitPositions)
+{
+	CleanUp();
+
+	FileStamp source;
+	if (!queryFileStamp(sourcePath, source))
+	{
+		return false;
+	}
+
+	if (!file.Open(CachePath(sourcePath)))
+	{
+		return false;
+	}
+
+	const auto header{ validate({ file.Data(), file.Size() }, requestedFormat, splitPositions) };
+	if (header == nullptr || header->sourceSize != source.size || header->sourceWriteTime != source.writeTime)
+	{
+		spdlog::info("Mesh cache for {} is stale, rebuilding", sourcePath);
+		CleanUp();
+		return false;
+	}
+
+	p_data = file.Data();
+	p_header = header;
+	return true;
+}
+
+bool Djinn::MeshCache::LoadPacked(std::span<const uint8_t> image, const VertexFormat requestedFormat, const bool splitPositions)
+{
+	CleanUp();
+
+	const auto header{ validate(image, requestedFormat, splitPositions) };
+	if (header == nullptr)
+	{
+		return false;
+	}
+
+	p_data = image.data();
+	p_header = header;
+	return true;
+}
+
+const Djinn::MeshCacheHeader* Djinn::MeshCache::validate(std::span<const uint8_t> image, const VertexFormat requestedFormat,
+	const bool splitPositions)
+{
+	const uint64_t fileSize{ image.size() };
+	if (fileSize < sizeof(MeshCacheHeader))
+	{
+		return nullptr;
+	}
+
+	const auto header{ reinterpret_cast<const MeshCacheHeader*>(image.data()) };
+	const VertexLayoutInfo& layout{ vertexLayoutInfo(header->vertexFormat) };
+
+	const bool valid{ header->magic == MESH_CACHE_MAGIC &&
+		header->version == MESH_CACHE_VERSION &&
+		header->requestedFormat == requestedFormat &&
+		header->vertexLayoutHash == layout.layoutHash &&
+		header->positionStride == (splitPositions ? layout.positionSize : 0) &&
+		header->vertexStride == layout.stride - header->positionStride &&
+		(header->indexSize == sizeof(uint16_t) || header->indexSize == sizeof(uint32_t)) };
+
+	const bool inBounds{ valid &&
+		sectionInBounds(header->positionOffset, static_cast<uint64_t>(header->vertexCount) * header->positionStride, fileSize) &&
+		sectionInBounds(header->vertexOffset, static_cast<uint64_t>(header->vertexCount) * header->vertexStride, fileSize) &&
+		sectionInBounds(header->indexOffset, static_cast<uint64_t>(header->indexCount) * header->indexSize, fileSize) &&
+		sectionInBounds(header->meshletOffset, static_cast<uint64_t>(header->meshletCount) * sizeof(Meshlet), fileSize) &&
+		sectionInBounds(header->meshletVertexOffset, static_cast<uint64_t>(header->meshletVertexCount) * sizeof(uint32_t), fileSize) &&
+		sectionInBounds(header->meshletTriangleOffset, header->meshletTriangleBytes, fileSize) &&
+		sectionInBounds(header->meshletBoundsOffset, static_cast<uint64_t>(header->meshletCount) * sizeof(MeshletBounds), fileSize) &&
+		header->lodCount > 0 &&
+		sectionInBounds(header->lodOffset, static_cast<uint64_t>(header->lodCount) * sizeof(MeshLod), fileSize) &&
+		header->submeshCount > 0 &&
+		sectionInBounds(header->submeshOffset, static_cast<uint64_t>(header->submeshCount) * sizeof(Submesh), fileSize) &&
+		sectionInBounds(header->submeshLodOffset, static_cast<uint64_t>(header->lodCount) * header->submeshCount * sizeof(MeshLod), fileSize) };
+
+	if (!inBounds)
+	{
+		return nullptr;
+	}
+
+	MeshletView meshlets{};
+	meshlets.meshlets = sectionView<Meshlet>(image.data(), header->meshletOffset, header->meshletCount);
+	meshlets.vertices = sectionView<uint32_t>(image.data(), header->meshletVertexOffset, header->meshletVertexCount);
+	meshlets.triangles = sectionView<uint8_t>(image.data(), header->meshletTriangleOffset, header->meshletTriangleBytes);
+
+	const bool rangesInBounds{ lodsInBounds(sectionView<MeshLod>(image.data(), header->lodOffset, header->lodCount), header->indexCount) &&
+		meshletsInBounds(meshlets) &&
+		submeshesInBounds(sectionView<Submesh>(image.data(), header->submeshOffset, header->submeshCount), header->indexCount, header->meshletCount) &&
+		lodsInBounds(sectionView<MeshLod>(image.data(), header->submeshLodOffset, static_cast<uint64_t>(header->lodCount) * header->submeshCount),
+			header->indexCount) };
+
+	return rangesInBounds ? header : nullptr;
+}
+
+void Djinn::MeshCache::CleanUp()
+{
+	p_data = nullptr;
+	p_header = nullptr;
+	file.Close();
+}
+
+MeshStreams Djinn::MeshCache::Streams() const
+{
+	assert(p_header != nullptr);
+
+	MeshStreams streams{};
+	streams.vertexFormat = p_header->vertexFormat;
+	streams.vertexStride = p_header->vertexStride;
+	streams.vertexCount = p_header->vertexCount;
+	streams.vertexBytes = { reinterpret_cast<const std::byte*>(p_data + p_header->vertexOffset),
+		static_cast<size_t>(p_header->vertexCount) * p_header->vertexStride };
+	streams.positionStride = p_header->positionStride;
+	streams.positionBytes = { reinterpret_cast<const std::byte*>(p_data + p_header->positionOffset),
+		static_cast<size_t>(p_header->vertexCount) * p_header->positionStride };
+	streams.indexSize = p_header->indexSize;
+	streams.indexCount = p_header->indexCount;
+	streams.indexBytes = { reinterpret_cast<const std::byte*>(p_data + p_header->indexOffset),
+		static_cast<size_t>(p_header->indexCount) * p_header->indexSize };
+	streams.bounds.min = { p_header->boundsMin[0], p_header->boundsMin[1], p_header->boundsMin[2] };
+	streams.bounds.max = { p_header->boundsMax[0], p_header->boundsMax[1], p_header->boundsMax[2] };
+	return streams;
+}
+
+Djinn::MeshletView Djinn::MeshCache::Meshlets() const
+{
+	assert(p_header != nullptr);
+
+	MeshletView view{};
+	view.meshlets = sectionView<Meshlet>(p_data, p_header->meshletOffset, p_header->meshletCount);
+	view.vertices = sectionView<uint32_t>(p_data, p_header->meshletVertexOffset, p_header->meshletVertexCount);
+	view.triangles = sectionView<uint8_t>(p_data, p_header->meshletTriangleOffset, p_header->meshletTriangleBytes);
+	view.bounds = sectionView<MeshletBounds>(p_data, p_header->meshletBoundsOffset, p_header->meshletCount);
+	return view;
+}
+
+std::span<const Djinn::MeshLod> Djinn::MeshCache::Lods() const
+{
+	assert(p_header != nullptr);
+	return sectionView<MeshLod>(p_data, p_header->lodOffset, p_header->lodCount);
+}
+
+std::span<const Djinn::Submesh> Djinn::MeshCache::Submeshes() const
+{
+	assert(p_header != nullptr);
+	return sectionView<Submesh>(p_data, p_header->submeshOffset, p_header->submeshCount);
+}
+
+std::span<const Djinn::MeshLod> Djinn::MeshCache::SubmeshLods() const
+{
+	assert(p_header != nullptr);
+	return sectionView<MeshLod>(p_data, p_header->submeshLodOffset, static_cast<uint64_t>(p_header->lodCount) * p_header->submeshCount);
+}
+
+bool Djinn::MeshCache::Store(const std::string& sourcePath, const VertexFormat requestedFormat, const MeshStreams& streams,
+	const MeshletView& meshlets, std::span<const MeshLod> lods, std::span<const Submesh> submeshes, std::span<const MeshLod> submeshLods)
+{
+	assert(submeshLods.size() == lods.size() * submeshes.size());
+
+	FileStamp source;
+	if (!queryFileStamp(sourcePath, source))
+	{
+		return false;
+	}
+
+	MeshCacheHeader header{};
+	header.magic = MESH_CACHE_MAGIC;
+	header.version = MESH_CACHE_VERSION;
+	header.vertexLayoutHash = vertexLayoutInfo(streams.vertexFormat).layoutHash;
+	header.requestedFormat = requestedFormat;
+	header.vertexFormat = streams.vertexFormat;
+	header.sourceSize = source.size;
+	header.sourceWriteTime = source.writeTime;
+	header.positionStride = streams.positionStride;
+	header.vertexStride = streams.vertexStride;
+	header.vertexCount = streams.vertexCount;
+	header.indexSize = streams.indexSize;
+	header.indexCount = streams.indexCount;
+	header.positionOffset = alignUp(sizeof(MeshCacheHeader), MESH_CACHE_ALIGNMENT);
+	header.vertexOffset = alignUp(header.positionOffset + streams.positionBytes.size(), MESH_CACHE_ALIGNMENT);
+	header.indexOffset = alignUp(header.vertexOffset + streams.vertexBytes.size(), MESH_CACHE_ALIGNMENT);
+	for (int i = 0; i < 3; ++i)
+	{
+		header.boundsMin[i] = streams.bounds.min[i];
+		header.boundsMax[i] = streams.bounds.max[i];
+	}
+
+	header.meshletCount = static_cast<uint32_t>(meshlets.meshlets.size());
+	header.meshletVertexCount = static_cast<uint32_t>(meshlets.vertices.size());
+	header.meshletTriangleBytes = static_cast<uint32_t>(meshlets.triangles.size());
+	header.meshletOffset = alignUp(header.indexOffset + streams.indexBytes.size(), MESH_CACHE_ALIGNMENT);
+	header.meshletVertexOffset = alignUp(header.meshletOffset + meshlets.meshlets.size_bytes(), MESH_CACHE_ALIGNMENT);
+	header.meshletTriangleOffset = alignUp(header.meshletVertexOffset + meshlets.vertices.size_bytes(), MESH_CACHE_ALIGNMENT);
+	header.meshletBoundsOffset = alignUp(header.meshletTriangleOffset + meshlets.triangles.size_bytes(), MESH_CACHE_ALIGNMENT);
+	header.lodCount = static_cast<uint32_t>(lods.size());
+	header.lodOffset = alignUp(header.meshletBoundsOffset + meshlets.bounds.size_bytes(), MESH_CACHE_ALIGNMENT);
+	header.submeshCount = static_cast<uint32_t>(submeshes.size());
+	header.submeshOffset = alignUp(header.lodOffset + lods.size_bytes(), MESH_CACHE_ALIGNMENT);
+	header.submeshLodOffset = alignUp(header.submeshOffset + submeshes.size_bytes(), MESH_CACHE_ALIGNMENT);
+
+	// write to a temporary and rename so a crash never leaves a half written cache behind
+	const std::string cachePath{ CachePath(sourcePath) };
+	const std::string tempPath{ cachePath + ".tmp" };
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+		{
+			return false;
+		}
+
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		uint64_t cursor{ sizeof(header) };
+		writeSection(out, cursor, header.positionOffset, streams.positionBytes);
+		writeSection(out, cursor, header.vertexOffset, streams.vertexBytes);
+		writeSection(out, cursor, header.indexOffset, streams.indexBytes);
+		writeSection(out, cursor, header.meshletOffset, meshlets.meshlets);
+		writeSection(out, cursor, header.meshletVertexOffset, meshlets.vertices);
+		writeSection(out, cursor, header.meshletTriangleOffset, meshlets.triangles);
+		writeSection(out, cursor, header.meshletBoundsOffset, meshlets.bounds);
+		writeSection(out, cursor, header.lodOffset, lods);
+		writeSection(out, cursor, header.submeshOffset, submeshes);
+		writeSection(out, cursor, header.submeshLodOffset, submeshLods);
+
+		if (!out.good())
+		{
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, cachePath, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+
+	return true;
+}
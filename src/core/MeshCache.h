@@ -0,0 +1,97 @@
+#ifndef MESH_CACHE_INCLUDE_H
+#define MESH_CACHE_INCLUDE_H
+
+#include <string>
+#include <span>
+
+#include "Primitives.h"
+#include "Meshlet.h"
+#include "MeshLod.h"
+#include "../DjinnLib/MappedFile.h"
+
+namespace Djinn
+{
+	constexpr uint32_t MESH_CACHE_MAGIC{ 0x434d4a44 }; // "DJMC"
+	constexpr uint32_t MESH_CACHE_VERSION{ 7 };
+	// every section starts on this boundary so the mapped data can be used in place
+	constexpr uint64_t MESH_CACHE_ALIGNMENT{ 64 };
+	const std::string MESH_CACHE_EXTENSION{ ".meshcache" };
+
+	struct MeshCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t vertexLayoutHash;
+		// the format the loader asked for, the stored one may differ if compression was not possible
+		VertexFormat requestedFormat;
+		VertexFormat vertexFormat;
+
+		// identity of the source file the cache was built from
+		uint64_t sourceSize;
+		int64_t sourceWriteTime;
+
+		// positionStride is 0 unless positions are split into their own section
+		// vertexStride then only covers the remaining attributes
+		uint32_t positionStride;
+		uint32_t vertexStride;
+		uint32_t vertexCount;
+		uint32_t indexSize;
+		uint32_t indexCount;
+		uint64_t positionOffset;
+		uint64_t vertexOffset;
+		uint64_t indexOffset;
+
+		float boundsMin[3];
+		float boundsMax[3];
+
+		uint32_t meshletCount;
+		uint32_t meshletVertexCount;
+		uint32_t meshletTriangleBytes;
+		uint64_t meshletOffset;
+		uint64_t meshletVertexOffset;
+		uint64_t meshletTriangleOffset;
+		uint64_t meshletBoundsOffset;
+
+		// the index section holds every LOD back to back
+		uint32_t lodCount;
+		uint64_t lodOffset;
+
+		// lodCount rows of submeshCount ranges follow the submeshes
+		uint32_t submeshCount;
+		uint64_t submeshOffset;
+		uint64_t submeshLodOffset;
+	};
+
+	// binary image of a processed mesh, written next to the source model
+	// a valid cache is mapped and handed to the staging buffers without touching the source
+	class MeshCache
+	{
+	public:
+		// returns false if there is no cache for sourcePath and format or it is stale
+		bool Load(const std::string& sourcePath, const VertexFormat requestedFormat, const bool splitPositions);
+		// uses a cache image cooked into a pack, the pack keeps it mapped
+		bool LoadPacked(std::span<const uint8_t> image, const VertexFormat requestedFormat, const bool splitPositions);
+		void CleanUp();
+
+		// views into the mapped file or pack entry, valid until CleanUp
+		MeshStreams Streams() const;
+		MeshletView Meshlets() const;
+		std::span<const MeshLod> Lods() const;
+		std::span<const Submesh> Submeshes() const;
+		std::span<const MeshLod> SubmeshLods() const;
+
+		static std::string CachePath(const std::string& sourcePath);
+		static bool Store(const std::string& sourcePath, const VertexFormat requestedFormat, const MeshStreams& streams,
+			const MeshletView& meshlets, std::span<const MeshLod> lods, std::span<const Submesh> submeshes, std::span<const MeshLod> submeshLods);
+
+	private:
+		static const MeshCacheHeader* validate(std::span<const uint8_t> image, const VertexFormat requestedFormat,
+			const bool splitPositions);
+
+		MappedFile file;
+		const uint8_t* p_data{ nullptr };
+		const MeshCacheHeader* p_header{ nullptr };
+	};
+}
+
+#endif // MESH_CACHE_INCLUDE_H
@@ -0,0 +1,596 @@
+#include "MeshLod.h"
+#include "MeshOptimize.h"
+#include "../DjinnLib/Parallel.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <tuple>
+
+namespace
+{
+	constexpr float BORDER_WEIGHT{ 10.0f };
+	// collapses may rotate a neighbouring triangle by at most ~75 degrees
+	constexpr float MAX_NORMAL_ROTATION_COS{ 0.25f };
+
+	struct Quadric
+	{
+		float a00{ 0.0f }, a11{ 0.0f }, a22{ 0.0f };
+		float a10{ 0.0f }, a20{ 0.0f }, a21{ 0.0f };
+		float b0{ 0.0f }, b1{ 0.0f }, b2{ 0.0f };
+		float c{ 0.0f };
+		float weight{ 0.0f };
+
+		Quadric& operator+=(const Quadric& other)
+		{
+			a00 += other.a00; a11 += other.a11; a22 += other.a22;
+			a10 += other.a10; a20 += other.a20; a21 += other.a21;
+			b0 += other.b0; b1 += other.b1; b2 += other.b2;
+			c += other.c;
+			weight += other.weight;
+			return *this;
+		}
+	};
+
+	// squared distance to the plane dot(normal, p) + d = 0, scaled by weight
+	Quadric planeQuadric(const glm::vec3& normal, const float d, const float weight)
+	{
+		Quadric q{};
+		q.a00 = normal.x * normal.x * weight;
+		q.a11 = normal.y * normal.y * weight;
+		q.a22 = normal.z * normal.z * weight;
+		q.a10 = normal.y * normal.x * weight;
+		q.a20 = normal.z * normal.x * weight;
+		q.a21 = normal.z * normal.y * weight;
+		q.b0 = normal.x * d * weight;
+		q.b1 = normal.y * d * weight;
+		q.b2 = normal.z * d * weight;
+		q.c = d * d * weight;
+		q.weight = weight;
+		return q;
+	}
+
+	// weighted mean squared distance of p to all planes in the quadric
+	float quadricError(const Quadric& q, const glm::vec3& p)
+	{
+		const float rx{ q.a00 * p.x + q.a10 * p.y + q.a20 * p.z };
+		const float ry{ q.a10 * p.x + q.a11 * p.y + q.a21 * p.z };
+		const float rz{ q.a20 * p.x + q.a21 * p.y + q.a22 * p.z };
+		const float r{ rx * p.x + ry * p.y + rz * p.z + 2.0f * (q.b0 * p.x + q.b1 * p.y + q.b2 * p.z) + q.c };
+		return std::abs(r) / std::max(q.weight, 1e-12f);
+	}
+
+	uint64_t edgeKey(const uint32_t from, const uint32_t to)
+	{
+		return (static_cast<uint64_t>(from) << 32) | to;
+	}
+
+	// vertices that share a position are wedges of the same position, only the first one is used for topology
+	void buildPositionRemap(std::span<const Vertex> vertices, std::vector<uint32_t>& remap)
+	{
+		const auto positionKey = [&](const uint32_t vertex)
+		{
+			const glm::vec3& p{ vertices[vertex].position };
+			return std::tuple{ Djinn::FloatBits(p.x), Djinn::FloatBits(p.y), Djinn::FloatBits(p.z) };
+		};
+
+		std::vector<uint32_t> order(vertices.size());
+		std::iota(order.begin(), order.end(), 0u);
+		std::sort(order.begin(), order.end(), [&](const uint32_t lhs, const uint32_t rhs)
+			{
+				const auto lhsKey{ positionKey(lhs) };
+				const auto rhsKey{ positionKey(rhs) };
+				return lhsKey != rhsKey ? lhsKey < rhsKey : lhs < rhs;
+			});
+
+		remap.resize(vertices.size());
+		for (size_t begin = 0; begin < order.size();)
+		{
+			size_t end{ begin + 1 };
+			while (end < order.size() && positionKey(order[end]) == positionKey(order[begin]))
+			{
+				++end;
+			}
+			for (size_t i = begin; i < end; ++i)
+			{
+				remap[order[i]] = order[begin];
+			}
+			begin = end;
+		}
+	}
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		float error;
+	};
+
+	// counting sort on the top 11 bits of the (non negative) error, close enough to exact order and linear time
+	void sortCollapses(std::vector<Collapse>& collapses, std::vector<Collapse>& scratch)
+	{
+		constexpr uint32_t SORT_BITS{ 11 };
+		const auto bucketOf = [](const Collapse& collapse) { return std::bit_cast<uint32_t>(collapse.error) >> (32 - SORT_BITS); };
+
+		std::vector<uint32_t> offsets((1u << SORT_BITS) + 1, 0);
+		for (const auto& collapse : collapses)
+		{
+			++offsets[bucketOf(collapse) + 1];
+		}
+		std::inclusive_scan(offsets.begin(), offsets.end(), offsets.begin());
+
+		scratch.resize(collapses.size());
+		for (const auto& collapse : collapses)
+		{
+			scratch[offsets[bucketOf(collapse)]++] = collapse;
+		}
+		collapses.swap(scratch);
+	}
+
+	bool containsEdge(const std::vector<uint64_t>& sortedEdges, const uint64_t edge)
+	{
+		return std::binary_search(sortedEdges.begin(), sortedEdges.end(), edge);
+	}
+}
+
+float Djinn::simplifyScale(std::span<const Vertex> vertices)
+{
+	if (vertices.empty())
+	{
+		return 0.0f;
+	}
+
+	glm::vec3 minPosition{ vertices[0].position };
+	glm::vec3 maxPosition{ vertices[0].position };
+	for (const auto& vertex : vertices)
+	{
+		minPosition = glm::min(minPosition, vertex.position);
+		maxPosition = glm::max(maxPosition, vertex.position);
+	}
+	const glm::vec3 extent{ maxPosition - minPosition };
+	return std::max({ extent.x, extent.y, extent.z });
+}
+
+size_t Djinn::simplifyMesh(std::span<const Vertex> vertices, std::span<const uint32_t> indices, const size_t targetIndexCount,
+	const float targetError, std::vector<uint32_t>& destination, float* resultError)
+{
+	assert(indices.size() % 3 == 0);
+
+	const auto vertexCount{ static_cast<uint32_t>(vertices.size()) };
+	float maxError{ 0.0f };
+
+	// positions scaled to the unit cube so errors are relative
+	const float scale{ simplifyScale(vertices) };
+	const float invScale{ scale > 0.0f ? 1.0f / scale : 1.0f };
+	std::vector<glm::vec3> positions(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		positions[i] = vertices[i].position * invScale;
+	}
+
+	std::vector<uint32_t> remap;
+	buildPositionRemap(vertices, remap);
+
+	// drop triangles that are already degenerate in position space
+	destination.clear();
+	destination.reserve(indices.size());
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		const uint32_t a{ remap[indices[i + 0]] };
+		const uint32_t b{ remap[indices[i + 1]] };
+		const uint32_t c{ remap[indices[i + 2]] };
+		if (a != b && b != c && c != a)
+		{
+			destination.insert(destination.end(), { indices[i + 0], indices[i + 1], indices[i + 2] });
+		}
+	}
+
+	// an edge without its opposite half edge is on an open border
+	std::vector<uint64_t> halfEdges;
+	halfEdges.reserve(destination.size());
+	for (size_t i = 0; i < destination.size(); i += 3)
+	{
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			halfEdges.push_back(edgeKey(remap[destination[i + k]], remap[destination[i + (k + 1) % 3]]));
+		}
+	}
+	std::sort(halfEdges.begin(), halfEdges.end());
+
+	std::vector<Quadric> quadrics(vertexCount);
+	std::vector<bool> border(vertexCount, false);
+	std::vector<uint64_t> borderEdges;
+	for (size_t i = 0; i < destination.size(); i += 3)
+	{
+		const uint32_t corners[3]{ remap[destination[i + 0]], remap[destination[i + 1]], remap[destination[i + 2]] };
+		const glm::vec3& p0{ positions[corners[0]] };
+		const glm::vec3& p1{ positions[corners[1]] };
+		const glm::vec3& p2{ positions[corners[2]] };
+
+		glm::vec3 normal{ glm::cross(p1 - p0, p2 - p0) };
+		const float area{ glm::length(normal) };
+		if (area <= 0.0f)
+		{
+			continue;
+		}
+		normal /= area;
+
+		const Quadric face{ planeQuadric(normal, -glm::dot(normal, p0), area) };
+		for (const auto corner : corners)
+		{
+			quadrics[corner] += face;
+		}
+
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			const uint32_t from{ corners[k] };
+			const uint32_t to{ corners[(k + 1) % 3] };
+			if (containsEdge(halfEdges, edgeKey(to, from)))
+			{
+				continue;
+			}
+
+			// a plane through the border edge perpendicular to the face keeps the outline in place
+			const glm::vec3 edge{ positions[to] - positions[from] };
+			const float length{ glm::length(edge) };
+			glm::vec3 edgeNormal{ glm::cross(edge, normal) };
+			const float edgeNormalLength{ glm::length(edgeNormal) };
+			if (edgeNormalLength > 0.0f)
+			{
+				edgeNormal /= edgeNormalLength;
+				const Quadric edgeQuadric{ planeQuadric(edgeNormal, -glm::dot(edgeNormal, positions[from]), length * length * BORDER_WEIGHT) };
+				quadrics[from] += edgeQuadric;
+				quadrics[to] += edgeQuadric;
+			}
+
+			border[from] = true;
+			border[to] = true;
+			borderEdges.push_back(edgeKey(std::min(from, to), std::max(from, to)));
+		}
+	}
+	std::sort(borderEdges.begin(), borderEdges.end());
+	halfEdges = {};
+
+	// border vertices can only slide along the border
+	const auto collapseAllowed = [&](const uint32_t from, const uint32_t to)
+	{
+		return !border[from] || (border[to] && containsEdge(borderEdges, edgeKey(std::min(from, to), std::max(from, to))));
+	};
+
+	std::vector<uint32_t> vertexTarget(vertexCount);
+	std::vector<uint32_t> adjacencyCounts;
+	std::vector<uint32_t> adjacencyOffsets;
+	std::vector<uint32_t> adjacency;
+	std::vector<uint64_t> edges;
+	std::vector<Collapse> collapses;
+	std::vector<Collapse> scratch;
+	std::vector<bool> locked;
+	std::vector<std::pair<uint32_t, uint32_t>> wedgeMap;
+
+	const float maxCollapseError{ targetError * targetError };
+
+	while (destination.size() > targetIndexCount)
+	{
+		const size_t triangleCount{ destination.size() / 3 };
+
+		// triangles around every position
+		adjacencyCounts.assign(vertexCount, 0);
+		for (const auto index : destination)
+		{
+			++adjacencyCounts[remap[index]];
+		}
+		adjacencyOffsets.resize(vertexCount);
+		std::exclusive_scan(adjacencyCounts.begin(), adjacencyCounts.end(), adjacencyOffsets.begin(), 0u);
+		adjacency.resize(destination.size());
+		{
+			std::vector<uint32_t> cursors{ adjacencyOffsets };
+			for (size_t i = 0; i < destination.size(); ++i)
+			{
+				adjacency[cursors[remap[destination[i]]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+
+		// interior edges are seen from both sides, take the half edge going up, border edges only have one
+		edges.clear();
+		for (size_t i = 0; i < destination.size(); i += 3)
+		{
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				const uint32_t a{ remap[destination[i + k]] };
+				const uint32_t b{ remap[destination[i + (k + 1) % 3]] };
+				if (a < b || (border[a] && border[b] && containsEdge(borderEdges, edgeKey(b, a))))
+				{
+					edges.push_back(edgeKey(std::min(a, b), std::max(a, b)));
+				}
+			}
+		}
+
+		collapses.clear();
+		for (const auto edge : edges)
+		{
+			const auto a{ static_cast<uint32_t>(edge >> 32) };
+			const auto b{ static_cast<uint32_t>(edge) };
+
+			Quadric merged{ quadrics[a] };
+			merged += quadrics[b];
+
+			Collapse best{ a, b, std::numeric_limits<float>::max() };
+			if (collapseAllowed(a, b))
+			{
+				best.error = quadricError(merged, positions[b]);
+			}
+			if (collapseAllowed(b, a))
+			{
+				const float error{ quadricError(merged, positions[a]) };
+				if (error < best.error)
+				{
+					best = { b, a, error };
+				}
+			}
+			if (best.error <= maxCollapseError)
+			{
+				collapses.push_back(best);
+			}
+		}
+		sortCollapses(collapses, scratch);
+
+		// every collapse removes about two triangles
+		const size_t trianglesToRemove{ triangleCount - targetIndexCount / 3 };
+		size_t removed{ 0 };
+		size_t applied{ 0 };
+
+		std::iota(vertexTarget.begin(), vertexTarget.end(), 0u);
+		locked.assign(vertexCount, false);
+
+		for (const auto& collapse : collapses)
+		{
+			if (removed >= trianglesToRemove)
+			{
+				break;
+			}
+			if (locked[collapse.from] || locked[collapse.to])
+			{
+				continue;
+			}
+
+			const uint32_t begin{ adjacencyOffsets[collapse.from] };
+			const uint32_t end{ begin + adjacencyCounts[collapse.from] };
+
+			// every wedge around the collapsing position has to follow an edge to exactly one wedge of the target,
+			// this is what keeps UV seams intact
+			bool valid{ true };
+			uint32_t collapsedTriangles{ 0 };
+			wedgeMap.clear();
+			for (uint32_t k = begin; k < end && valid; ++k)
+			{
+				const uint32_t* corners{ &destination[3 * adjacency[k]] };
+				uint32_t fromWedge{ UINT32_MAX };
+				uint32_t toWedge{ UINT32_MAX };
+				for (uint32_t c = 0; c < 3; ++c)
+				{
+					if (remap[corners[c]] == collapse.from)
+					{
+						fromWedge = corners[c];
+					}
+					else if (remap[corners[c]] == collapse.to)
+					{
+						toWedge = corners[c];
+					}
+				}
+				if (toWedge == UINT32_MAX)
+				{
+					continue;
+				}
+				++collapsedTriangles;
+
+				const auto existing{ std::find_if(wedgeMap.begin(), wedgeMap.end(),
+					[fromWedge](const auto& entry) { return entry.first == fromWedge; }) };
+				if (existing == wedgeMap.end())
+				{
+					wedgeMap.emplace_back(fromWedge, toWedge);
+				}
+				else if (existing->second != toWedge)
+				{
+					valid = false;
+				}
+			}
+
+			for (uint32_t k = begin; k < end && valid; ++k)
+			{
+				const uint32_t* corners{ &destination[3 * adjacency[k]] };
+				glm::vec3 oldPositions[3];
+				glm::vec3 newPositions[3];
+				bool collapsing{ false };
+				for (uint32_t c = 0; c < 3; ++c)
+				{
+					const uint32_t position{ remap[corners[c]] };
+					collapsing = collapsing || position == collapse.to;
+					oldPositions[c] = positions[position];
+					newPositions[c] = position == collapse.from ? positions[collapse.to] : positions[position];
+
+					if (position == collapse.from && std::none_of(wedgeMap.begin(), wedgeMap.end(),
+						[&](const auto& entry) { return entry.first == corners[c]; }))
+					{
+						// a wedge of this position has no edge to the target, the collapse would tear a seam
+						valid = false;
+					}
+				}
+				if (collapsing || !valid)
+				{
+					continue;
+				}
+
+				const glm::vec3 oldNormal{ glm::cross(oldPositions[1] - oldPositions[0], oldPositions[2] - oldPositions[0]) };
+				const glm::vec3 newNormal{ glm::cross(newPositions[1] - newPositions[0], newPositions[2] - newPositions[0]) };
+				if (glm::dot(oldNormal, newNormal) < MAX_NORMAL_ROTATION_COS * glm::length(oldNormal) * glm::length(newNormal))
+				{
+					valid = false;
+				}
+			}
+
+			if (!valid || collapsedTriangles == 0)
+			{
+				continue;
+			}
+
+			for (const auto& [fromWedge, toWedge] : wedgeMap)
+			{
+				vertexTarget[fromWedge] = toWedge;
+			}
+			quadrics[collapse.to] += quadrics[collapse.from];
+
+			// the one ring of the collapsed position changed shape, its flip checks are stale for this pass
+			for (uint32_t k = begin; k < end; ++k)
+			{
+				const uint32_t* corners{ &destination[3 * adjacency[k]] };
+				for (uint32_t c = 0; c < 3; ++c)
+				{
+					locked[remap[corners[c]]] = true;
+				}
+			}
+
+			maxError = std::max(maxError, collapse.error);
+			removed += collapsedTriangles;
+			++applied;
+		}
+
+		if (applied == 0)
+		{
+			break;
+		}
+
+		size_t write{ 0 };
+		for (size_t i = 0; i < destination.size(); i += 3)
+		{
+			const uint32_t a{ vertexTarget[destination[i + 0]] };
+			const uint32_t b{ vertexTarget[destination[i + 1]] };
+			const uint32_t c{ vertexTarget[destination[i + 2]] };
+			if (remap[a] != remap[b] && remap[b] != remap[c] && remap[c] != remap[a])
+			{
+				destination[write++] = a;
+				destination[write++] = b;
+				destination[write++] = c;
+			}
+		}
+		destination.resize(write);
+	}
+
+	if (resultError)
+	{
+		*resultError = std::sqrt(maxError);
+	}
+	return destination.size();
+}
+
+void Djinn::generateLods(std::span<const Vertex> vertices, std::span<const uint32_t> indices, std::vector<MeshLod>& lods,
+	std::vector<uint32_t>& lodIndices, const LodConfig& config)
+{
+	const float scale{ simplifyScale(vertices) };
+
+	// every level simplifies the original so errors don't stack up level over level, which also makes them independent
+	std::vector<size_t> targets;
+	float ratio{ config.reductionRatio };
+	for (uint32_t level = 1; level < config.maxLods; ++level, ratio *= config.reductionRatio)
+	{
+		const auto targetTriangles{ static_cast<size_t>(static_cast<float>(indices.size() / 3) * ratio) };
+		if (targetTriangles < config.minTriangles)
+		{
+			break;
+		}
+		targets.push_back(targetTriangles * 3);
+	}
+
+	std::vector<std::vector<uint32_t>> levels(targets.size());
+	std::vector<float> errors(targets.size(), 0.0f);
+	parallelFor(targets.size(), [&](const size_t level)
+		{
+			simplifyMesh(vertices, indices, targets[level], config.maxError, levels[level], &errors[level]);
+			optimizeVertexCache(levels[level], vertices.size(), config.cacheSize);
+		});
+
+	lods.clear();
+	lodIndices.assign(indices.begin(), indices.end());
+	lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+	for (size_t level = 0; level < levels.size(); ++level)
+	{
+		// the error bound stopped the collapse early, further levels would look the same
+		if (levels[level].size() * 10 > lods.back().indexCount * 9)
+		{
+			break;
+		}
+
+		lods.push_back({ static_cast<uint32_t>(lodIndices.size()), static_cast<uint32_t>(levels[level].size()), errors[level] * scale });
+		lodIndices.insert(lodIndices.end(), levels[level].begin(), levels[level].end());
+	}
+}
+
+void Djinn::generateLods(std::span<const Vertex> vertices, std::span<const uint32_t> indices, std::span<const Submesh> submeshes,
+	std::vector<MeshLod>& lods, std::vector<MeshLod>& submeshLods, std::vector<uint32_t>& lodIndices, const LodConfig& config)
+{
+	// the levels of each submesh, simplified over just the vertices it uses
+	std::vector<std::vector<MeshLod>> levels(submeshes.size());
+	std::vector<std::vector<uint32_t>> levelIndices(submeshes.size());
+	std::vector<uint32_t> localIndex(vertices.size(), UINT32_MAX);
+	std::vector<uint32_t> globalIndex;
+	std::vector<Vertex> localVertices;
+	std::vector<uint32_t> range;
+	for (size_t i = 0; i < submeshes.size(); ++i)
+	{
+		const auto first{ indices.begin() + submeshes[i].indexOffset };
+		range.assign(first, first + submeshes[i].indexCount);
+		if (static_cast<float>(range.size() / 3) * config.reductionRatio < static_cast<float>(config.minTriangles))
+		{
+			levels[i] = { MeshLod{ 0, static_cast<uint32_t>(range.size()), 0.0f } };
+			levelIndices[i] = std::move(range);
+			continue;
+		}
+
+		localizeIndices(range, vertices, localIndex, globalIndex, localVertices);
+		generateLods(localVertices, range, levels[i], levelIndices[i], config);
+		for (uint32_t& index : levelIndices[i])
+		{
+			index = globalIndex[index];
+		}
+	}
+
+	size_t levelCount{ 1 };
+	for (const auto& submeshLevels : levels)
+	{
+		levelCount = std::max(levelCount, submeshLevels.size());
+	}
+
+	lods.clear();
+	submeshLods.clear();
+	lodIndices.clear();
+	lodIndices.reserve(indices.size() * 2);
+	for (size_t level = 0; level < levelCount; ++level)
+	{
+		MeshLod lod{ static_cast<uint32_t>(lodIndices.size()), 0, 0.0f };
+		for (size_t i = 0; i < submeshes.size(); ++i)
+		{
+			const MeshLod& source{ levels[i][std::min(level, levels[i].size() - 1)] };
+			const auto first{ levelIndices[i].begin() + source.indexOffset };
+			submeshLods.push_back({ static_cast<uint32_t>(lodIndices.size()), source.indexCount, source.error });
+			lodIndices.insert(lodIndices.end(), first, first + source.indexCount);
+			lod.indexCount += source.indexCount;
+			lod.error = std::max(lod.error, source.error);
+		}
+		lods.push_back(lod);
+	}
+}
+
+uint32_t Djinn::selectLod(std::span<const MeshLod> lods, const float distance, const float pixelsPerUnit, const float maxPixelError)
+{
+	const float pixelsPerMeshUnit{ pixelsPerUnit / std::max(distance, 1e-4f) };
+	for (size_t lod = lods.size(); lod-- > 1;)
+	{
+		if (lods[lod].error * pixelsPerMeshUnit <= maxPixelError)
+		{
+			return static_cast<uint32_t>(lod);
+		}
+	}
+	return 0;
+}
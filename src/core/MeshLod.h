@@ -0,0 +1,51 @@
+#ifndef MESH_LOD_INCLUDE_H
+#define MESH_LOD_INCLUDE_H
+
+#include <span>
+#include <vector>
+
+#include "Primitives.h"
+
+namespace Djinn
+{
+	// one level of detail, a range of the shared index buffer over the shared vertex buffer
+	struct MeshLod
+	{
+		uint32_t indexOffset;
+		uint32_t indexCount;
+		float error;			// geometric deviation from LOD 0 in mesh units
+	};
+
+	struct LodConfig
+	{
+		uint32_t maxLods{ 5 };				// including the full resolution mesh
+		float reductionRatio{ 0.5f };		// triangle count of each level relative to the previous one
+		float maxError{ 0.05f };			// relative to the mesh extent, levels stop once this is reached
+		size_t minTriangles{ 64 };
+		uint32_t cacheSize{ 16 };			// every level is re-run through the vertex cache optimizer
+	};
+
+	// the largest extent of the mesh bounds, converts relative simplification errors into mesh units
+	float simplifyScale(std::span<const Vertex> vertices);
+
+	// quadric error edge collapse that only ever moves vertices onto existing ones, so the result indexes the same vertex buffer
+	// UV seams and open borders are preserved by only collapsing along them
+	// targetError is relative to simplifyScale, returns the index count written to destination
+	size_t simplifyMesh(std::span<const Vertex> vertices, std::span<const uint32_t> indices, const size_t targetIndexCount,
+		const float targetError, std::vector<uint32_t>& destination, float* resultError = nullptr);
+
+	// LOD 0 is the input, lodIndices receives every level back to back
+	void generateLods(std::span<const Vertex> vertices, std::span<const uint32_t> indices, std::vector<MeshLod>& lods,
+		std::vector<uint32_t>& lodIndices, const LodConfig& config = {});
+	// every submesh is simplified on its own and level n of the mesh is level n of each submesh back to back,
+	// a submesh that runs out of levels repeats its coarsest one and the mesh level takes the largest error
+	// submeshLods receives lods.size() rows of one range per submesh
+	void generateLods(std::span<const Vertex> vertices, std::span<const uint32_t> indices, std::span<const Submesh> submeshes,
+		std::vector<MeshLod>& lods, std::vector<MeshLod>& submeshLods, std::vector<uint32_t>& lodIndices, const LodConfig& config = {});
+
+	// coarsest level whose error projects to at most maxPixelError pixels
+	// pixelsPerUnit is the screen height in pixels of one unit at distance 1, viewportHeight / (2 * tan(fovY / 2))
+	uint32_t selectLod(std::span<const MeshLod> lods, const float distance, const float pixelsPerUnit, const float maxPixelError);
+}
+
+#endif // MESH_LOD_INCLUDE_H
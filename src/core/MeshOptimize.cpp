@@ -0,0 +1,439 @@
+#include "MeshOptimize.h"
+#include "../DjinnLib/Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+
+namespace
+{
+	constexpr uint32_t INVALID_VERTEX{ UINT32_MAX };
+
+	// FIFO cache where a vertex is resident if fewer than cacheSize misses happened since it was loaded
+	// bumping the clock past cacheSize flushes everything without touching the timestamps
+	class FifoCache
+	{
+	public:
+		FifoCache(const size_t vertexCount, const uint32_t cacheSize)
+			: timestamps(vertexCount, 0), size(cacheSize), time(cacheSize + 1)
+		{
+		}
+
+		bool Contains(const uint32_t vertex) const
+		{
+			return time - timestamps[vertex] <= size;
+		}
+
+		// returns 1 on a miss
+		uint32_t Touch(const uint32_t vertex)
+		{
+			if (Contains(vertex))
+			{
+				return 0;
+			}
+			timestamps[vertex] = time++;
+			return 1;
+		}
+
+		uint32_t Triangle(const uint32_t* corners)
+		{
+			return Touch(corners[0]) + Touch(corners[1]) + Touch(corners[2]);
+		}
+
+		void Flush()
+		{
+			time += size + 1;
+		}
+
+		// how long ago the vertex entered the cache, in misses
+		uint32_t Age(const uint32_t vertex) const
+		{
+			return time - timestamps[vertex];
+		}
+
+	private:
+		std::vector<uint32_t> timestamps;
+		uint32_t size;
+		uint32_t time;
+	};
+
+	// vertex -> triangle lists packed into one array
+	struct TriangleAdjacency
+	{
+		std::vector<uint32_t> counts;
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+	};
+
+	void buildAdjacency(std::span<const uint32_t> indices, const size_t vertexCount, TriangleAdjacency& adjacency)
+	{
+		adjacency.counts.assign(vertexCount, 0);
+		adjacency.offsets.assign(vertexCount, 0);
+		adjacency.triangles.resize(indices.size());
+
+		for (const auto index : indices)
+		{
+			++adjacency.counts[index];
+		}
+
+		uint32_t offset{ 0 };
+		for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+		{
+			adjacency.offsets[vertex] = offset;
+			offset += adjacency.counts[vertex];
+		}
+
+		std::vector<uint32_t> cursors{ adjacency.offsets };
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			adjacency.triangles[cursors[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+
+	struct ClusterSortKey
+	{
+		uint32_t cluster;
+		float facing;
+	};
+}
+
+Djinn::VertexCacheStats Djinn::analyzeVertexCache(std::span<const uint32_t> indices, const size_t vertexCount, const uint32_t cacheSize)
+{
+	assert(indices.size() % 3 == 0);
+
+	VertexCacheStats stats{};
+	if (indices.empty() || vertexCount == 0)
+	{
+		return stats;
+	}
+
+	FifoCache cache(vertexCount, cacheSize);
+	size_t misses{ 0 };
+	for (const auto index : indices)
+	{
+		misses += cache.Touch(index);
+	}
+
+	stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+	stats.atvr = static_cast<float>(misses) / static_cast<float>(vertexCount);
+	return stats;
+}
+
+// Sander, Nehab, Barczak - "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+void Djinn::optimizeVertexCache(std::vector<uint32_t>& indices, const size_t vertexCount, const uint32_t cacheSize,
+	std::vector<uint32_t>* clusters)
+{
+	assert(indices.size() % 3 == 0);
+
+	const size_t triangleCount{ indices.size() / 3 };
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	TriangleAdjacency adjacency;
+	buildAdjacency(indices, vertexCount, adjacency);
+
+	// triangles still to be emitted per vertex
+	std::vector<uint32_t> live{ adjacency.counts };
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> deadEnds;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+
+	FifoCache cache(vertexCount, cacheSize);
+	size_t scanCursor{ 0 };
+
+	const auto nextDeadEnd = [&]()
+	{
+		while (!deadEnds.empty())
+		{
+			const uint32_t vertex{ deadEnds.back() };
+			deadEnds.pop_back();
+			if (live[vertex] > 0)
+			{
+				return vertex;
+			}
+		}
+		while (scanCursor < vertexCount)
+		{
+			if (live[scanCursor] > 0)
+			{
+				return static_cast<uint32_t>(scanCursor);
+			}
+			++scanCursor;
+		}
+		return INVALID_VERTEX;
+	};
+
+	if (clusters)
+	{
+		clusters->clear();
+		clusters->push_back(0);
+	}
+
+	uint32_t fan{ nextDeadEnd() };
+	while (fan != INVALID_VERTEX)
+	{
+		// emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		const uint32_t begin{ adjacency.offsets[fan] };
+		const uint32_t end{ begin + adjacency.counts[fan] };
+		for (uint32_t k = begin; k < end; ++k)
+		{
+			const uint32_t triangle{ adjacency.triangles[k] };
+			if (emitted[triangle])
+			{
+				continue;
+			}
+			emitted[triangle] = true;
+
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				const uint32_t vertex{ indices[3 * triangle + corner] };
+				result.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				--live[vertex];
+				cache.Touch(vertex);
+			}
+		}
+
+		// prefer the oldest candidate that will still be resident after its own fan is emitted
+		uint32_t next{ INVALID_VERTEX };
+		int64_t bestPriority{ -1 };
+		for (const auto vertex : candidates)
+		{
+			if (live[vertex] == 0)
+			{
+				continue;
+			}
+			int64_t priority{ 0 };
+			if (cache.Age(vertex) + 2 * live[vertex] <= cacheSize)
+			{
+				priority = cache.Age(vertex);
+			}
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				next = vertex;
+			}
+		}
+
+		if (next == INVALID_VERTEX)
+		{
+			next = nextDeadEnd();
+			const auto offset{ static_cast<uint32_t>(result.size() / 3) };
+			if (clusters && next != INVALID_VERTEX && clusters->back() != offset)
+			{
+				clusters->push_back(offset);
+			}
+		}
+		fan = next;
+	}
+
+	assert(result.size() == indices.size());
+	indices.swap(result);
+}
+
+// clusters are split further wherever the cache is warm enough, then sorted by how much they face away from the center
+size_t Djinn::optimizeOverdraw(std::vector<uint32_t>& indices, std::span<const Vertex> vertices,
+	std::span<const uint32_t> hardClusters, const MeshOptimizeConfig& config)
+{
+	assert(indices.size() % 3 == 0);
+
+	const auto triangleCount{ static_cast<uint32_t>(indices.size() / 3) };
+	if (triangleCount == 0)
+	{
+		return 0;
+	}
+
+	const std::vector<uint32_t> wholeMesh{ 0 };
+	if (hardClusters.empty())
+	{
+		hardClusters = wholeMesh;
+	}
+
+	FifoCache cache(vertices.size(), config.cacheSize);
+	std::vector<uint32_t> clusterStarts;
+	for (size_t hard = 0; hard < hardClusters.size(); ++hard)
+	{
+		const uint32_t start{ hardClusters[hard] };
+		const uint32_t end{ hard + 1 < hardClusters.size() ? hardClusters[hard + 1] : triangleCount };
+
+		cache.Flush();
+		uint32_t clusterMisses{ 0 };
+		for (uint32_t triangle = start; triangle < end; ++triangle)
+		{
+			clusterMisses += cache.Triangle(&indices[3 * triangle]);
+		}
+		const float threshold{ static_cast<float>(clusterMisses) / static_cast<float>(end - start) * config.overdrawThreshold };
+
+		cache.Flush();
+		uint32_t subStart{ start };
+		uint32_t misses{ 0 };
+		for (uint32_t triangle = start; triangle < end; ++triangle)
+		{
+			misses += cache.Triangle(&indices[3 * triangle]);
+			if (triangle + 1 == end || static_cast<float>(misses) / static_cast<float>(triangle + 1 - subStart) <= threshold)
+			{
+				clusterStarts.push_back(subStart);
+				subStart = triangle + 1;
+				misses = 0;
+				cache.Flush();
+			}
+		}
+	}
+
+	const size_t clusterCount{ clusterStarts.size() };
+	const auto clusterEnd = [&](const size_t cluster)
+	{
+		return cluster + 1 < clusterCount ? clusterStarts[cluster + 1] : triangleCount;
+	};
+
+	// area weighted centroid and normal per cluster, the mesh centroid is the sum over all clusters
+	std::vector<glm::vec3> centroids(clusterCount, glm::vec3{ 0.0f });
+	std::vector<glm::vec3> normals(clusterCount, glm::vec3{ 0.0f });
+	glm::vec3 meshCentroid{ 0.0f };
+	float meshArea{ 0.0f };
+	for (size_t cluster = 0; cluster < clusterCount; ++cluster)
+	{
+		float clusterArea{ 0.0f };
+		for (uint32_t triangle = clusterStarts[cluster]; triangle < clusterEnd(cluster); ++triangle)
+		{
+			const glm::vec3& a{ vertices[indices[3 * triangle + 0]].position };
+			const glm::vec3& b{ vertices[indices[3 * triangle + 1]].position };
+			const glm::vec3& c{ vertices[indices[3 * triangle + 2]].position };
+
+			const glm::vec3 normal{ glm::cross(b - a, c - a) };
+			const float area{ glm::length(normal) };
+
+			centroids[cluster] += (a + b + c) * (area / 3.0f);
+			normals[cluster] += normal;
+			clusterArea += area;
+		}
+
+		meshCentroid += centroids[cluster];
+		meshArea += clusterArea;
+		centroids[cluster] = clusterArea > 0.0f ? centroids[cluster] / clusterArea : glm::vec3{ 0.0f };
+	}
+	meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3{ 0.0f };
+
+	std::vector<ClusterSortKey> order(clusterCount);
+	for (size_t cluster = 0; cluster < clusterCount; ++cluster)
+	{
+		const float length{ glm::length(normals[cluster]) };
+		const float facing{ length > 0.0f ? glm::dot(centroids[cluster] - meshCentroid, normals[cluster]) / length : 0.0f };
+		order[cluster] = { static_cast<uint32_t>(cluster), facing };
+	}
+	std::stable_sort(order.begin(), order.end(),
+		[](const ClusterSortKey& lhs, const ClusterSortKey& rhs) { return lhs.facing > rhs.facing; });
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (const auto& key : order)
+	{
+		const auto first{ indices.begin() + 3 * static_cast<std::ptrdiff_t>(clusterStarts[key.cluster]) };
+		const auto last{ indices.begin() + 3 * static_cast<std::ptrdiff_t>(clusterEnd(key.cluster)) };
+		result.insert(result.end(), first, last);
+	}
+	indices.swap(result);
+
+	return clusterCount;
+}
+
+void Djinn::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	std::vector<uint32_t> remap(vertices.size(), INVALID_VERTEX);
+	std::vector<Vertex> result;
+	result.reserve(vertices.size());
+
+	for (auto& index : indices)
+	{
+		if (remap[index] == INVALID_VERTEX)
+		{
+			remap[index] = static_cast<uint32_t>(result.size());
+			result.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices.swap(result);
+}
+
+void Djinn::localizeIndices(std::span<uint32_t> indices, std::span<const Vertex> vertices, std::vector<uint32_t>& localIndex,
+	std::vector<uint32_t>& globalIndex, std::vector<Vertex>& localVertices)
+{
+	globalIndex.clear();
+	localVertices.clear();
+	for (uint32_t& index : indices)
+	{
+		if (localIndex[index] == INVALID_VERTEX)
+		{
+			localIndex[index] = static_cast<uint32_t>(globalIndex.size());
+			globalIndex.push_back(index);
+			localVertices.push_back(vertices[index]);
+		}
+		index = localIndex[index];
+	}
+
+	for (const uint32_t index : globalIndex)
+	{
+		localIndex[index] = INVALID_VERTEX;
+	}
+}
+
+Djinn::MeshOptimizeStats Djinn::optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const MeshOptimizeConfig& config)
+{
+	MeshOptimizeStats stats{};
+	stats.before = analyzeVertexCache(indices, vertices.size(), config.cacheSize);
+
+	std::vector<uint32_t> hardClusters;
+	optimizeVertexCache(indices, vertices.size(), config.cacheSize, &hardClusters);
+	stats.clusters = optimizeOverdraw(indices, vertices, hardClusters, config);
+	optimizeVertexFetch(vertices, indices);
+
+	stats.after = analyzeVertexCache(indices, vertices.size(), config.cacheSize);
+	return stats;
+}
+
+Djinn::MeshOptimizeStats Djinn::optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::span<const Submesh> submeshes,
+	const MeshOptimizeConfig& config)
+{
+	if (submeshes.size() == 1 && submeshes[0].indexCount == indices.size())
+	{
+		return optimizeMesh(vertices, indices, config);
+	}
+
+	MeshOptimizeStats stats{};
+	stats.before = analyzeVertexCache(indices, vertices.size(), config.cacheSize);
+
+	// the orderings are independent per range, bands of submeshes run on their own threads
+	// each range is renumbered to the vertices it uses so the per vertex state stays the size of the submesh
+	std::atomic<size_t> clusters{ 0 };
+	parallelForBands(submeshes.size(), 1, [&](const size_t begin, const size_t end)
+		{
+			std::vector<uint32_t> localIndex(vertices.size(), INVALID_VERTEX);
+			std::vector<uint32_t> globalIndex;
+			std::vector<Vertex> localVertices;
+			std::vector<uint32_t> range;
+			std::vector<uint32_t> hardClusters;
+			for (size_t i = begin; i < end; ++i)
+			{
+				const auto first{ indices.begin() + submeshes[i].indexOffset };
+				range.assign(first, first + submeshes[i].indexCount);
+				localizeIndices(range, vertices, localIndex, globalIndex, localVertices);
+
+				hardClusters.clear();
+				optimizeVertexCache(range, localVertices.size(), config.cacheSize, &hardClusters);
+				clusters += optimizeOverdraw(range, localVertices, hardClusters, config);
+
+				std::transform(range.begin(), range.end(), first, [&](const uint32_t index) { return globalIndex[index]; });
+			}
+		});
+	stats.clusters = clusters;
+	optimizeVertexFetch(vertices, indices);
+
+	stats.after = analyzeVertexCache(indices, vertices.size(), config.cacheSize);
+	return stats;
+}
@@ -0,0 +1,59 @@
+#ifndef MESH_OPTIMIZE_INCLUDE_H
+#define MESH_OPTIMIZE_INCLUDE_H
+
+#include <span>
+#include <vector>
+
+#include "Primitives.h"
+
+namespace Djinn
+{
+	struct MeshOptimizeConfig
+	{
+		// FIFO size the orderings are tuned for, small enough to suit most hardware
+		uint32_t cacheSize{ 16 };
+		// clusters are split once their ACMR drops under this times the ACMR of the whole cluster,
+		// higher values give more clusters and less overdraw at the cost of cache efficiency
+		float overdrawThreshold{ 1.05f };
+	};
+
+	struct VertexCacheStats
+	{
+		float acmr{ 0.0f };		// transformed vertices per triangle, 0.5 is ideal for a regular grid
+		float atvr{ 0.0f };		// transformed vertices per vertex, 1.0 is ideal
+	};
+
+	struct MeshOptimizeStats
+	{
+		VertexCacheStats before{};
+		VertexCacheStats after{};
+		size_t clusters{ 0 };
+	};
+
+	// simulates a FIFO post transform cache over the index stream
+	VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, const size_t vertexCount, const uint32_t cacheSize);
+
+	// reorders triangles for cache locality (tipsify), records the triangle offsets where the walk hit a dead end
+	void optimizeVertexCache(std::vector<uint32_t>& indices, const size_t vertexCount, const uint32_t cacheSize,
+		std::vector<uint32_t>* clusters = nullptr);
+
+	// splits the cache ordered stream into clusters and sorts them so outward facing ones on the hull are drawn first
+	size_t optimizeOverdraw(std::vector<uint32_t>& indices, std::span<const Vertex> vertices,
+		std::span<const uint32_t> hardClusters, const MeshOptimizeConfig& config);
+
+	// renumbers vertices in order of first use, unreferenced vertices are dropped
+	void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	// renumbers an index range to the vertices it references, in order of first use
+	// localIndex holds one UINT32_MAX per mesh vertex and is handed back that way, globalIndex maps the new numbers back
+	void localizeIndices(std::span<uint32_t> indices, std::span<const Vertex> vertices, std::vector<uint32_t>& localIndex,
+		std::vector<uint32_t>& globalIndex, std::vector<Vertex>& localVertices);
+
+	// all of the above in order
+	MeshOptimizeStats optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const MeshOptimizeConfig& config = {});
+	// triangles are only reordered inside their submesh, so the ranges stay valid
+	MeshOptimizeStats optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::span<const Submesh> submeshes,
+		const MeshOptimizeConfig& config = {});
+}
+
+#endif // MESH_OPTIMIZE_INCLUDE_H
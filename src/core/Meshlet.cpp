@@ -0,0 +1,200 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+	constexpr uint8_t UNUSED_SLOT{ 0xff };
+
+	// Ritter's bounding sphere, within a few percent of optimal which is plenty for culling
+	glm::vec4 boundingSphere(std::span<const Vertex> vertices, std::span<const uint32_t> points)
+	{
+		const auto farthestFrom = [&](const glm::vec3& origin)
+		{
+			glm::vec3 farthest{ origin };
+			float maxDistance{ -1.0f };
+			for (const auto point : points)
+			{
+				const glm::vec3 offset{ vertices[point].position - origin };
+				const float distance{ glm::dot(offset, offset) };
+				if (distance > maxDistance)
+				{
+					maxDistance = distance;
+					farthest = vertices[point].position;
+				}
+			}
+			return farthest;
+		};
+
+		const glm::vec3 a{ farthestFrom(vertices[points[0]].position) };
+		const glm::vec3 b{ farthestFrom(a) };
+
+		glm::vec3 center{ (a + b) * 0.5f };
+		float radius{ glm::length(b - a) * 0.5f };
+
+		for (const auto point : points)
+		{
+			const glm::vec3& position{ vertices[point].position };
+			const float distance{ glm::length(position - center) };
+			if (distance > radius)
+			{
+				// grow just enough to include the point, keeping the far side fixed
+				const float newRadius{ (radius + distance) * 0.5f };
+				center += (position - center) * ((newRadius - radius) / distance);
+				radius = newRadius;
+			}
+		}
+		return { center, radius };
+	}
+}
+
+void Djinn::buildMeshlets(std::span<const Vertex> vertices, std::span<const uint32_t> indices, MeshletData& meshletData,
+	const uint32_t maxVertices, const uint32_t maxTriangles)
+{
+	Submesh whole{};
+	whole.indexCount = static_cast<uint32_t>(indices.size());
+	buildMeshlets(vertices, indices, std::span<Submesh>{ &whole, 1 }, meshletData, maxVertices, maxTriangles);
+}
+
+void Djinn::buildMeshlets(std::span<const Vertex> vertices, std::span<const uint32_t> indices, std::span<Submesh> submeshes,
+	MeshletData& meshletData, const uint32_t maxVertices, const uint32_t maxTriangles)
+{
+	assert(indices.size() % 3 == 0);
+	assert(maxVertices >= 3 && maxVertices <= UNUSED_SLOT);
+	assert(maxTriangles >= 1);
+
+	meshletData = {};
+
+	// meshlet local slot of every mesh vertex, only the entries of the current meshlet are ever set
+	std::vector<uint8_t> slots(vertices.size(), UNUSED_SLOT);
+	Meshlet current{};
+
+	const auto flush = [&]()
+	{
+		if (current.triangleCount == 0)
+		{
+			return;
+		}
+		for (uint32_t i = 0; i < current.vertexCount; ++i)
+		{
+			slots[meshletData.vertices[current.vertexOffset + i]] = UNUSED_SLOT;
+		}
+
+		// keep every meshlet's triangle block 4 byte aligned so shaders can read it as uints
+		meshletData.triangles.resize((meshletData.triangles.size() + 3) & ~size_t{ 3 }, 0);
+
+		meshletData.meshlets.push_back(current);
+		current = {};
+		current.vertexOffset = static_cast<uint32_t>(meshletData.vertices.size());
+		current.triangleOffset = static_cast<uint32_t>(meshletData.triangles.size());
+	};
+
+	for (Submesh& submesh : submeshes)
+	{
+		// flushing at the end of each range keeps a meshlet's triangles inside one submesh
+		submesh.meshletOffset = static_cast<uint32_t>(meshletData.meshlets.size());
+		for (size_t i = submesh.indexOffset; i < static_cast<size_t>(submesh.indexOffset) + submesh.indexCount; i += 3)
+		{
+			const uint32_t a{ indices[i + 0] };
+			const uint32_t b{ indices[i + 1] };
+			const uint32_t c{ indices[i + 2] };
+
+			const uint32_t newVertices{ static_cast<uint32_t>(slots[a] == UNUSED_SLOT) +
+				static_cast<uint32_t>(slots[b] == UNUSED_SLOT && b != a) +
+				static_cast<uint32_t>(slots[c] == UNUSED_SLOT && c != a && c != b) };
+
+			if (current.vertexCount + newVertices > maxVertices || current.triangleCount + 1 > maxTriangles)
+			{
+				flush();
+			}
+
+			for (const auto vertex : { a, b, c })
+			{
+				if (slots[vertex] == UNUSED_SLOT)
+				{
+					slots[vertex] = static_cast<uint8_t>(current.vertexCount++);
+					meshletData.vertices.push_back(vertex);
+				}
+				meshletData.triangles.push_back(slots[vertex]);
+			}
+			++current.triangleCount;
+		}
+		flush();
+		submesh.meshletCount = static_cast<uint32_t>(meshletData.meshlets.size()) - submesh.meshletOffset;
+	}
+
+	meshletData.bounds.reserve(meshletData.meshlets.size());
+	for (const auto& meshlet : meshletData.meshlets)
+	{
+		meshletData.bounds.push_back(computeMeshletBounds(vertices, meshletData, meshlet));
+	}
+}
+
+Djinn::MeshletBounds Djinn::computeMeshletBounds(std::span<const Vertex> vertices, const MeshletData& meshletData, const Meshlet& meshlet)
+{
+	const std::span<const uint32_t> points{ meshletData.vertices.data() + meshlet.vertexOffset, meshlet.vertexCount };
+	const uint8_t* triangles{ meshletData.triangles.data() + meshlet.triangleOffset };
+
+	MeshletBounds bounds{};
+	bounds.sphere = boundingSphere(vertices, points);
+	const glm::vec3 center{ bounds.sphere };
+
+	// the cone axis is the average of the unit triangle normals
+	std::vector<glm::vec3> normals;
+	normals.reserve(meshlet.triangleCount);
+	glm::vec3 axis{ 0.0f };
+	for (uint32_t triangle = 0; triangle < meshlet.triangleCount; ++triangle)
+	{
+		const glm::vec3& p0{ vertices[points[triangles[3 * triangle + 0]]].position };
+		const glm::vec3& p1{ vertices[points[triangles[3 * triangle + 1]]].position };
+		const glm::vec3& p2{ vertices[points[triangles[3 * triangle + 2]]].position };
+
+		const glm::vec3 normal{ glm::cross(p1 - p0, p2 - p0) };
+		const float area{ glm::length(normal) };
+		normals.push_back(area > 0.0f ? normal / area : glm::vec3{ 0.0f });
+		axis += normals.back();
+	}
+
+	const float axisLength{ glm::length(axis) };
+	float minDot{ 1.0f };
+	if (axisLength > 0.0f)
+	{
+		axis /= axisLength;
+		for (const auto& normal : normals)
+		{
+			// degenerate triangles can't be seen from anywhere, they don't constrain the cone
+			if (normal != glm::vec3{ 0.0f })
+			{
+				minDot = std::min(minDot, glm::dot(axis, normal));
+			}
+		}
+	}
+
+	// cones wider than a hemisphere (or close to it) never pass the test, don't bother
+	if (axisLength == 0.0f || minDot <= 0.1f)
+	{
+		bounds.coneAxisCutoff = { 0.0f, 0.0f, 0.0f, 1.0f };
+		bounds.coneApex = { center, 0.0f };
+		return bounds;
+	}
+
+	// move the apex back along the axis until every triangle plane has it on its back side
+	float maxT{ 0.0f };
+	for (uint32_t triangle = 0; triangle < meshlet.triangleCount; ++triangle)
+	{
+		const glm::vec3& normal{ normals[triangle] };
+		const float alignment{ glm::dot(axis, normal) };
+		if (alignment <= 0.0f)
+		{
+			continue;
+		}
+		const glm::vec3& p0{ vertices[points[triangles[3 * triangle]]].position };
+		maxT = std::max(maxT, glm::dot(center - p0, normal) / alignment);
+	}
+
+	bounds.coneAxisCutoff = { axis, std::sqrt(1.0f - minDot * minDot) };
+	bounds.coneApex = { center - axis * maxT, 0.0f };
+	return bounds;
+}
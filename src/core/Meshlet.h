@@ -0,0 +1,70 @@
+#ifndef MESHLET_INCLUDE_H
+#define MESHLET_INCLUDE_H
+
+#include <span>
+#include <vector>
+
+#include "Primitives.h"
+
+namespace Djinn
+{
+	// 124 triangles keeps the local index block of a full meshlet at 372 bytes, just under a 384 byte budget
+	constexpr uint32_t MESHLET_MAX_VERTICES{ 64 };
+	constexpr uint32_t MESHLET_MAX_TRIANGLES{ 124 };
+
+	// std430 compatible, meshletVertices and meshletTriangles are indexed through the offsets
+	struct Meshlet
+	{
+		uint32_t vertexOffset;		// into meshletVertices
+		uint32_t triangleOffset;	// byte offset into meshletTriangles, 4 byte aligned
+		uint32_t vertexCount;
+		uint32_t triangleCount;
+	};
+
+	// bounds are in mesh space, before any dequantize transform
+	// the cluster is backfacing and can be skipped if dot(normalize(coneApex - cameraPosition), coneAxis) >= coneCutoff
+	// a cutoff of 1 means the normals are too spread out for cone culling
+	struct MeshletBounds
+	{
+		glm::vec4 sphere;			// xyz center, w radius
+		glm::vec4 coneAxisCutoff;	// xyz axis, w cutoff
+		glm::vec4 coneApex;			// xyz apex, w unused
+	};
+
+	struct MeshletView
+	{
+		std::span<const Meshlet> meshlets;
+		std::span<const uint32_t> vertices;			// mesh vertex index per meshlet vertex
+		std::span<const uint8_t> triangles;			// 3 meshlet local vertex indices per triangle
+		std::span<const MeshletBounds> bounds;		// one per meshlet
+
+		bool empty() const
+		{
+			return meshlets.empty();
+		}
+	};
+
+	struct MeshletData
+	{
+		std::vector<Meshlet> meshlets;
+		std::vector<uint32_t> vertices;
+		std::vector<uint8_t> triangles;
+		std::vector<MeshletBounds> bounds;
+
+		MeshletView View() const
+		{
+			return { meshlets, vertices, triangles, bounds };
+		}
+	};
+
+	// greedily packs triangles in index order, run it after the vertex cache optimization so neighbours are already adjacent
+	void buildMeshlets(std::span<const Vertex> vertices, std::span<const uint32_t> indices, MeshletData& meshletData,
+		const uint32_t maxVertices = MESHLET_MAX_VERTICES, const uint32_t maxTriangles = MESHLET_MAX_TRIANGLES);
+	// the same per submesh, fills in each submesh's meshlet range
+	void buildMeshlets(std::span<const Vertex> vertices, std::span<const uint32_t> indices, std::span<Submesh> submeshes,
+		MeshletData& meshletData, const uint32_t maxVertices = MESHLET_MAX_VERTICES, const uint32_t maxTriangles = MESHLET_MAX_TRIANGLES);
+
+	MeshletBounds computeMeshletBounds(std::span<const Vertex> vertices, const MeshletData& meshletData, const Meshlet& meshlet);
+}
+
+#endif // MESHLET_INCLUDE_H
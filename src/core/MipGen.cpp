@@ -0,0 +1,330 @@
+#include "MipGen.h"
+#include "../DjinnLib/Parallel.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define DJINN_MIP_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DJINN_MIP_SSE2
+#endif
+
+// MSVC has no SSSE3 switch, AVX2 builds imply it
+#if defined(__SSSE3__) || defined(__AVX2__)
+#include <tmmintrin.h>
+#define DJINN_MIP_SSSE3
+#endif
+
+namespace
+{
+	// a 16 bit linear index keeps every 8 bit sRGB value reachable, even the darkest ones
+	constexpr uint32_t LINEAR_TO_SRGB_STEPS{ 65535 };
+	// levels with fewer rows per thread than this aren't worth spawning threads for
+	constexpr uint32_t MIN_ROWS_PER_BAND{ 32 };
+
+	constexpr uint64_t alignUp(const uint64_t value, const uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	const std::array<float, 256>& srgbToLinearTable()
+	{
+		static const auto table{ []()
+			{
+				std::array<float, 256> values{};
+				for (size_t i = 0; i < values.size(); ++i)
+				{
+					const float c{ static_cast<float>(i) / 255.0f };
+					values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+				}
+				return values;
+			}() };
+		return table;
+	}
+
+	const std::vector<uint8_t>& linearToSrgbTable()
+	{
+		static const auto table{ []()
+			{
+				std::vector<uint8_t> values(LINEAR_TO_SRGB_STEPS + 1);
+				for (size_t i = 0; i < values.size(); ++i)
+				{
+					const float l{ static_cast<float>(i) / static_cast<float>(LINEAR_TO_SRGB_STEPS) };
+					const float c{ l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f };
+					values[i] = static_cast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+				}
+				return values;
+			}() };
+		return table;
+	}
+
+	// rows are filtered as RGBA whatever the source layout, grey goes to every color channel
+	void decodeRow(const uint8_t* source, float* destination, const uint32_t width, const uint32_t channels, const bool srgb)
+	{
+		const auto& toLinear{ srgbToLinearTable() };
+		const uint32_t colorChannels{ channels == 4 ? 3u : 1u };
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			const uint8_t* texel{ source + channels * static_cast<size_t>(x) };
+			float* out{ destination + 4 * static_cast<size_t>(x) };
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				const uint8_t value{ texel[std::min(c, colorChannels - 1)] };
+				out[c] = srgb ? toLinear[value] : static_cast<float>(value) * (1.0f / 255.0f);
+			}
+			out[3] = channels % 2 == 0 ? static_cast<float>(texel[channels - 1]) * (1.0f / 255.0f) : 1.0f;
+		}
+	}
+
+	// quantized holds color in LINEAR_TO_SRGB_STEPS for srgb data, 255 otherwise, and alpha in 255
+	void storeTexel(const int32_t* quantized, uint8_t* out, const uint32_t channels, const bool srgb)
+	{
+		const auto& toSrgb{ linearToSrgbTable() };
+		const uint32_t colorChannels{ channels == 4 ? 3u : 1u };
+		for (uint32_t c = 0; c < colorChannels; ++c)
+		{
+			out[c] = srgb ? toSrgb[static_cast<size_t>(quantized[c])] : static_cast<uint8_t>(quantized[c]);
+		}
+		if (channels % 2 == 0)
+		{
+			out[channels - 1] = static_cast<uint8_t>(quantized[3]);
+		}
+	}
+
+	// averages 2x2 texel blocks of two decoded rows, pairStep is 0 for single column sources
+	void filterRow(const float* row0, const float* row1, float* destination, const uint32_t width, const size_t pairStep)
+	{
+		uint32_t x{ 0 };
+#if defined(DJINN_MIP_AVX2)
+		// two output texels per iteration, a holds source texels 0 1 and b texels 2 3 of both rows
+		if (pairStep == 4)
+		{
+			const __m256 quarter{ _mm256_set1_ps(0.25f) };
+			for (; x + 2 <= width; x += 2)
+			{
+				const size_t i{ 8 * static_cast<size_t>(x) };
+				const __m256 a{ _mm256_add_ps(_mm256_loadu_ps(row0 + i), _mm256_loadu_ps(row1 + i)) };
+				const __m256 b{ _mm256_add_ps(_mm256_loadu_ps(row0 + i + 8), _mm256_loadu_ps(row1 + i + 8)) };
+				const __m256 sum{ _mm256_add_ps(_mm256_permute2f128_ps(a, b, 0x20), _mm256_permute2f128_ps(a, b, 0x31)) };
+				_mm256_storeu_ps(destination + 4 * static_cast<size_t>(x), _mm256_mul_ps(sum, quarter));
+			}
+		}
+#endif
+#if defined(DJINN_MIP_SSE2)
+		// one RGBA texel per register
+		const __m128 quarter4{ _mm_set1_ps(0.25f) };
+		for (; x < width; ++x)
+		{
+			const size_t i{ 8 * static_cast<size_t>(x) };
+			const __m128 top{ _mm_add_ps(_mm_loadu_ps(row0 + i), _mm_loadu_ps(row0 + i + pairStep)) };
+			const __m128 bottom{ _mm_add_ps(_mm_loadu_ps(row1 + i), _mm_loadu_ps(row1 + i + pairStep)) };
+			_mm_storeu_ps(destination + 4 * static_cast<size_t>(x), _mm_mul_ps(_mm_add_ps(top, bottom), quarter4));
+		}
+#else
+		for (; x < width; ++x)
+		{
+			const size_t i{ 8 * static_cast<size_t>(x) };
+			for (size_t c = 0; c < 4; ++c)
+			{
+				destination[4 * static_cast<size_t>(x) + c] =
+					(row0[i + c] + row0[i + pairStep + c] + row1[i + c] + row1[i + pairStep + c]) * 0.25f;
+			}
+		}
+#endif
+	}
+
+	void encodeRow(const float* source, uint8_t* destination, const uint32_t width, const uint32_t channels, const bool srgb)
+	{
+		const float colorScale{ srgb ? static_cast<float>(LINEAR_TO_SRGB_STEPS) : 255.0f };
+
+		uint32_t x{ 0 };
+#if defined(DJINN_MIP_SSE2)
+		// scale and round all four channels at once, only the table lookup stays scalar
+		const __m128 scale{ _mm_setr_ps(colorScale, colorScale, colorScale, 255.0f) };
+		const __m128 half{ _mm_set1_ps(0.5f) };
+		const __m128 zero{ _mm_setzero_ps() };
+		const __m128 one{ _mm_set1_ps(1.0f) };
+		alignas(16) int32_t quantized[4];
+		for (; x < width; ++x)
+		{
+			const __m128 texel{ _mm_min_ps(_mm_max_ps(_mm_loadu_ps(source + 4 * static_cast<size_t>(x)), zero), one) };
+			_mm_store_si128(reinterpret_cast<__m128i*>(quantized), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(texel, scale), half)));
+			storeTexel(quantized, destination + channels * static_cast<size_t>(x), channels, srgb);
+		}
+#else
+		int32_t quantized[4];
+		for (; x < width; ++x)
+		{
+			const float* texel{ source + 4 * static_cast<size_t>(x) };
+			for (int c = 0; c < 4; ++c)
+			{
+				const float scale{ c < 3 ? colorScale : 255.0f };
+				quantized[c] = static_cast<int32_t>(std::clamp(texel[c], 0.0f, 1.0f) * scale + 0.5f);
+			}
+			storeTexel(quantized, destination + channels * static_cast<size_t>(x), channels, srgb);
+		}
+#endif
+	}
+}
+
+uint32_t Djinn::mipLevelCount(const uint32_t width, const uint32_t height)
+{
+	return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+}
+
+void Djinn::generateMipChain(std::span<const uint8_t> level0, const uint32_t width, const uint32_t height, const uint32_t channels,
+	const bool srgb, std::vector<uint8_t>& pixels, std::vector<MipLevel>& levels)
+{
+	assert(width > 0 && height > 0);
+	assert(channels == 1 || channels == 2 || channels == 4);
+	assert(level0.size() == static_cast<size_t>(width) * height * channels);
+
+	levels.clear();
+	uint64_t offset{ 0 };
+	for (uint32_t level = 0; level < mipLevelCount(width, height); ++level)
+	{
+		MipLevel mip{};
+		mip.width = std::max(1u, width >> level);
+		mip.height = std::max(1u, height >> level);
+		mip.offset = offset;
+		mip.size = static_cast<uint64_t>(mip.width) * mip.height * channels;
+		levels.push_back(mip);
+		offset = alignUp(offset + mip.size, MIP_LEVEL_ALIGNMENT);
+	}
+
+	pixels.assign(offset, 0);
+	std::memcpy(pixels.data(), level0.data(), level0.size());
+
+	// every level is filtered from the previous one, two source rows are decoded per output row
+	for (size_t level = 1; level < levels.size(); ++level)
+	{
+		const MipLevel& source{ levels[level - 1] };
+		const MipLevel& target{ levels[level] };
+		const uint8_t* sourcePixels{ pixels.data() + source.offset };
+		uint8_t* targetPixels{ pixels.data() + target.offset };
+		const size_t sourceRowBytes{ static_cast<size_t>(source.width) * channels };
+		const size_t targetRowBytes{ static_cast<size_t>(target.width) * channels };
+		const size_t pairStep{ source.width > 1 ? size_t{ 4 } : size_t{ 0 } };
+
+		parallelForBands(target.height, MIN_ROWS_PER_BAND, [&](const size_t begin, const size_t end)
+			{
+				std::vector<float> row0(static_cast<size_t>(source.width) * 4);
+				std::vector<float> row1(static_cast<size_t>(source.width) * 4);
+				std::vector<float> filtered(static_cast<size_t>(target.width) * 4);
+				for (size_t y = begin; y < end; ++y)
+				{
+					const size_t sourceY{ 2 * y };
+					const size_t nextY{ std::min(sourceY + 1, size_t{ source.height } - 1) };
+					decodeRow(sourcePixels + sourceY * sourceRowBytes, row0.data(), source.width, channels, srgb);
+					decodeRow(sourcePixels + nextY * sourceRowBytes, row1.data(), source.width, channels, srgb);
+					filterRow(row0.data(), row1.data(), filtered.data(), target.width, pairStep);
+					encodeRow(filtered.data(), targetPixels + y * targetRowBytes, target.width, channels, srgb);
+				}
+			});
+	}
+}
+
+void Djinn::expandToRGBA8(std::span<const uint8_t> source, const uint32_t channels, std::span<uint8_t> rgba)
+{
+	assert(channels >= 1 && channels <= 4);
+	assert(source.size() / channels * 4 == rgba.size());
+
+	const size_t count{ rgba.size() / 4 };
+	const uint8_t* in{ source.data() };
+	uint8_t* out{ rgba.data() };
+	size_t i{ 0 };
+
+	if (channels == 4)
+	{
+		std::memcpy(out, in, source.size());
+		return;
+	}
+
+#if defined(DJINN_MIP_SSSE3)
+	// 16 source bytes per load, one shuffle per 4 output texels, alpha is or'd in where the source has none
+	if (channels == 1)
+	{
+		const __m128i alpha{ _mm_set1_epi32(static_cast<int32_t>(0xff000000u)) };
+		const __m128i spread[4]{
+			_mm_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1),
+			_mm_setr_epi8(4, 4, 4, -1, 5, 5, 5, -1, 6, 6, 6, -1, 7, 7, 7, -1),
+			_mm_setr_epi8(8, 8, 8, -1, 9, 9, 9, -1, 10, 10, 10, -1, 11, 11, 11, -1),
+			_mm_setr_epi8(12, 12, 12, -1, 13, 13, 13, -1, 14, 14, 14, -1, 15, 15, 15, -1) };
+		for (; i + 16 <= count; i += 16)
+		{
+			const __m128i grey{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)) };
+			for (size_t part = 0; part < 4; ++part)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * i + 16 * part), _mm_or_si128(_mm_shuffle_epi8(grey, spread[part]), alpha));
+			}
+		}
+	}
+	else if (channels == 2)
+	{
+		const __m128i spread[2]{
+			_mm_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7),
+			_mm_setr_epi8(8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15) };
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m128i greyAlpha{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i)) };
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * i), _mm_shuffle_epi8(greyAlpha, spread[0]));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * i + 16), _mm_shuffle_epi8(greyAlpha, spread[1]));
+		}
+	}
+	else
+	{
+		// the load reads 4 bytes past the 12 it uses, stop while that is still inside the source
+		const __m128i alpha{ _mm_set1_epi32(static_cast<int32_t>(0xff000000u)) };
+		const __m128i spread{ _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1) };
+		for (; i + 6 <= count; i += 4)
+		{
+			const __m128i rgb{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 3 * i)) };
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * i), _mm_or_si128(_mm_shuffle_epi8(rgb, spread), alpha));
+		}
+	}
+#elif defined(DJINN_MIP_SSE2)
+	// grey only, unpacking a register against itself twice replicates each byte four times
+	if (channels == 1)
+	{
+		const __m128i alpha{ _mm_set1_epi32(static_cast<int32_t>(0xff000000u)) };
+		for (; i + 16 <= count; i += 16)
+		{
+			const __m128i grey{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)) };
+			const __m128i low{ _mm_unpacklo_epi8(grey, grey) };
+			const __m128i high{ _mm_unpackhi_epi8(grey, grey) };
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * i), _mm_or_si128(_mm_unpacklo_epi16(low, low), alpha));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * i + 16), _mm_or_si128(_mm_unpackhi_epi16(low, low), alpha));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * i + 32), _mm_or_si128(_mm_unpacklo_epi16(high, high), alpha));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * i + 48), _mm_or_si128(_mm_unpackhi_epi16(high, high), alpha));
+		}
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		const uint8_t* texel{ in + channels * i };
+		uint8_t* target{ out + 4 * i };
+		if (channels == 3)
+		{
+			target[0] = texel[0];
+			target[1] = texel[1];
+			target[2] = texel[2];
+			target[3] = 255;
+		}
+		else
+		{
+			target[0] = texel[0];
+			target[1] = texel[0];
+			target[2] = texel[0];
+			target[3] = channels == 2 ? texel[1] : 255;
+		}
+	}
+}
@@ -0,0 +1,36 @@
+#ifndef MIP_GEN_INCLUDE_H
+#define MIP_GEN_INCLUDE_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Djinn
+{
+	// every level starts on this boundary inside the pixel data, keeps copies and SIMD loads aligned
+	constexpr uint64_t MIP_LEVEL_ALIGNMENT{ 16 };
+
+	// one level of a pyramid stored back to back, maps directly onto a VkBufferImageCopy
+	struct MipLevel
+	{
+		uint32_t width;
+		uint32_t height;
+		uint64_t offset;		// bytes into the pixel data
+		uint64_t size;
+	};
+
+	uint32_t mipLevelCount(const uint32_t width, const uint32_t height);
+
+	// 2x2 box filter down to 1x1, each level is split into row bands filtered in parallel
+	// channels is 1 (grey), 2 (grey, alpha) or 4 (RGBA), every level keeps the source layout
+	// srgb data is filtered in linear space, alpha is always linear
+	// odd sizes leave the last row / column out of the next level
+	void generateMipChain(std::span<const uint8_t> level0, const uint32_t width, const uint32_t height, const uint32_t channels,
+		const bool srgb, std::vector<uint8_t>& pixels, std::vector<MipLevel>& levels);
+
+	// widens 1 to 3 channel texels to RGBA8 the way they sample : grey is replicated, alpha defaults to opaque
+	// rgba holds texelCount * 4 bytes, 4 channel sources are copied as is
+	void expandToRGBA8(std::span<const uint8_t> source, const uint32_t channels, std::span<uint8_t> rgba);
+}
+
+#endif // MIP_GEN_INCLUDE_H
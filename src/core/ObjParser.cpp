@@ -0,0 +1,464 @@
+#include "ObjParser.h"
+#include "../DjinnLib/MappedFile.h"
+#include "../DjinnLib/Parallel.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <unordered_map>
+#include <spdlog/spdlog.h>
+
+namespace
+{
+	constexpr uint32_t POSITION{ 0 };
+	constexpr uint32_t TEXCOORD{ 1 };
+	constexpr uint32_t NORMAL{ 2 };
+
+	// negative OBJ indices are relative to the attributes read so far
+	// inside a chunk they can only be resolved against the chunk's own counts, the chunk base is added at merge time
+	struct RelativeFixup
+	{
+		uint32_t corner;
+		uint32_t component;
+	};
+
+	// a shape starts at this corner, material is an index into the chunk's names or -1 to keep the current one
+	struct ShapeMark
+	{
+		uint32_t corner;
+		int32_t material;
+	};
+
+	struct ObjChunk
+	{
+		std::vector<float> positions;
+		std::vector<float> texCoords;
+		std::vector<float> normals;
+		std::vector<Djinn::ObjIndex> indices;
+		std::vector<RelativeFixup> fixups;
+		std::vector<ShapeMark> marks;
+		std::vector<std::string> materials;
+		bool failed{ false };
+	};
+
+	struct FaceCorner
+	{
+		Djinn::ObjIndex index;
+		std::array<bool, 3> relative{};
+	};
+
+	inline bool isSpace(const char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	inline const char* skipSpace(const char* p, const char* end)
+	{
+		while (p < end && isSpace(*p))
+		{
+			++p;
+		}
+		return p;
+	}
+
+	inline const char* skipLine(const char* p, const char* end)
+	{
+		while (p < end && *p != '\n')
+		{
+			++p;
+		}
+		return p < end ? p + 1 : end;
+	}
+
+	inline bool endOfLine(const char* p, const char* end)
+	{
+		return p >= end || *p == '\n' || *p == '\r' || *p == '#';
+	}
+
+	bool parseFloat(const char*& p, const char* end, float& value)
+	{
+		p = skipSpace(p, end);
+		// from_chars does not accept an explicit plus sign
+		if (p < end && *p == '+')
+		{
+			++p;
+		}
+		const auto [ptr, ec] { std::from_chars(p, end, value) };
+		if (ec != std::errc{})
+		{
+			return false;
+		}
+		p = ptr;
+		return true;
+	}
+
+	bool parseFloats(const char*& p, const char* end, std::vector<float>& out, const uint32_t required, const uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			float value{ 0.0f };
+			if (i >= required && endOfLine(skipSpace(p, end), end))
+			{
+				out.push_back(0.0f);
+				continue;
+			}
+			if (!parseFloat(p, end, value))
+			{
+				return false;
+			}
+			out.push_back(value);
+		}
+		return true;
+	}
+
+	// resolves a raw 1 based / negative relative OBJ index against the chunk local count
+	bool resolveIndex(const int32_t raw, const size_t localCount, int32_t& index, bool& relative)
+	{
+		if (raw > 0)
+		{
+			index = raw - 1;
+			relative = false;
+			return true;
+		}
+		if (raw < 0)
+		{
+			index = static_cast<int32_t>(localCount) + raw;
+			relative = true;
+			return true;
+		}
+		return false;
+	}
+
+	// "p", "p/t", "p//n" or "p/t/n"
+	bool parseCorner(const char*& p, const char* end, const ObjChunk& chunk, FaceCorner& corner)
+	{
+		const std::array<size_t, 3> localCounts{ chunk.positions.size() / 3, chunk.texCoords.size() / 2, chunk.normals.size() / 3 };
+		std::array<int32_t*, 3> targets{ &corner.index.position, &corner.index.texCoord, &corner.index.normal };
+
+		corner = {};
+		for (uint32_t component = 0; component < 3; ++component)
+		{
+			if (component > 0)
+			{
+				if (p >= end || *p != '/')
+				{
+					break;
+				}
+				++p;
+				// empty slot as in "p//n"
+				if (p < end && *p == '/')
+				{
+					continue;
+				}
+			}
+
+			int32_t raw{ 0 };
+			const auto [ptr, ec] { std::from_chars(p, end, raw) };
+			if (ec != std::errc{})
+			{
+				return false;
+			}
+			p = ptr;
+
+			if (!resolveIndex(raw, localCounts[component], *targets[component], corner.relative[component]))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void emitCorner(ObjChunk& chunk, const FaceCorner& corner)
+	{
+		const auto cornerIndex{ static_cast<uint32_t>(chunk.indices.size()) };
+		chunk.indices.push_back(corner.index);
+		for (uint32_t component = 0; component < 3; ++component)
+		{
+			if (corner.relative[component])
+			{
+				chunk.fixups.push_back({ cornerIndex, component });
+			}
+		}
+	}
+
+	bool parseFace(const char*& p, const char* end, ObjChunk& chunk, std::vector<FaceCorner>& face)
+	{
+		face.clear();
+		while (true)
+		{
+			p = skipSpace(p, end);
+			if (endOfLine(p, end))
+			{
+				break;
+			}
+
+			FaceCorner corner;
+			if (!parseCorner(p, end, chunk, corner))
+			{
+				return false;
+			}
+			face.push_back(corner);
+		}
+
+		if (face.size() < 3)
+		{
+			return false;
+		}
+
+		// fan triangulation, fine for the convex polygons exporters write
+		for (size_t i = 1; i + 1 < face.size(); ++i)
+		{
+			emitCorner(chunk, face[0]);
+			emitCorner(chunk, face[i]);
+			emitCorner(chunk, face[i + 1]);
+		}
+		return true;
+	}
+
+	// the rest of the line without trailing whitespace
+	std::string_view lineRest(const char* p, const char* end)
+	{
+		p = skipSpace(p, end);
+		const char* last{ p };
+		while (last < end && *last != '\n' && *last != '\r' && *last != '#')
+		{
+			++last;
+		}
+		while (last > p && isSpace(last[-1]))
+		{
+			--last;
+		}
+		return { p, static_cast<size_t>(last - p) };
+	}
+
+	void parseChunk(const char* p, const char* end, ObjChunk& chunk)
+	{
+		std::vector<FaceCorner> face;
+
+		// rough reservation, a line is rarely shorter than ~20 bytes
+		const auto estimatedLines{ static_cast<size_t>(end - p) / 24 };
+		chunk.positions.reserve(estimatedLines);
+		chunk.indices.reserve(estimatedLines);
+
+		while (p < end)
+		{
+			p = skipSpace(p, end);
+			if (p >= end)
+			{
+				break;
+			}
+
+			bool ok{ true };
+			const char next{ p + 1 < end ? p[1] : '\n' };
+			if (p[0] == 'v' && isSpace(next))
+			{
+				p += 1;
+				ok = parseFloats(p, end, chunk.positions, 3, 3);
+			}
+			else if (p[0] == 'v' && next == 't')
+			{
+				p += 2;
+				ok = parseFloats(p, end, chunk.texCoords, 1, 2);
+			}
+			else if (p[0] == 'v' && next == 'n')
+			{
+				p += 2;
+				ok = parseFloats(p, end, chunk.normals, 3, 3);
+			}
+			else if (p[0] == 'f' && isSpace(next))
+			{
+				p += 1;
+				ok = parseFace(p, end, chunk, face);
+			}
+			else if ((p[0] == 'o' || p[0] == 'g') && (isSpace(next) || endOfLine(p + 1, end)))
+			{
+				chunk.marks.push_back({ static_cast<uint32_t>(chunk.indices.size()), -1 });
+			}
+			else if (static_cast<size_t>(end - p) > 6 && std::string_view{ p, 6 } == "usemtl" && isSpace(p[6]))
+			{
+				chunk.marks.push_back({ static_cast<uint32_t>(chunk.indices.size()), static_cast<int32_t>(chunk.materials.size()) });
+				chunk.materials.emplace_back(lineRest(p + 6, end));
+			}
+			// everything else (comments, material libraries, smoothing) is ignored
+
+			if (!ok)
+			{
+				chunk.failed = true;
+				return;
+			}
+
+			p = skipLine(p, end);
+		}
+	}
+
+	// split into roughly equal pieces, each ending just after a newline
+	std::vector<std::string_view> splitChunks(const std::string_view text, const Djinn::ObjParseConfig& config)
+	{
+		const uint32_t threadCount{ config.threadCount > 0 ? config.threadCount : Djinn::hardwareThreadCount() };
+		const size_t minChunkSize{ std::max<size_t>(config.minChunkSize, 1) };
+		const size_t chunkCount{ std::clamp<size_t>(text.size() / minChunkSize, 1, threadCount) };
+		const size_t targetSize{ text.size() / chunkCount };
+
+		std::vector<std::string_view> chunks;
+		size_t begin{ 0 };
+		while (begin < text.size())
+		{
+			size_t split{ chunks.size() + 1 == chunkCount ? text.size() : std::min(begin + targetSize, text.size()) };
+			const auto newline{ text.find('\n', split) };
+			split = newline == std::string_view::npos ? text.size() : newline + 1;
+
+			chunks.push_back(text.substr(begin, split - begin));
+			begin = split;
+		}
+		return chunks;
+	}
+
+	template <typename T>
+	void appendAt(std::vector<T>& dst, const std::vector<T>& src, const size_t offset)
+	{
+		std::copy(src.begin(), src.end(), dst.begin() + static_cast<std::ptrdiff_t>(offset));
+	}
+}
+
+bool Djinn::parseObj(const std::string& path, ObjMesh& mesh, const ObjParseConfig& config)
+{
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		spdlog::error("Failed to open OBJ file: {}", path);
+		return false;
+	}
+
+	const std::string_view text{ reinterpret_cast<const char*>(file.Data()), file.Size() };
+	if (!parseObjText(text, mesh, config))
+	{
+		spdlog::error("Failed to parse OBJ file: {}", path);
+		return false;
+	}
+	return true;
+}
+
+bool Djinn::parseObjText(std::string_view text, ObjMesh& mesh, const ObjParseConfig& config)
+{
+	mesh = {};
+
+	const auto pieces{ splitChunks(text, config) };
+	std::vector<ObjChunk> chunks(pieces.size());
+
+	parallelFor(pieces.size(), [&](const size_t i)
+		{ parseChunk(pieces[i].data(), pieces[i].data() + pieces[i].size(), chunks[i]); });
+
+	// prefix sums give every chunk its place in the merged streams
+	struct ChunkBase
+	{
+		size_t positions{ 0 };
+		size_t texCoords{ 0 };
+		size_t normals{ 0 };
+		size_t indices{ 0 };
+	};
+
+	std::vector<ChunkBase> bases(chunks.size());
+	ChunkBase total{};
+	for (size_t i = 0; i < chunks.size(); ++i)
+	{
+		if (chunks[i].failed)
+		{
+			return false;
+		}
+
+		bases[i] = total;
+		total.positions += chunks[i].positions.size();
+		total.texCoords += chunks[i].texCoords.size();
+		total.normals += chunks[i].normals.size();
+		total.indices += chunks[i].indices.size();
+	}
+
+	// shapes are stitched together in file order, a chunk's leading faces continue the previous chunk's shape
+	std::unordered_map<std::string, uint32_t> materialIds;
+	mesh.shapes = { ObjShape{} };
+	for (size_t i = 0; i < chunks.size(); ++i)
+	{
+		for (const auto& mark : chunks[i].marks)
+		{
+			ObjShape shape{ static_cast<uint32_t>(bases[i].indices + mark.corner), mesh.shapes.back().material };
+			if (mark.material >= 0)
+			{
+				const auto& name{ chunks[i].materials[static_cast<size_t>(mark.material)] };
+				const auto [it, inserted] { materialIds.try_emplace(name, static_cast<uint32_t>(mesh.materials.size())) };
+				if (inserted)
+				{
+					mesh.materials.push_back(name);
+				}
+				shape.material = it->second;
+			}
+
+			// nothing was drawn since the last mark, it only changes that shape's material
+			if (mesh.shapes.back().firstIndex == shape.firstIndex)
+			{
+				mesh.shapes.back() = shape;
+			}
+			else
+			{
+				mesh.shapes.push_back(shape);
+			}
+		}
+	}
+	if (mesh.shapes.size() > 1 && mesh.shapes.back().firstIndex == total.indices)
+	{
+		mesh.shapes.pop_back();
+	}
+
+	mesh.positions.resize(total.positions);
+	mesh.texCoords.resize(total.texCoords);
+	mesh.normals.resize(total.normals);
+	mesh.indices.resize(total.indices);
+
+	const std::array<int64_t, 3> counts{ static_cast<int64_t>(total.positions / 3), static_cast<int64_t>(total.texCoords / 2), static_cast<int64_t>(total.normals / 3) };
+	std::atomic<bool> outOfRange{ false };
+
+	parallelFor(chunks.size(), [&](const size_t i)
+		{
+			auto& chunk{ chunks[i] };
+			const auto& base{ bases[i] };
+
+			const std::array<int32_t, 3> attributeBase{ static_cast<int32_t>(base.positions / 3), static_cast<int32_t>(base.texCoords / 2), static_cast<int32_t>(base.normals / 3) };
+			for (const auto& fixup : chunk.fixups)
+			{
+				auto& index{ chunk.indices[fixup.corner] };
+				std::array<int32_t*, 3> components{ &index.position, &index.texCoord, &index.normal };
+				*components[fixup.component] += attributeBase[fixup.component];
+				// a relative reference that lands before the first element could come out as -1, which means absent below
+				if (*components[fixup.component] < 0)
+				{
+					outOfRange = true;
+				}
+			}
+
+			for (const auto& index : chunk.indices)
+			{
+				const bool valid{ index.position >= 0 && index.position < counts[POSITION] &&
+					index.texCoord < counts[TEXCOORD] && index.texCoord >= -1 &&
+					index.normal < counts[NORMAL] && index.normal >= -1 };
+				if (!valid)
+				{
+					outOfRange = true;
+				}
+			}
+
+			appendAt(mesh.positions, chunk.positions, base.positions);
+			appendAt(mesh.texCoords, chunk.texCoords, base.texCoords);
+			appendAt(mesh.normals, chunk.normals, base.normals);
+			appendAt(mesh.indices, chunk.indices, base.indices);
+
+			// release chunk memory while the other threads are still copying
+			chunk = {};
+		});
+
+	if (outOfRange)
+	{
+		mesh = {};
+		return false;
+	}
+	return true;
+}
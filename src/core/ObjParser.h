@@ -0,0 +1,48 @@
+#ifndef OBJ_PARSER_INCLUDE_H
+#define OBJ_PARSER_INCLUDE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Djinn
+{
+	// one face corner, 0 based indices into the attribute streams, -1 when the attribute is absent
+	struct ObjIndex
+	{
+		int32_t position{ -1 };
+		int32_t texCoord{ -1 };
+		int32_t normal{ -1 };
+	};
+
+	// the faces from an o, g or usemtl line up to the next one
+	struct ObjShape
+	{
+		uint32_t firstIndex{ 0 };			// into ObjMesh::indices, the shapes tile them in order
+		uint32_t material{ UINT32_MAX };	// into ObjMesh::materials, UINT32_MAX before any usemtl
+	};
+
+	// flat attribute streams straight out of the file, faces are fan triangulated
+	struct ObjMesh
+	{
+		std::vector<float> positions;	// xyz
+		std::vector<float> texCoords;	// uv
+		std::vector<float> normals;		// xyz
+		std::vector<ObjIndex> indices;	// 3 per triangle
+		std::vector<ObjShape> shapes;	// never empty, shapes without faces are dropped
+		std::vector<std::string> materials;		// usemtl names in order of first use
+	};
+
+	struct ObjParseConfig
+	{
+		uint32_t threadCount{ 0 };				// 0 = hardware concurrency
+		size_t minChunkSize{ 1 << 20 };		// don't split files smaller than this any further
+	};
+
+	// memory maps the file and parses line aligned chunks of it in parallel
+	bool parseObj(const std::string& path, ObjMesh& mesh, const ObjParseConfig& config = {});
+	bool parseObjText(std::string_view text, ObjMesh& mesh, const ObjParseConfig& config = {});
+}
+
+#endif // OBJ_PARSER_INCLUDE_H
@@ -1,2 +1,130 @@
 #include "Primitives.h"
 
+#include <algorithm>
+#include <cstring>
+
+const Djinn::VertexLayoutInfo& Djinn::vertexLayoutInfo(const VertexFormat format)
+{
+	switch (format)
+	{
+	case VertexFormat::VERTEX_FORMAT_COMPACT:
+		return VertexLayoutTable<CompactVertex>::info;
+	case VertexFormat::VERTEX_FORMAT_FULL:
+	default:
+		return VertexLayoutTable<Vertex>::info;
+	}
+}
+
+Djinn::VertexInputLayout Djinn::vertexInputLayout(const MeshStreams& streams, const VertexPass pass)
+{
+	const bool positionOnly{ pass == VertexPass::VERTEX_PASS_DEPTH };
+	const bool split{ streams.splitPositions() };
+
+	VertexInputLayout layout{};
+
+	if (streams.vertexFormat == VertexFormat::VERTEX_FORMAT_GLTF)
+	{
+		const uint32_t count{ positionOnly ? 1u : GLTF_VERTEX_STREAMS };
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const VertexAttributeStream& stream{ streams.attributeStreams[i] };
+			layout.bindings.push_back({ i, stream.stride, VK_VERTEX_INPUT_RATE_VERTEX });
+			layout.attributes.push_back({ stream.location, i, stream.format, 0 });
+		}
+		return layout;
+	}
+
+	VkVertexInputBindingDescription binding{};
+	binding.binding = 0;
+	binding.stride = split ? streams.positionStride : streams.vertexStride;
+	binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	layout.bindings.push_back(binding);
+
+	if (split && !positionOnly)
+	{
+		binding.binding = 1;
+		binding.stride = streams.vertexStride;
+		layout.bindings.push_back(binding);
+	}
+
+	const VertexLayoutInfo& info{ vertexLayoutInfo(streams.vertexFormat) };
+	for (VkVertexInputAttributeDescription description : info.attributes)
+	{
+		const bool isPosition{ description.location == 0 };
+		if (positionOnly && !isPosition)
+		{
+			continue;
+		}
+
+		// positions keep offset 0 in their own stream, the rest shift down past them
+		if (split && !isPosition)
+		{
+			description.binding = 1;
+			description.offset -= info.positionSize;
+		}
+		layout.attributes.push_back(description);
+	}
+	return layout;
+}
+
+// glTF streams have no color, the compact shader writes white and takes float attributes as well
+const char* Djinn::vertexShaderPath(const MeshStreams& streams)
+{
+	return streams.vertexFormat == VertexFormat::VERTEX_FORMAT_FULL ? "shader/vert.spv" : "shader/compact_vert.spv";
+}
+
+void Djinn::splitVertexStream(std::span<const std::byte> interleaved, const uint32_t stride, const uint32_t positionSize,
+	std::vector<std::byte>& positions, std::vector<std::byte>& attributes)
+{
+	const size_t vertexCount{ interleaved.size() / stride };
+	const uint32_t attributeSize{ stride - positionSize };
+	positions.resize(vertexCount * positionSize);
+	attributes.resize(vertexCount * attributeSize);
+
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		const std::byte* vertex{ interleaved.data() + i * stride };
+		std::memcpy(positions.data() + i * positionSize, vertex, positionSize);
+		std::memcpy(attributes.data() + i * attributeSize, vertex + positionSize, attributeSize);
+	}
+}
+
+MeshBounds Djinn::indexedBounds(std::span<const Vertex> vertices, std::span<const uint32_t> indices)
+{
+	if (indices.empty())
+	{
+		return {};
+	}
+
+	MeshBounds bounds{ vertices[indices[0]].position, vertices[indices[0]].position };
+	for (const uint32_t index : indices)
+	{
+		bounds.min = glm::min(bounds.min, vertices[index].position);
+		bounds.max = glm::max(bounds.max, vertices[index].position);
+	}
+	return bounds;
+}
+
+bool Djinn::boundsInFrustum(const MeshBounds& bounds, const glm::mat4& modelViewProjection)
+{
+	// count the corners behind each of -x, +x, -y, +y, near and far, one plane with all 8 behind it rejects the box
+	std::array<uint32_t, 6> outside{};
+	for (uint32_t corner = 0; corner < 8; ++corner)
+	{
+		const glm::vec4 position
+		{
+			(corner & 1) ? bounds.max.x : bounds.min.x,
+			(corner & 2) ? bounds.max.y : bounds.min.y,
+			(corner & 4) ? bounds.max.z : bounds.min.z,
+			1.0f
+		};
+		const glm::vec4 clip{ modelViewProjection * position };
+		outside[0] += clip.x < -clip.w;
+		outside[1] += clip.x > clip.w;
+		outside[2] += clip.y < -clip.w;
+		outside[3] += clip.y > clip.w;
+		outside[4] += clip.z < 0.0f;
+		outside[5] += clip.z > clip.w;
+	}
+	return std::none_of(outside.begin(), outside.end(), [](const uint32_t count) { return count == 8; });
+}
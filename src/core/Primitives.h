@@ -2,8 +2,13 @@
 #define PRIMITIVES_INCLUDE_H
 
 #include "../DjinnLib/Array.h"
+#include "../DjinnLib/Hash.h"
+#include <array>
 #include <vector>
+#include <cstddef>
+#include <span>
 #include "Memory.h"
+#include "VertexLayout.h"
 
 
 struct Vertex
@@ -13,60 +18,182 @@ struct Vertex
 	glm::vec3 normal;
 	glm::vec2 texCoord;
 
-	constexpr static VkVertexInputBindingDescription getBindingDescription()
+	bool operator==(const Vertex& other) const
 	{
-		VkVertexInputBindingDescription bindingDescription{};
-		bindingDescription.binding = 0;
-		bindingDescription.stride = sizeof(Vertex);
-		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return position == other.position && color == other.color && normal == other.normal && texCoord == other.texCoord;
+	}
+};
 
-		return bindingDescription;
+namespace Djinn
+{
+	// covers every attribute operator== compares
+	inline uint64_t hashVertex(const Vertex& vertex)
+	{
+		const float values[]
+		{
+			vertex.position.x, vertex.position.y, vertex.position.z,
+			vertex.color.x, vertex.color.y, vertex.color.z,
+			vertex.normal.x, vertex.normal.y, vertex.normal.z,
+			vertex.texCoord.x, vertex.texCoord.y
+		};
+		return HashFloats(values, std::size(values));
 	}
+}
+
+namespace std
+{
+	template<> struct hash<Vertex>
+	{
+		size_t operator()(Vertex const& vertex) const
+		{
+			return Djinn::hashVertex(vertex);
+		}
+	};
+}
+
+enum class VertexFormat : uint32_t
+{
+	VERTEX_FORMAT_FULL,
+	VERTEX_FORMAT_COMPACT,
+	VERTEX_FORMAT_GLTF		// float position, normal and uv read in place from glTF accessors, see MeshStreams::attributeStreams
+};
+
+// position, normal and uv of a VERTEX_FORMAT_GLTF mesh
+constexpr uint32_t GLTF_VERTEX_STREAMS{ 3 };
+
+// one attribute with a binding of its own, separate and interleaved accessors both map onto it
+struct VertexAttributeStream
+{
+	uint32_t location;
+	VkFormat format;
+	uint32_t stride;
+	uint32_t offset;		// bytes into vertexBytes, where the binding starts
+};
+
+// 16 byte vertex : position quantized to the mesh bounds, octahedral normal, half float uv
+// color is dropped, the loader only ever fills it with white
+struct CompactVertex
+{
+	uint16_t position[4];	// unorm16 relative to the mesh bounds, w is padding
+	int16_t normal[2];		// snorm16 octahedral
+	uint16_t texCoord[2];	// half float
+
+};
+
+namespace Djinn
+{
+	template <>
+	struct VertexLayout<Vertex>
+	{
+		static constexpr std::string_view name{ "Vertex" };
+		static constexpr std::array fields
+		{
+			DJINN_VERTEX_FIELD(Vertex, position, 0, VK_FORMAT_R32G32B32_SFLOAT),
+			DJINN_VERTEX_FIELD(Vertex, color, 1, VK_FORMAT_R32G32B32_SFLOAT),
+			DJINN_VERTEX_FIELD(Vertex, normal, 2, VK_FORMAT_R32G32B32_SFLOAT),
+			DJINN_VERTEX_FIELD(Vertex, texCoord, 3, VK_FORMAT_R32G32_SFLOAT)
+		};
+	};
 
-	static Djinn::Array1D<VkVertexInputAttributeDescription, 4> getAttributeDescriptions()
+	// locations match Vertex so both formats can share the fragment stage
+	template <>
+	struct VertexLayout<CompactVertex>
 	{
-		Djinn::Array1D<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
+		static constexpr std::string_view name{ "CompactVertex" };
+		static constexpr std::array fields
+		{
+			DJINN_VERTEX_FIELD(CompactVertex, position, 0, VK_FORMAT_R16G16B16A16_UNORM),
+			DJINN_VERTEX_FIELD(CompactVertex, normal, 2, VK_FORMAT_R16G16_SNORM),
+			DJINN_VERTEX_FIELD(CompactVertex, texCoord, 3, VK_FORMAT_R16G16_SFLOAT)
+		};
+	};
 
-		attributeDescriptions[0].binding = 0;
-		attributeDescriptions[0].location = 0;
-		attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[0].offset = offsetof(Vertex, position);
+	// the layout behind each VertexFormat, new formats add a VertexLayout specialisation and a case here
+	const VertexLayoutInfo& vertexLayoutInfo(const VertexFormat format);
+}
 
-		attributeDescriptions[1].binding = 0;
-		attributeDescriptions[1].location = 1;
-		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[1].offset = offsetof(Vertex, color);
+struct MeshBounds
+{
+	glm::vec3 min{ 0.0f };
+	glm::vec3 max{ 0.0f };
+};
 
-		attributeDescriptions[2].binding = 0;
-		attributeDescriptions[2].location = 2;
-		attributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[2].offset = offsetof(Vertex, normal);
+// GPU ready vertex and index streams of a mesh, the bytes are owned elsewhere
+// with split positions, positionBytes holds the positions alone and vertexBytes / vertexStride the rest of each vertex
+struct MeshStreams
+{
+	VertexFormat vertexFormat{ VertexFormat::VERTEX_FORMAT_FULL };
+	uint32_t vertexStride{ 0 };
+	uint32_t vertexCount{ 0 };
+	std::span<const std::byte> vertexBytes;
+
+	uint32_t positionStride{ 0 };		// 0 = positions are interleaved with the other attributes
+	std::span<const std::byte> positionBytes;
+
+	// VERTEX_FORMAT_GLTF only, vertexStride is 0 and every attribute binds the vertex buffer at its own offset
+	std::array<VertexAttributeStream, GLTF_VERTEX_STREAMS> attributeStreams{};
+
+	uint32_t indexSize{ sizeof(uint32_t) };
+	uint32_t indexCount{ 0 };
+	std::span<const std::byte> indexBytes;
 
-		attributeDescriptions[3].binding = 0;
-		attributeDescriptions[3].location = 3;
-		attributeDescriptions[3].format = VK_FORMAT_R32G32_SFLOAT;
-		attributeDescriptions[3].offset = offsetof(Vertex, texCoord);
+	MeshBounds bounds{};
 
-		return attributeDescriptions;
+	VkIndexType indexType() const
+	{
+		return indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
 	}
 
-	bool operator==(const Vertex& other) const
+	bool splitPositions() const
 	{
-		return position == other.position && color == other.color && texCoord == other.texCoord;
+		return positionStride != 0;
 	}
 };
 
-namespace std
+namespace Djinn
 {
-	template<> struct hash<Vertex>
+	// what a pipeline reads from the mesh, depth only passes read positions and nothing else
+	enum class VertexPass
 	{
-		size_t operator()(Vertex const& vertex) const
-		{
-			return ((hash<glm::vec3>()(vertex.position) ^
-				(hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
-				(hash<glm::vec2>()(vertex.texCoord) << 1);
-		}
+		VERTEX_PASS_SHADED,
+		VERTEX_PASS_DEPTH
 	};
+
+	struct VertexInputLayout
+	{
+		std::vector<VkVertexInputBindingDescription> bindings;
+		std::vector<VkVertexInputAttributeDescription> attributes;
+	};
+
+	// bindings for a pass over the streams, binding 0 always carries positions
+	// a split mesh binds its attribute stream to binding 1 when the pass needs it, a glTF mesh one binding per attribute
+	VertexInputLayout vertexInputLayout(const MeshStreams& streams, const VertexPass pass);
+	// the vertex shader the shaded passes run over the streams
+	const char* vertexShaderPath(const MeshStreams& streams);
+
+	// moves the leading positionSize bytes of every vertex into their own stream
+	void splitVertexStream(std::span<const std::byte> interleaved, const uint32_t stride, const uint32_t positionSize,
+		std::vector<std::byte>& positions, std::vector<std::byte>& attributes);
+
+	constexpr uint32_t NO_MATERIAL{ UINT32_MAX };
+
+	// one OBJ shape or glTF primitive, a range of the shared index buffer that can be culled or drawn on its own
+	// the ranges tile LOD 0 in order, the ranges of coarser levels are kept next to the mesh LODs
+	struct Submesh
+	{
+		uint32_t indexOffset{ 0 };
+		uint32_t indexCount{ 0 };
+		uint32_t material{ NO_MATERIAL };	// into the source's material list
+		uint32_t meshletOffset{ 0 };		// the meshlets never straddle two submeshes
+		uint32_t meshletCount{ 0 };
+		MeshBounds bounds{};				// mesh space, before any dequantize transform
+	};
+
+	// bounds of the vertices an index range references
+	MeshBounds indexedBounds(std::span<const Vertex> vertices, std::span<const uint32_t> indices);
+
+	// false if the box is entirely outside one of the clip planes, modelViewProjection takes mesh space to clip space
+	bool boundsInFrustum(const MeshBounds& bounds, const glm::mat4& modelViewProjection);
 }
 
 struct UniformBufferObject
@@ -74,6 +201,7 @@ struct UniformBufferObject
 	alignas(16) glm::mat4 model;
 	alignas(16) glm::mat4 view;
 	alignas(16) glm::mat4 projection;
+	alignas(16) glm::vec4 virtualTexture;	// width, height and level count of the virtual texture
 };
 
 struct Mesh
@@ -0,0 +1,138 @@
+#ifndef RESOURCE_CACHE_INCLUDE_H
+#define RESOURCE_CACHE_INCLUDE_H
+
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace Djinn
+{
+	struct ResourceCacheStats
+	{
+		uint64_t hits{ 0 };
+		uint64_t misses{ 0 };
+		size_t live{ 0 };
+	};
+
+	// resources shared by content key, a key stays cached for as long as someone holds its handle
+	// the cache only keeps weak references, the last handle to go frees the resource
+	template <typename Resource>
+	class ResourceCache
+	{
+	public:
+		using Handle = std::shared_ptr<const Resource>;
+
+		// the live resource for key, or whatever create returns shared under it
+		// a caller that finds key being created by another thread waits for it instead of creating it twice
+		// nothing is cached when create returns nullptr or throws, waiting callers get the same result
+		template <typename Create>
+		Handle FindOrCreate(const uint64_t key, Create&& create, bool* created = nullptr)
+		{
+			std::promise<Handle> promise;
+			std::shared_future<Handle> inFlight;
+			{
+				std::lock_guard lock{ mutex };
+				Entry& entry{ entries[key] };
+				if (Handle resource{ entry.resource.lock() })
+				{
+					++hits;
+					return resource;
+				}
+				if (entry.pending.valid())
+				{
+					++hits;
+					inFlight = entry.pending;
+				}
+				else
+				{
+					++misses;
+					entry.pending = promise.get_future().share();
+				}
+			}
+			if (created != nullptr)
+			{
+				*created = !inFlight.valid();
+			}
+			if (inFlight.valid())
+			{
+				return inFlight.get();
+			}
+
+			Handle resource{ nullptr };
+			try
+			{
+				resource = create();
+			}
+			catch (...)
+			{
+				finish(key, nullptr);
+				promise.set_exception(std::current_exception());
+				throw;
+			}
+			finish(key, resource);
+			promise.set_value(resource);
+			return resource;
+		}
+
+		// nullptr if key isn't live
+		Handle Find(const uint64_t key)
+		{
+			std::lock_guard lock{ mutex };
+			const auto entry{ entries.find(key) };
+			if (entry == entries.end())
+			{
+				return nullptr;
+			}
+			return entry->second.resource.lock();
+		}
+
+		ResourceCacheStats Stats()
+		{
+			std::lock_guard lock{ mutex };
+			ResourceCacheStats stats{ hits, misses, 0 };
+			for (const auto& [key, entry] : entries)
+			{
+				stats.live += entry.resource.expired() ? 0 : 1;
+			}
+			return stats;
+		}
+
+		void Clear()
+		{
+			std::lock_guard lock{ mutex };
+			entries.clear();
+		}
+
+	private:
+		struct Entry
+		{
+			std::weak_ptr<const Resource> resource;
+			// valid while the resource is being created
+			std::shared_future<Handle> pending;
+		};
+
+		void finish(const uint64_t key, const Handle& resource)
+		{
+			std::lock_guard lock{ mutex };
+			// misses are a full load each, sweeping the expired keys here is cheap next to them
+			std::erase_if(entries, [](const auto& entry) { return entry.second.resource.expired() && !entry.second.pending.valid(); });
+			Entry& entry{ entries[key] };
+			entry.resource = resource;
+			entry.pending = {};
+			if (resource == nullptr)
+			{
+				entries.erase(key);
+			}
+		}
+
+		std::mutex mutex;
+		std::unordered_map<uint64_t, Entry> entries;
+		uint64_t hits{ 0 };
+		uint64_t misses{ 0 };
+	};
+}
+
+#endif // RESOURCE_CACHE_INCLUDE_H
@@ -0,0 +1,143 @@
+#include "TextureAsset.h"
+
+#include <spdlog/spdlog.h>
+
+#include <cassert>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+namespace
+{
+	void bindCachedTexture(Djinn::TextureAsset& texture)
+	{
+		texture.format = texture.cache.Format();
+		texture.pixels = texture.cache.Pixels();
+		texture.levels = texture.cache.Levels();
+		texture.width = texture.levels[0].width;
+		texture.height = texture.levels[0].height;
+	}
+}
+
+bool Djinn::loadTextureAsset(const std::string& path, const TextureFormat requestedFormat, TextureAsset& texture)
+{
+	texture.path = path;
+
+	if (texture.cache.Load(path, texture.srgb, requestedFormat))
+	{
+		bindCachedTexture(texture);
+		spdlog::info("Loaded {} from texture cache", path);
+		return true;
+	}
+
+	int texWidth{ 0 };
+	int texHeight{ 0 };
+	int texChannels{ 0 };
+
+	// the source's own channel count, grey images stay one or two bytes per texel
+	stbi_uc* pixels{ stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, 0) };
+	if (pixels == nullptr)
+	{
+		spdlog::error("Failed to load texture {}: {}", path, stbi_failure_reason());
+		return false;
+	}
+
+	texture.width = static_cast<uint32_t>(texWidth);
+	texture.height = static_cast<uint32_t>(texHeight);
+	const auto sourceChannels{ static_cast<uint32_t>(texChannels) };
+	const std::span<const uint8_t> source{ pixels, size_t{ texture.width } * texture.height * sourceChannels };
+
+	texture.format = chooseTextureFormat(requestedFormat, source, sourceChannels);
+	const uint32_t channels{ textureChannels(texture.format) };
+	if (channels == sourceChannels)
+	{
+		generateMipChain(source, texture.width, texture.height, channels, texture.srgb, texture.pixelData, texture.levelData);
+	}
+	else
+	{
+		// RGB has no widely sampled 3 byte format and the block encoders read RGBA
+		std::vector<uint8_t> rgba(size_t{ texture.width } * texture.height * 4);
+		expandToRGBA8(source, sourceChannels, rgba);
+		generateMipChain(rgba, texture.width, texture.height, channels, texture.srgb, texture.pixelData, texture.levelData);
+	}
+	stbi_image_free(pixels);
+
+	if (isBlockCompressed(texture.format))
+	{
+		std::vector<uint8_t> blocks;
+		std::vector<MipLevel> blockLevels;
+		compressMipChain(texture.pixelData, texture.levelData, texture.format, blocks, blockLevels);
+		spdlog::info("Compressed {} from {} to {} bytes", path, texture.pixelData.size(), blocks.size());
+		texture.pixelData.swap(blocks);
+		texture.levelData.swap(blockLevels);
+	}
+	texture.pixels = texture.pixelData;
+	texture.levels = texture.levelData;
+
+	if (!TextureCache::Store(path, texture.srgb, requestedFormat, texture.format, texture.pixels, texture.levels))
+	{
+		spdlog::warn("Failed to write texture cache for {}", path);
+	}
+	return true;
+}
+
+bool Djinn::loadPackedTextureAsset(const AssetPack& pack, const std::string& path, const TextureFormat requestedFormat,
+	TextureAsset& texture)
+{
+	texture.path = path;
+
+	if (!texture.cache.LoadPacked(pack.Find(path, PackEntryType::PACK_ENTRY_TEXTURE, texture.packedData), texture.srgb, requestedFormat))
+	{
+		return false;
+	}
+
+	bindCachedTexture(texture);
+	spdlog::info("Loaded {} from asset pack", path);
+	return true;
+}
+
+void Djinn::expandTextureAsset(const TextureAsset& source, TextureAsset& texture)
+{
+	assert(!isBlockCompressed(source.format));
+
+	texture.path = source.path;
+	texture.contentKey = source.contentKey;
+	texture.width = source.width;
+	texture.height = source.height;
+	texture.srgb = source.srgb;
+	texture.format = TextureFormat::TEXTURE_FORMAT_RGBA8;
+
+	const uint32_t channels{ textureChannels(source.format) };
+	texture.levelData.clear();
+	uint64_t offset{ 0 };
+	for (const MipLevel& level : source.levels)
+	{
+		MipLevel expanded{ level };
+		expanded.offset = offset;
+		expanded.size = level.size / channels * 4;
+		texture.levelData.push_back(expanded);
+		offset = (offset + expanded.size + MIP_LEVEL_ALIGNMENT - 1) & ~(MIP_LEVEL_ALIGNMENT - 1);
+	}
+
+	texture.pixelData.assign(offset, 0);
+	for (size_t i = 0; i < source.levels.size(); ++i)
+	{
+		const MipLevel& from{ source.levels[i] };
+		const MipLevel& to{ texture.levelData[i] };
+		expandToRGBA8(source.pixels.subspan(static_cast<size_t>(from.offset), static_cast<size_t>(from.size)), channels,
+			{ texture.pixelData.data() + to.offset, static_cast<size_t>(to.size) });
+	}
+	texture.pixels = texture.pixelData;
+	texture.levels = texture.levelData;
+}
+
+void Djinn::buildPlaceholderTexture(TextureAsset& texture)
+{
+	texture.path = "placeholder";
+	texture.width = 1;
+	texture.height = 1;
+	texture.pixelData = { 128, 128, 128, 255 };
+	texture.levelData = { MipLevel{ 1, 1, 0, 4 } };
+	texture.pixels = texture.pixelData;
+	texture.levels = texture.levelData;
+}
@@ -0,0 +1,50 @@
+#ifndef TEXTURE_ASSET_INCLUDE_H
+#define TEXTURE_ASSET_INCLUDE_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "MipGen.h"
+#include "BlockCompression.h"
+#include "AssetPack.h"
+#include "TextureCache.h"
+
+namespace Djinn
+{
+	// the full mip pyramid, pixels and levels view either the vectors or the mapped cache
+	struct TextureAsset
+	{
+		std::string path;
+		// source bytes and import settings, equal keys are the same texture, 0 for the placeholder
+		uint64_t contentKey{ 0 };
+		uint32_t width{ 0 };
+		uint32_t height{ 0 };
+		bool srgb{ true };
+		TextureFormat format{ TextureFormat::TEXTURE_FORMAT_RGBA8 };
+
+		std::vector<uint8_t> pixelData;
+		std::vector<MipLevel> levelData;
+		TextureCache cache;
+		// a compressed pack entry decoded, the cache views it instead of the mapping
+		std::vector<uint8_t> packedData;
+
+		std::span<const uint8_t> pixels;
+		std::span<const MipLevel> levels;
+	};
+
+	// decodes, builds the mips and block compresses them on the CPU, or maps the cache if it is current
+	// stb_image keeps no shared state, safe to run on any thread
+	bool loadTextureAsset(const std::string& path, const TextureFormat requestedFormat, TextureAsset& texture);
+	// maps the cooked mip chain out of the pack, false if it isn't there in the requested format
+	bool loadPackedTextureAsset(const AssetPack& pack, const std::string& path, const TextureFormat requestedFormat, TextureAsset& texture);
+
+	// RGBA8 copy of an R8 / RG8 texture, for devices that can't filter the sRGB variants of the narrow formats
+	void expandTextureAsset(const TextureAsset& source, TextureAsset& texture);
+
+	// 1x1 mid grey sampled until the real texture is resident
+	void buildPlaceholderTexture(TextureAsset& texture);
+}
+
+#endif // TEXTURE_ASSET_INCLUDE_H
@@ -0,0 +1,193 @@
+#include "TextureCache.h"
+#include "../DjinnLib/FileStamp.h"
+
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <spdlog/spdlog.h>
+
+namespace
+{
+	constexpr uint64_t alignUp(const uint64_t value, const uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	bool levelsValid(const Djinn::TextureCacheHeader& header)
+	{
+		if (header.format > Djinn::TextureFormat::TEXTURE_FORMAT_RG8 ||
+			header.levelCount == 0 || header.levelCount > Djinn::TEXTURE_CACHE_MAX_LEVELS ||
+			header.levels[0].width != header.width || header.levels[0].height != header.height)
+		{
+			return false;
+		}
+
+		for (uint32_t i = 0; i < header.levelCount; ++i)
+		{
+			const Djinn::MipLevel& level{ header.levels[i] };
+			if (level.size != Djinn::textureLevelSize(header.format, level.width, level.height) ||
+				level.offset % Djinn::MIP_LEVEL_ALIGNMENT != 0 ||
+				level.offset > header.pixelSize || level.size > header.pixelSize - level.offset)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+std::string Djinn::TextureCache::CachePath(const std::string& sourcePath)
+{
+	return sourcePath + TEXTURE_CACHE_EXTENSION;
+}
+
+bool Djinn::TextureCache::Load(const std::string& sourcePath, const bool srgb, const TextureFormat requestedFormat)
+{
+	CleanUp();
+
+	FileStamp source;
+	if (!queryFileStamp(sourcePath, source))
+	{
+		return false;
+	}
+
+	if (!file.Open(CachePath(sourcePath)))
+	{
+		return false;
+	}
+
+	const auto header{ validate({ file.Data(), file.Size() }, srgb, requestedFormat) };
+	if (header == nullptr || header->sourceSize != source.size || header->sourceWriteTime != source.writeTime)
+	{
+		spdlog::info("Texture cache for {} is stale, rebuilding", sourcePath);
+		CleanUp();
+		return false;
+	}
+
+	p_data = file.Data();
+	p_header = header;
+	return true;
+}
+
+bool Djinn::TextureCache::LoadPacked(std::span<const uint8_t> image, const bool srgb, const TextureFormat requestedFormat)
+{
+	CleanUp();
+
+	const auto header{ validate(image, srgb, requestedFormat) };
+	if (header == nullptr)
+	{
+		return false;
+	}
+
+	p_data = image.data();
+	p_header = header;
+	return true;
+}
+
+const Djinn::TextureCacheHeader* Djinn::TextureCache::validate(std::span<const uint8_t> image, const bool srgb,
+	const TextureFormat requestedFormat)
+{
+	const uint64_t fileSize{ image.size() };
+	if (fileSize < sizeof(TextureCacheHeader))
+	{
+		return nullptr;
+	}
+
+	const auto header{ reinterpret_cast<const TextureCacheHeader*>(image.data()) };
+
+	const bool valid{ header->magic == TEXTURE_CACHE_MAGIC &&
+		header->version == TEXTURE_CACHE_VERSION &&
+		header->srgb == static_cast<uint32_t>(srgb) &&
+		header->requestedFormat == requestedFormat &&
+		header->pixelOffset % TEXTURE_CACHE_ALIGNMENT == 0 &&
+		header->pixelOffset <= fileSize && header->pixelSize <= fileSize - header->pixelOffset &&
+		levelsValid(*header) };
+
+	return valid ? header : nullptr;
+}
+
+void Djinn::TextureCache::CleanUp()
+{
+	p_data = nullptr;
+	p_header = nullptr;
+	file.Close();
+}
+
+Djinn::TextureFormat Djinn::TextureCache::Format() const
+{
+	assert(p_header != nullptr);
+	return p_header->format;
+}
+
+std::span<const uint8_t> Djinn::TextureCache::Pixels() const
+{
+	assert(p_header != nullptr);
+	return { p_data + p_header->pixelOffset, static_cast<size_t>(p_header->pixelSize) };
+}
+
+std::span<const Djinn::MipLevel> Djinn::TextureCache::Levels() const
+{
+	assert(p_header != nullptr);
+	return { p_header->levels, p_header->levelCount };
+}
+
+bool Djinn::TextureCache::Store(const std::string& sourcePath, const bool srgb, const TextureFormat requestedFormat,
+	const TextureFormat format, std::span<const uint8_t> pixels, std::span<const MipLevel> levels)
+{
+	if (levels.empty() || levels.size() > TEXTURE_CACHE_MAX_LEVELS)
+	{
+		return false;
+	}
+
+	FileStamp source;
+	if (!queryFileStamp(sourcePath, source))
+	{
+		return false;
+	}
+
+	TextureCacheHeader header{};
+	header.magic = TEXTURE_CACHE_MAGIC;
+	header.version = TEXTURE_CACHE_VERSION;
+	header.sourceSize = source.size;
+	header.sourceWriteTime = source.writeTime;
+	header.requestedFormat = requestedFormat;
+	header.format = format;
+	header.width = levels[0].width;
+	header.height = levels[0].height;
+	header.srgb = static_cast<uint32_t>(srgb);
+	header.levelCount = static_cast<uint32_t>(levels.size());
+	header.pixelOffset = alignUp(sizeof(TextureCacheHeader), TEXTURE_CACHE_ALIGNMENT);
+	header.pixelSize = pixels.size();
+	std::copy(levels.begin(), levels.end(), header.levels);
+
+	// write to a temporary and rename so a crash never leaves a half written cache behind
+	const std::string cachePath{ CachePath(sourcePath) };
+	const std::string tempPath{ cachePath + ".tmp" };
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+		{
+			return false;
+		}
+
+		constexpr char zeros[TEXTURE_CACHE_ALIGNMENT]{};
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(zeros, static_cast<std::streamsize>(header.pixelOffset - sizeof(header)));
+		out.write(reinterpret_cast<const char*>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+
+		if (!out.good())
+		{
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, cachePath, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+
+	return true;
+}
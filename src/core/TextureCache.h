@@ -0,0 +1,72 @@
+#ifndef TEXTURE_CACHE_INCLUDE_H
+#define TEXTURE_CACHE_INCLUDE_H
+
+#include <span>
+#include <string>
+
+#include "MipGen.h"
+#include "BlockCompression.h"
+#include "../DjinnLib/MappedFile.h"
+
+namespace Djinn
+{
+	constexpr uint32_t TEXTURE_CACHE_MAGIC{ 0x43544a44 }; // "DJTC"
+	constexpr uint32_t TEXTURE_CACHE_VERSION{ 3 };
+	constexpr uint64_t TEXTURE_CACHE_ALIGNMENT{ 64 };
+	// enough for a 32768 x 32768 level 0
+	constexpr uint32_t TEXTURE_CACHE_MAX_LEVELS{ 16 };
+	const std::string TEXTURE_CACHE_EXTENSION{ ".texcache" };
+
+	struct TextureCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+
+		// identity of the source file the cache was built from
+		uint64_t sourceSize;
+		int64_t sourceWriteTime;
+
+		// the format the loader asked for, BC1 requests store BC3 for textures with alpha
+		TextureFormat requestedFormat;
+		TextureFormat format;
+
+		uint32_t width;
+		uint32_t height;
+		uint32_t srgb;
+		uint32_t levelCount;
+		uint64_t pixelOffset;
+		uint64_t pixelSize;
+		// offsets are relative to pixelOffset
+		MipLevel levels[TEXTURE_CACHE_MAX_LEVELS];
+	};
+
+	// the full mip pyramid of a texture, R8 / RG8 / RGBA8 or block compressed, written next to the source image
+	// the mapped pixels go into a staging buffer in a single copy
+	class TextureCache
+	{
+	public:
+		// returns false if there is no cache for sourcePath and format or it is stale
+		bool Load(const std::string& sourcePath, const bool srgb, const TextureFormat requestedFormat);
+		// uses a cache image cooked into a pack, the pack keeps it mapped
+		bool LoadPacked(std::span<const uint8_t> image, const bool srgb, const TextureFormat requestedFormat);
+		void CleanUp();
+
+		// views into the mapped file or pack entry, valid until CleanUp
+		TextureFormat Format() const;
+		std::span<const uint8_t> Pixels() const;
+		std::span<const MipLevel> Levels() const;
+
+		static std::string CachePath(const std::string& sourcePath);
+		static bool Store(const std::string& sourcePath, const bool srgb, const TextureFormat requestedFormat,
+			const TextureFormat format, std::span<const uint8_t> pixels, std::span<const MipLevel> levels);
+
+	private:
+		static const TextureCacheHeader* validate(std::span<const uint8_t> image, const bool srgb, const TextureFormat requestedFormat);
+
+		MappedFile file;
+		const uint8_t* p_data{ nullptr };
+		const TextureCacheHeader* p_header{ nullptr };
+	};
+}
+
+#endif // TEXTURE_CACHE_INCLUDE_H
@@ -0,0 +1,260 @@
+#include "UploadContext.h"
+
+#include <spdlog/spdlog.h>
+
+#include <cstring>
+
+namespace
+{
+	uint64_t alignUp(const uint64_t value, const uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+void Djinn::UploadContext::Init(Context* context, const VkDeviceSize stagingSize)
+{
+	p_context = context;
+	const VkDevice device{ p_context->gpuInfo.device };
+
+	VkCommandPoolCreateInfo poolCreateInfo{};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolCreateInfo.queueFamilyIndex = p_context->queueFamilyIndices.graphicsFamily.value();
+	poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+	auto result{ vkCreateCommandPool(device, &poolCreateInfo, nullptr, &commandPool) };
+	DJINN_VK_ASSERT(result);
+
+	VkCommandBufferAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandPool = commandPool;
+	allocateInfo.commandBufferCount = 1;
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	for (auto& batch : batches)
+	{
+		result = vkAllocateCommandBuffers(device, &allocateInfo, &batch.commandBuffer);
+		DJINN_VK_ASSERT(result);
+		result = vkCreateFence(device, &fenceInfo, nullptr, &batch.fence);
+		DJINN_VK_ASSERT(result);
+	}
+
+	// only ever read by the graphics queue
+	BufferCreateInfo createInfo{};
+	createInfo.size = stagingSize;
+	createInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	createInfo.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	ring.Init(p_context, createInfo);
+}
+
+void Djinn::UploadContext::CleanUp()
+{
+	WaitIdle();
+
+	const VkDevice device{ p_context->gpuInfo.device };
+	for (auto& batch : batches)
+	{
+		vkDestroyFence(device, batch.fence, nullptr);
+		batch = {};
+	}
+	// frees the batches' command buffers with it
+	vkDestroyCommandPool(device, commandPool, nullptr);
+	commandPool = VK_NULL_HANDLE;
+
+	ring.CleanUp(p_context);
+	ring = {};
+}
+
+Djinn::StagingRange Djinn::UploadContext::Stage(const VkDeviceSize size, const VkDeviceSize alignment)
+{
+	assert((alignment & (alignment - 1)) == 0);
+	const uint64_t capacity{ ring.size };
+
+	if (size > capacity)
+	{
+		BufferCreateInfo createInfo{};
+		createInfo.size = size;
+		createInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		createInfo.properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		begin();
+		Buffer& staging{ batches[current].dedicated.emplace_back() };
+		staging.Init(p_context, createInfo);
+		bytesStaged += size;
+		return { staging.buffer, 0, staging.allocation.data };
+	}
+
+	for (;;)
+	{
+		// a range never wraps around the end of the ring, it starts over at the beginning instead
+		uint64_t start{ alignUp(head, alignment) };
+		if (start % capacity + size > capacity)
+		{
+			start = (start / capacity + 1) * capacity;
+		}
+
+		if (start + size - tail <= capacity)
+		{
+			begin();
+			head = start + size;
+			bytesStaged += size;
+			const VkDeviceSize offset{ start % capacity };
+			return { ring.buffer, offset, ring.allocation.data + offset };
+		}
+
+		// the oldest batch in flight gives its ranges back, or the open batch holds them and goes first
+		if (retireOldest(true))
+		{
+			continue;
+		}
+		if (batches[current].recording)
+		{
+			Submit();
+			continue;
+		}
+		// nothing is using the ring
+		head = 0;
+		tail = 0;
+	}
+}
+
+VkCommandBuffer Djinn::UploadContext::Commands()
+{
+	begin();
+	return batches[current].commandBuffer;
+}
+
+void Djinn::UploadContext::CopyToBuffer(VkBuffer dst, const VkDeviceSize dstOffset, std::span<const std::byte> bytes)
+{
+	const StagingRange staging{ Stage(bytes.size()) };
+	memcpy(staging.data, bytes.data(), bytes.size());
+
+	VkBufferCopy copyRegion;
+	copyRegion.srcOffset = staging.offset;
+	copyRegion.dstOffset = dstOffset;
+	copyRegion.size = bytes.size();
+	vkCmdCopyBuffer(Commands(), staging.buffer, dst, 1, &copyRegion);
+}
+
+void Djinn::UploadContext::CopyBuffer(VkBuffer src, VkBuffer dst, const VkDeviceSize size)
+{
+	VkBufferCopy copyRegion;
+	copyRegion.srcOffset = 0;
+	copyRegion.dstOffset = 0;
+	copyRegion.size = size;
+	vkCmdCopyBuffer(Commands(), src, dst, 1, &copyRegion);
+}
+
+void Djinn::UploadContext::Submit()
+{
+	batch_t& batch{ batches[current] };
+	if (!batch.recording)
+	{
+		return;
+	}
+
+	// vertex, index and storage reads of the copied buffers come later in the queue, images carry their own barriers
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+	vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	auto result{ vkEndCommandBuffer(batch.commandBuffer) };
+	DJINN_VK_ASSERT(result);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+	vkResetFences(p_context->gpuInfo.device, 1, &batch.fence);
+	result = vkQueueSubmit(p_context->graphicsQueue, 1, &submitInfo, batch.fence);
+	DJINN_VK_ASSERT(result);
+
+	batch.stagingEnd = head;
+	batch.recording = false;
+	batch.pending = true;
+	++submissions;
+
+	// the next batch is the oldest one, it only blocks when every batch is still in flight
+	current = (current + 1) % UPLOAD_BATCHES;
+	while (retireOldest(false))
+	{
+	}
+	while (batches[current].pending)
+	{
+		retireOldest(true);
+	}
+}
+
+void Djinn::UploadContext::WaitIdle()
+{
+	Submit();
+	while (retireOldest(true))
+	{
+	}
+}
+
+void Djinn::UploadContext::LogStats() const
+{
+	constexpr double MiB{ 1024.0 * 1024.0 };
+	spdlog::info("Upload context: {} submissions, {:.2f} MiB staged, waited on a batch {} times", submissions,
+		static_cast<double>(bytesStaged) / MiB, waits);
+}
+
+void Djinn::UploadContext::begin()
+{
+	batch_t& batch{ batches[current] };
+	if (batch.recording)
+	{
+		return;
+	}
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	auto result{ vkBeginCommandBuffer(batch.commandBuffer, &beginInfo) };
+	DJINN_VK_ASSERT(result);
+	batch.recording = true;
+}
+
+// batches finish in submission order, the oldest in flight is the first pending one from the open batch on
+bool Djinn::UploadContext::retireOldest(const bool wait)
+{
+	for (uint32_t i = 0; i < UPLOAD_BATCHES; ++i)
+	{
+		batch_t& batch{ batches[(current + i) % UPLOAD_BATCHES] };
+		if (!batch.pending)
+		{
+			continue;
+		}
+
+		const VkDevice device{ p_context->gpuInfo.device };
+		if (vkGetFenceStatus(device, batch.fence) != VK_SUCCESS)
+		{
+			if (!wait)
+			{
+				return false;
+			}
+			++waits;
+			vkWaitForFences(device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+		}
+
+		tail = batch.stagingEnd;
+		for (auto& staging : batch.dedicated)
+		{
+			staging.CleanUp(p_context);
+		}
+		batch.dedicated.clear();
+		batch.pending = false;
+		return true;
+	}
+	return false;
+}
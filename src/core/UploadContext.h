@@ -0,0 +1,82 @@
+#ifndef UPLOAD_CONTEXT_INCLUDE_H
+#define UPLOAD_CONTEXT_INCLUDE_H
+
+#include "Buffer.h"
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace Djinn
+{
+	constexpr uint32_t UPLOAD_BATCHES{ 4 };
+
+	// where Stage put the bytes, data already points at offset
+	struct StagingRange
+	{
+		VkBuffer buffer{ VK_NULL_HANDLE };
+		VkDeviceSize offset{ 0 };
+		byte* data{ nullptr };
+	};
+
+	// records copies and barriers of many uploads into one command buffer per batch, a batch goes to the graphics queue
+	// with a fence and the queue is never idled, the graphics queue lets image barriers wait on the fragment shader stage
+	// staging space comes from a persistently mapped ring, a batch's ranges are handed out again once its fence has signaled
+	// a batch has to be submitted before the submission that reads what it wrote, and its buffers outlive it
+	class UploadContext
+	{
+	public:
+		void Init(Context* p_context, const VkDeviceSize stagingSize);
+		void CleanUp();
+
+		// size bytes of staging space in the open batch, uploads larger than the ring get a buffer of their own freed with the batch
+		// may submit the open batch to make room, take Commands() after it
+		StagingRange Stage(const VkDeviceSize size, const VkDeviceSize alignment = 16);
+		// the open batch's command buffer, begun on first use
+		VkCommandBuffer Commands();
+
+		void CopyToBuffer(VkBuffer dst, const VkDeviceSize dstOffset, std::span<const std::byte> bytes);
+		void CopyBuffer(VkBuffer src, VkBuffer dst, const VkDeviceSize size);
+
+		// ends the open batch with a barrier making its transfer writes visible to any later command and submits it
+		// nothing happens when nothing was recorded
+		void Submit();
+		// submits and waits for every batch in flight
+		void WaitIdle();
+
+		void LogStats() const;
+
+	private:
+		struct batch_t
+		{
+			VkCommandBuffer commandBuffer{ VK_NULL_HANDLE };
+			VkFence fence{ VK_NULL_HANDLE };
+			// ring position once the batch was submitted, everything before it is free when the fence signals
+			uint64_t stagingEnd{ 0 };
+			std::vector<Buffer> dedicated;
+			bool recording{ false };
+			bool pending{ false };
+		};
+
+		void begin();
+		// retires the oldest submitted batch, false when none is in flight or, without wait, it hasn't finished
+		bool retireOldest(const bool wait);
+
+		Context* p_context{ nullptr };
+		VkCommandPool commandPool{ VK_NULL_HANDLE };
+		std::array<batch_t, UPLOAD_BATCHES> batches;
+		uint32_t current{ 0 };
+
+		Buffer ring;
+		// monotonic byte positions, the ring offset is the position modulo its size
+		uint64_t head{ 0 };
+		uint64_t tail{ 0 };
+
+		uint64_t bytesStaged{ 0 };
+		uint32_t submissions{ 0 };
+		uint32_t waits{ 0 };
+	};
+}
+
+#endif // UPLOAD_CONTEXT_INCLUDE_H
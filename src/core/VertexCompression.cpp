@@ -0,0 +1,160 @@
+#include "VertexCompression.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+uint16_t Djinn::floatToHalf(const float value)
+{
+	const uint32_t bits{ std::bit_cast<uint32_t>(value) };
+	const auto sign{ static_cast<uint16_t>((bits >> 16) & 0x8000) };
+	const uint32_t exponent{ (bits >> 23) & 0xff };
+	uint32_t mantissa{ bits & 0x7fffff };
+
+	// NaN and infinity
+	if (exponent == 0xff)
+	{
+		return static_cast<uint16_t>(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+	}
+
+	const int32_t halfExponent{ static_cast<int32_t>(exponent) - 127 + 15 };
+
+	// overflow saturates to infinity
+	if (halfExponent >= 0x1f)
+	{
+		return static_cast<uint16_t>(sign | 0x7c00);
+	}
+
+	// subnormal or zero
+	if (halfExponent <= 0)
+	{
+		if (halfExponent < -10)
+		{
+			return sign;
+		}
+		mantissa |= 0x800000;
+		const auto shift{ static_cast<uint32_t>(14 - halfExponent) };
+		uint32_t halfMantissa{ mantissa >> shift };
+		const uint32_t remainder{ mantissa & ((1u << shift) - 1) };
+		const uint32_t halfway{ 1u << (shift - 1) };
+		if (remainder > halfway || (remainder == halfway && (halfMantissa & 1)))
+		{
+			++halfMantissa;
+		}
+		return static_cast<uint16_t>(sign | halfMantissa);
+	}
+
+	uint32_t half{ (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13) };
+	const uint32_t remainder{ mantissa & 0x1fff };
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+	{
+		// may carry into the exponent, which correctly rounds up to the next power of two or infinity
+		++half;
+	}
+	return static_cast<uint16_t>(sign | half);
+}
+
+void Djinn::encodeOctahedral(const glm::vec3& normal, int16_t encoded[2])
+{
+	const auto signNotZero = [](const float v) { return v >= 0.0f ? 1.0f : -1.0f; };
+	const auto toSnorm16 = [](const float v) { return static_cast<int16_t>(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f)); };
+
+	const float length1{ std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z) };
+	if (length1 == 0.0f)
+	{
+		encoded[0] = 0;
+		encoded[1] = 0;
+		return;
+	}
+
+	float x{ normal.x / length1 };
+	float y{ normal.y / length1 };
+
+	// fold the lower hemisphere over the diagonals
+	if (normal.z < 0.0f)
+	{
+		const float foldedX{ (1.0f - std::abs(y)) * signNotZero(x) };
+		const float foldedY{ (1.0f - std::abs(x)) * signNotZero(y) };
+		x = foldedX;
+		y = foldedY;
+	}
+
+	encoded[0] = toSnorm16(x);
+	encoded[1] = toSnorm16(y);
+}
+
+MeshBounds Djinn::computeBounds(std::span<const Vertex> vertices)
+{
+	MeshBounds bounds{};
+	if (vertices.empty())
+	{
+		return bounds;
+	}
+
+	bounds.min = vertices[0].position;
+	bounds.max = vertices[0].position;
+	for (const auto& vertex : vertices)
+	{
+		bounds.min = glm::min(bounds.min, vertex.position);
+		bounds.max = glm::max(bounds.max, vertex.position);
+	}
+	return bounds;
+}
+
+bool Djinn::compressVertices(std::span<const Vertex> vertices, const MeshBounds& bounds, std::vector<CompactVertex>& compact)
+{
+	const glm::vec3 white{ 1.0f, 1.0f, 1.0f };
+	const bool droppable{ std::all_of(vertices.begin(), vertices.end(),
+		[&white](const Vertex& vertex) { return vertex.color == white; }) };
+	if (!droppable)
+	{
+		return false;
+	}
+
+	const glm::vec3 extent{ bounds.max - bounds.min };
+	const auto quantize = [](const float value, const float minValue, const float range)
+	{
+		if (range <= 0.0f)
+		{
+			return uint16_t{ 0 };
+		}
+		const float normalized{ std::clamp((value - minValue) / range, 0.0f, 1.0f) };
+		return static_cast<uint16_t>(std::lround(normalized * 65535.0f));
+	};
+
+	compact.resize(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		const auto& vertex{ vertices[i] };
+		auto& out{ compact[i] };
+
+		out.position[0] = quantize(vertex.position.x, bounds.min.x, extent.x);
+		out.position[1] = quantize(vertex.position.y, bounds.min.y, extent.y);
+		out.position[2] = quantize(vertex.position.z, bounds.min.z, extent.z);
+		out.position[3] = 0;
+
+		encodeOctahedral(vertex.normal, out.normal);
+
+		out.texCoord[0] = floatToHalf(vertex.texCoord.x);
+		out.texCoord[1] = floatToHalf(vertex.texCoord.y);
+	}
+	return true;
+}
+
+glm::mat4 Djinn::dequantizeTransform(const MeshBounds& bounds)
+{
+	// a flat axis quantizes to 0, any scale works for it
+	glm::vec3 extent{ bounds.max - bounds.min };
+	extent.x = extent.x > 0.0f ? extent.x : 1.0f;
+	extent.y = extent.y > 0.0f ? extent.y : 1.0f;
+	extent.z = extent.z > 0.0f ? extent.z : 1.0f;
+
+	return glm::scale(glm::translate(glm::mat4(1.0f), bounds.min), extent);
+}
+
+void Djinn::packIndices16(std::span<const uint32_t> indices, std::vector<uint16_t>& packed)
+{
+	packed.resize(indices.size());
+	std::transform(indices.begin(), indices.end(), packed.begin(),
+		[](const uint32_t index) { return static_cast<uint16_t>(index); });
+}
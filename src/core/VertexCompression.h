@@ -0,0 +1,31 @@
+#ifndef VERTEX_COMPRESSION_INCLUDE_H
+#define VERTEX_COMPRESSION_INCLUDE_H
+
+#include <span>
+#include <vector>
+
+#include "Primitives.h"
+
+namespace Djinn
+{
+	// IEEE 754 binary16, round to nearest even
+	uint16_t floatToHalf(const float value);
+	void encodeOctahedral(const glm::vec3& normal, int16_t encoded[2]);
+
+	MeshBounds computeBounds(std::span<const Vertex> vertices);
+
+	// returns false if the mesh carries data the compact format would lose (non white colors)
+	bool compressVertices(std::span<const Vertex> vertices, const MeshBounds& bounds, std::vector<CompactVertex>& compact);
+
+	// maps unorm16 positions back into model space, fold it into the model matrix
+	glm::mat4 dequantizeTransform(const MeshBounds& bounds);
+
+	// 0xffff is kept free so primitive restart can be turned on without re-packing
+	constexpr bool fitsIndex16(const size_t vertexCount)
+	{
+		return vertexCount <= UINT16_MAX;
+	}
+	void packIndices16(std::span<const uint32_t> indices, std::vector<uint16_t>& packed);
+}
+
+#endif // VERTEX_COMPRESSION_INCLUDE_H
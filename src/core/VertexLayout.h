@@ -0,0 +1,167 @@
+#ifndef VERTEX_LAYOUT_INCLUDE_H
+#define VERTEX_LAYOUT_INCLUDE_H
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include "../DjinnLib/Hash.h"
+
+namespace Djinn
+{
+	// one member of a vertex struct, declare with DJINN_VERTEX_FIELD so offset and size come from the struct itself
+	struct VertexField
+	{
+		std::string_view name;
+		uint32_t location;
+		VkFormat format;
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	// bytes per element of the formats vertex fields use, 0 = not a vertex format we know
+	constexpr uint32_t vertexFormatSize(const VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SNORM:
+		case VK_FORMAT_R16G16_UNORM:
+		case VK_FORMAT_R16G16_SNORM:
+		case VK_FORMAT_R16G16_SFLOAT:
+		case VK_FORMAT_R32_SFLOAT:
+			return 4;
+		case VK_FORMAT_R16G16B16A16_UNORM:
+		case VK_FORMAT_R16G16B16A16_SNORM:
+		case VK_FORMAT_R16G16B16A16_SFLOAT:
+		case VK_FORMAT_R32G32_SFLOAT:
+			return 8;
+		case VK_FORMAT_R32G32B32_SFLOAT:
+			return 12;
+		case VK_FORMAT_R32G32B32A32_SFLOAT:
+			return 16;
+		default:
+			return 0;
+		}
+	}
+
+	// specialise next to each vertex struct :
+	//   static constexpr std::string_view name;
+	//   static constexpr std::array<VertexField, N> fields;	// position first, at location 0
+	template <typename VertexType>
+	struct VertexLayout;
+
+	template <typename VertexType>
+	constexpr size_t vertexFieldCount()
+	{
+		return VertexLayout<VertexType>::fields.size();
+	}
+
+	// everything the descriptions below rely on, checked where the layout is declared
+	template <typename VertexType>
+	constexpr bool validVertexLayout()
+	{
+		const auto& fields{ VertexLayout<VertexType>::fields };
+		if (fields.empty() || fields[0].location != 0 || fields[0].offset != 0)
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < fields.size(); ++i)
+		{
+			// aligned glm types pad vec3 to 16 bytes, the format only has to fit inside the member
+			const uint32_t formatSize{ vertexFormatSize(fields[i].format) };
+			if (formatSize == 0 || formatSize > fields[i].size || fields[i].offset + fields[i].size > sizeof(VertexType))
+			{
+				return false;
+			}
+			// declared in memory order, without overlap or repeated locations
+			for (size_t j = 0; j < i; ++j)
+			{
+				if (fields[j].location == fields[i].location || fields[j].offset + fields[j].size > fields[i].offset)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	template <typename VertexType>
+	constexpr VkVertexInputBindingDescription vertexBindingDescription(const uint32_t binding = 0)
+	{
+		VkVertexInputBindingDescription bindingDescription{};
+		bindingDescription.binding = binding;
+		bindingDescription.stride = sizeof(VertexType);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		return bindingDescription;
+	}
+
+	template <typename VertexType>
+	constexpr std::array<VkVertexInputAttributeDescription, vertexFieldCount<VertexType>()> vertexAttributeDescriptions(const uint32_t binding = 0)
+	{
+		std::array<VkVertexInputAttributeDescription, vertexFieldCount<VertexType>()> attributeDescriptions{};
+		for (size_t i = 0; i < attributeDescriptions.size(); ++i)
+		{
+			const VertexField& field{ VertexLayout<VertexType>::fields[i] };
+			attributeDescriptions[i].binding = binding;
+			attributeDescriptions[i].location = field.location;
+			attributeDescriptions[i].format = field.format;
+			attributeDescriptions[i].offset = field.offset;
+		}
+		return attributeDescriptions;
+	}
+
+	// position leads the vertex, a split mesh stores these bytes in their own stream
+	template <typename VertexType>
+	constexpr uint32_t vertexPositionSize()
+	{
+		return VertexLayout<VertexType>::fields[0].size;
+	}
+
+	// fingerprint of the memory layout, anything cached on disk as raw vertex data
+	// is stale once this changes
+	template <typename VertexType>
+	constexpr uint64_t vertexLayoutHash()
+	{
+		uint64_t hash{ HashFNV1a(VertexLayout<VertexType>::name) };
+		hash = HashCombine(hash, sizeof(VertexType));
+		for (const VertexField& field : VertexLayout<VertexType>::fields)
+		{
+			hash = HashFNV1a(field.name, hash);
+			hash = HashCombine(hash, field.location);
+			hash = HashCombine(hash, static_cast<uint64_t>(field.format));
+			hash = HashCombine(hash, field.offset);
+			hash = HashCombine(hash, field.size);
+		}
+		return hash;
+	}
+
+	// the same facts for a layout picked at runtime, built from the constexpr tables above
+	struct VertexLayoutInfo
+	{
+		uint32_t stride;
+		uint32_t positionSize;
+		uint64_t layoutHash;
+		std::span<const VkVertexInputAttributeDescription> attributes;	// binding 0
+	};
+
+	template <typename VertexType>
+	struct VertexLayoutTable
+	{
+		static_assert(validVertexLayout<VertexType>(), "vertex fields overlap, mismatch their format or don't lead with position");
+
+		static constexpr auto attributes{ vertexAttributeDescriptions<VertexType>() };
+		static constexpr VertexLayoutInfo info{ sizeof(VertexType), vertexPositionSize<VertexType>(),
+			vertexLayoutHash<VertexType>(), attributes };
+	};
+}
+
+#define DJINN_VERTEX_FIELD(type, member, location, format) \
+	Djinn::VertexField{ #member, location, format, offsetof(type, member), sizeof(type::member) }
+
+#endif // VERTEX_LAYOUT_INCLUDE_H
@@ -0,0 +1,237 @@
+#include "VertexWeld.h"
+#include "../DjinnLib/Parallel.h"
+
+#include <bit>
+#include <cassert>
+
+namespace
+{
+	constexpr uint64_t EMPTY_SLOT{ ~0ULL };
+	constexpr uint64_t TAG_MASK{ 0xffffffff00000000ULL };
+
+	// open addressing with linear probing
+	// a slot packs the upper 32 bits of the vertex hash with the vertex index, so most mismatches
+	// are rejected without touching the vertex array
+	class WeldTable
+	{
+	public:
+		explicit WeldTable(const size_t expectedCount)
+		{
+			resize(std::bit_ceil(std::max<size_t>(expectedCount * 2, 64)));
+		}
+
+		// returns the index of an equal vertex already in the table, or inserts and returns newIndex
+		template <typename Equal>
+		uint32_t FindOrInsert(const uint64_t hash, const uint32_t newIndex, Equal&& equal)
+		{
+			const uint64_t tag{ hash & TAG_MASK };
+			size_t slot{ static_cast<size_t>(hash) & mask };
+			while (true)
+			{
+				const uint64_t entry{ slots[slot] };
+				if (entry == EMPTY_SLOT)
+				{
+					slots[slot] = tag | newIndex;
+					hashes.push_back(hash);
+					// keep the load factor under 1/2
+					if (hashes.size() * 2 > slots.size())
+					{
+						grow();
+					}
+					return newIndex;
+				}
+
+				const auto index{ static_cast<uint32_t>(entry) };
+				if ((entry & TAG_MASK) == tag && equal(index))
+				{
+					return index;
+				}
+				slot = (slot + 1) & mask;
+			}
+		}
+
+	private:
+		void resize(const size_t capacity)
+		{
+			slots.assign(capacity, EMPTY_SLOT);
+			mask = capacity - 1;
+		}
+
+		void grow()
+		{
+			resize(slots.size() * 2);
+			for (size_t index = 0; index < hashes.size(); ++index)
+			{
+				size_t slot{ hashes[index] & mask };
+				while (slots[slot] != EMPTY_SLOT)
+				{
+					slot = (slot + 1) & mask;
+				}
+				slots[slot] = (hashes[index] & TAG_MASK) | index;
+			}
+		}
+
+		std::vector<uint64_t> slots;
+		// full hash of every inserted vertex by index, needed to rehash on growth
+		std::vector<uint64_t> hashes;
+		size_t mask{ 0 };
+	};
+
+	// most meshes weld down to a fraction of their corners, start small and let the table grow
+	constexpr size_t EXPECTED_WELD_RATIO{ 4 };
+
+	Djinn::WeldStats weldSerial(const size_t cornerCount, const Djinn::CornerFetch& fetchCorner,
+		std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		WeldTable table(cornerCount / EXPECTED_WELD_RATIO);
+
+		for (size_t i = 0; i < cornerCount; ++i)
+		{
+			const Vertex vertex{ fetchCorner(i) };
+			const auto newIndex{ static_cast<uint32_t>(vertices.size()) };
+			const auto index{ table.FindOrInsert(Djinn::hashVertex(vertex), newIndex,
+				[&](const uint32_t candidate) { return vertices[candidate] == vertex; }) };
+
+			if (index == newIndex)
+			{
+				vertices.push_back(vertex);
+			}
+			indices[i] = index;
+		}
+
+		Djinn::WeldStats stats{};
+		stats.shards = 1;
+		return stats;
+	}
+
+	// corners are bucketed by the top bits of their hash, equal vertices always land in the same shard
+	// so every shard can be welded independently
+	Djinn::WeldStats weldSharded(const size_t cornerCount, const Djinn::CornerFetch& fetchCorner,
+		std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const uint32_t threadCount)
+	{
+		const uint32_t shardCount{ std::bit_ceil(std::max(threadCount, 2u)) };
+		const int shardShift{ 64 - std::countr_zero(shardCount) };
+		const auto shardOf = [shardShift](const uint64_t hash) { return static_cast<uint32_t>(hash >> shardShift); };
+
+		const size_t blockCount{ threadCount };
+		const size_t blockSize{ (cornerCount + blockCount - 1) / blockCount };
+
+		// hash every corner once and count how many fall into each shard per block
+		std::vector<uint64_t> hashes(cornerCount);
+		std::vector<std::vector<size_t>> histograms(blockCount, std::vector<size_t>(shardCount, 0));
+		Djinn::parallelFor(blockCount, [&](const size_t block)
+			{
+				const size_t end{ std::min(cornerCount, (block + 1) * blockSize) };
+				for (size_t i = block * blockSize; i < end; ++i)
+				{
+					hashes[i] = Djinn::hashVertex(fetchCorner(i));
+					++histograms[block][shardOf(hashes[i])];
+				}
+			});
+
+		// counting sort corners by shard, stable so the result does not depend on timing
+		std::vector<size_t> shardStart(shardCount + 1, 0);
+		std::vector<std::vector<size_t>> cursors(blockCount, std::vector<size_t>(shardCount, 0));
+		size_t running{ 0 };
+		for (uint32_t shard = 0; shard < shardCount; ++shard)
+		{
+			shardStart[shard] = running;
+			for (size_t block = 0; block < blockCount; ++block)
+			{
+				cursors[block][shard] = running;
+				running += histograms[block][shard];
+			}
+		}
+		shardStart[shardCount] = running;
+
+		std::vector<uint32_t> order(cornerCount);
+		Djinn::parallelFor(blockCount, [&](const size_t block)
+			{
+				const size_t end{ std::min(cornerCount, (block + 1) * blockSize) };
+				for (size_t i = block * blockSize; i < end; ++i)
+				{
+					order[cursors[block][shardOf(hashes[i])]++] = static_cast<uint32_t>(i);
+				}
+			});
+
+		// weld each shard into its own vertex list, indices temporarily hold shard local ids
+		std::vector<std::vector<Vertex>> shardVertices(shardCount);
+		Djinn::parallelFor(shardCount, [&](const size_t shard)
+			{
+				auto& local{ shardVertices[shard] };
+				const size_t begin{ shardStart[shard] };
+				const size_t end{ shardStart[shard + 1] };
+				WeldTable table((end - begin) / EXPECTED_WELD_RATIO);
+
+				for (size_t k = begin; k < end; ++k)
+				{
+					const uint32_t corner{ order[k] };
+					const Vertex vertex{ fetchCorner(corner) };
+					const auto newIndex{ static_cast<uint32_t>(local.size()) };
+					const auto index{ table.FindOrInsert(hashes[corner], newIndex,
+						[&](const uint32_t candidate) { return local[candidate] == vertex; }) };
+
+					if (index == newIndex)
+					{
+						local.push_back(vertex);
+					}
+					indices[corner] = index;
+				}
+			});
+
+		std::vector<uint32_t> shardBase(shardCount, 0);
+		size_t uniqueCount{ 0 };
+		for (uint32_t shard = 0; shard < shardCount; ++shard)
+		{
+			shardBase[shard] = static_cast<uint32_t>(uniqueCount);
+			uniqueCount += shardVertices[shard].size();
+		}
+
+		vertices.resize(uniqueCount);
+		Djinn::parallelFor(shardCount, [&](const size_t shard)
+			{
+				std::copy(shardVertices[shard].begin(), shardVertices[shard].end(), vertices.begin() + static_cast<std::ptrdiff_t>(shardBase[shard]));
+				shardVertices[shard] = {};
+			});
+
+		Djinn::parallelFor(blockCount, [&](const size_t block)
+			{
+				const size_t end{ std::min(cornerCount, (block + 1) * blockSize) };
+				for (size_t i = block * blockSize; i < end; ++i)
+				{
+					indices[i] += shardBase[shardOf(hashes[i])];
+				}
+			});
+
+		Djinn::WeldStats stats{};
+		stats.shards = shardCount;
+		return stats;
+	}
+}
+
+Djinn::WeldStats Djinn::weldVertices(const size_t cornerCount, const CornerFetch& fetchCorner,
+	std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const WeldConfig& config)
+{
+	assert(cornerCount < UINT32_MAX);
+
+	vertices.clear();
+	indices.resize(cornerCount);
+
+	const uint32_t threadCount{ config.threadCount > 0 ? config.threadCount : hardwareThreadCount() };
+	const bool sharded{ cornerCount >= config.parallelThreshold && threadCount > 1 };
+
+	WeldStats stats{ sharded ?
+		weldSharded(cornerCount, fetchCorner, vertices, indices, threadCount) :
+		weldSerial(cornerCount, fetchCorner, vertices, indices) };
+
+	stats.inputVertices = cornerCount;
+	stats.uniqueVertices = vertices.size();
+	stats.weldedVertices = cornerCount - vertices.size();
+	return stats;
+}
+
+Djinn::WeldStats Djinn::weldVertices(std::span<const Vertex> corners,
+	std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const WeldConfig& config)
+{
+	return weldVertices(corners.size(), [corners](const size_t i) { return corners[i]; }, vertices, indices, config);
+}
@@ -0,0 +1,38 @@
+#ifndef VERTEX_WELD_INCLUDE_H
+#define VERTEX_WELD_INCLUDE_H
+
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "Primitives.h"
+
+namespace Djinn
+{
+	struct WeldConfig
+	{
+		// meshes with at least this many corners are welded in parallel shards
+		size_t parallelThreshold{ 1 << 20 };
+		uint32_t threadCount{ 0 };			// 0 = hardware concurrency
+	};
+
+	struct WeldStats
+	{
+		size_t inputVertices{ 0 };
+		size_t uniqueVertices{ 0 };
+		size_t weldedVertices{ 0 };		// input vertices that were merged into an existing one
+		uint32_t shards{ 1 };
+	};
+
+	// produces the corner at the given index, must be safe to call from several threads at once
+	using CornerFetch = std::function<Vertex(size_t)>;
+
+	// collapses identical corners into an indexed vertex list using a flat open addressing table
+	// the serial path keeps first occurrence order, the sharded path is deterministic but orders vertices by shard
+	WeldStats weldVertices(const size_t cornerCount, const CornerFetch& fetchCorner,
+		std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const WeldConfig& config = {});
+	WeldStats weldVertices(std::span<const Vertex> corners,
+		std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const WeldConfig& config = {});
+}
+
+#endif // VERTEX_WELD_INCLUDE_H
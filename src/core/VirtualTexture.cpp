@@ -0,0 +1,365 @@
+#include "VirtualTexture.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <functional>
+
+namespace
+{
+	// BC formats are copied a 4x4 block at a time, the border is exactly one block
+	uint32_t tileUnitTexels(const Djinn::TextureFormat format)
+	{
+		return Djinn::isBlockCompressed(format) ? 4 : 1;
+	}
+
+	uint32_t pageCount(const uint32_t texels)
+	{
+		return (texels + Djinn::VT_PAGE_SIZE - 1) / Djinn::VT_PAGE_SIZE;
+	}
+
+	uint32_t nextPowerOfTwo(const uint32_t value)
+	{
+		uint32_t power{ 1 };
+		while (power < value)
+		{
+			power <<= 1;
+		}
+		return power;
+	}
+
+	// RGBA8UI indirection texel
+	uint32_t packIndirection(const uint32_t slotX, const uint32_t slotY, const uint32_t level)
+	{
+		return slotX | (slotY << 8) | (level << 16);
+	}
+}
+
+uint64_t Djinn::virtualTileSize(const TextureFormat format)
+{
+	const uint64_t units{ VT_TILE_SIZE / tileUnitTexels(format) };
+	return units * units * blockBytes(format);
+}
+
+void Djinn::extractVirtualTile(const TextureAsset& texture, const VirtualPage& page, std::span<uint8_t> tile)
+{
+	assert(tile.size() == virtualTileSize(texture.format));
+
+	const MipLevel& level{ texture.levels[page.level] };
+	const uint32_t unitTexels{ tileUnitTexels(texture.format) };
+	const size_t unitBytes{ blockBytes(texture.format) };
+	const int64_t levelUnitsX{ (level.width + unitTexels - 1) / unitTexels };
+	const int64_t levelUnitsY{ (level.height + unitTexels - 1) / unitTexels };
+	const int64_t tileUnits{ VT_TILE_SIZE / unitTexels };
+	const int64_t originX{ static_cast<int64_t>(page.x * VT_PAGE_SIZE / unitTexels) - VT_PAGE_BORDER / unitTexels };
+	const int64_t originY{ static_cast<int64_t>(page.y * VT_PAGE_SIZE / unitTexels) - VT_PAGE_BORDER / unitTexels };
+
+	// columns inside the level are one copy per row, the ones past either edge repeat the edge
+	const int64_t firstInside{ std::clamp<int64_t>(-originX, 0, tileUnits) };
+	const int64_t lastInside{ std::clamp<int64_t>(levelUnitsX - originX, firstInside, tileUnits) };
+
+	const uint8_t* levelBytes{ texture.pixels.data() + level.offset };
+	const size_t levelRowBytes{ static_cast<size_t>(levelUnitsX) * unitBytes };
+	const auto bytesOf{ [unitBytes](const int64_t units) { return static_cast<size_t>(units) * unitBytes; } };
+	for (int64_t row = 0; row < tileUnits; ++row)
+	{
+		const int64_t sourceY{ std::clamp<int64_t>(originY + row, 0, levelUnitsY - 1) };
+		const uint8_t* sourceRow{ levelBytes + static_cast<size_t>(sourceY) * levelRowBytes };
+		uint8_t* targetRow{ tile.data() + bytesOf(row * tileUnits) };
+
+		for (int64_t column = 0; column < firstInside; ++column)
+		{
+			std::memcpy(targetRow + bytesOf(column), sourceRow, unitBytes);
+		}
+		if (lastInside > firstInside)
+		{
+			std::memcpy(targetRow + bytesOf(firstInside), sourceRow + bytesOf(originX + firstInside), bytesOf(lastInside - firstInside));
+		}
+		for (int64_t column = lastInside; column < tileUnits; ++column)
+		{
+			std::memcpy(targetRow + bytesOf(column), sourceRow + levelRowBytes - unitBytes, unitBytes);
+		}
+	}
+}
+
+void Djinn::PageCache::Init(const uint32_t slotCount)
+{
+	entries.clear();
+	lru.clear();
+	// handed out from the back, slot 0 first
+	freeSlots.resize(slotCount);
+	for (uint32_t i = 0; i < slotCount; ++i)
+	{
+		freeSlots[i] = slotCount - 1 - i;
+	}
+}
+
+bool Djinn::PageCache::Contains(const uint32_t page) const
+{
+	return entries.contains(page);
+}
+
+uint32_t Djinn::PageCache::Slot(const uint32_t page) const
+{
+	return entries.at(page).slot;
+}
+
+void Djinn::PageCache::Touch(const uint32_t page, const uint64_t frame)
+{
+	Entry& entry{ entries.at(page) };
+	entry.lastUsed = frame;
+	if (!entry.pinned)
+	{
+		lru.splice(lru.begin(), lru, entry.lruPosition);
+	}
+}
+
+bool Djinn::PageCache::Insert(const uint32_t page, const uint64_t frame, const bool pinned, uint32_t& slot, uint32_t& evicted)
+{
+	assert(!Contains(page));
+
+	evicted = VT_NO_PAGE;
+	if (!freeSlots.empty())
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		// pinned pages never enter the list, its tail is the oldest page that may go
+		if (lru.empty() || entries.at(lru.back()).lastUsed >= frame)
+		{
+			return false;
+		}
+		evicted = lru.back();
+		slot = entries.at(evicted).slot;
+		entries.erase(evicted);
+		lru.pop_back();
+	}
+
+	Entry entry{ slot, frame, pinned, lru.end() };
+	if (!pinned)
+	{
+		lru.push_front(page);
+		entry.lruPosition = lru.begin();
+	}
+	entries.emplace(page, entry);
+	return true;
+}
+
+uint32_t Djinn::PageCache::ResidentCount() const
+{
+	return static_cast<uint32_t>(entries.size());
+}
+
+void Djinn::VirtualTexture::Init(const TextureAsset& source, const uint32_t cacheSlotsX, const uint32_t cacheSlotsY)
+{
+	assert(cacheSlotsX <= 256 && cacheSlotsY <= 256);
+
+	p_source = &source;
+	slotsX = cacheSlotsX;
+	slotsY = cacheSlotsY;
+
+	const uint32_t indirectionWidth{ nextPowerOfTwo(pageCount(source.width)) };
+	const uint32_t indirectionHeight{ nextPowerOfTwo(pageCount(source.height)) };
+	levelCount = std::min(static_cast<uint32_t>(source.levels.size()), mipLevelCount(indirectionWidth, indirectionHeight));
+
+	indirectionLevels.clear();
+	uint64_t offset{ 0 };
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		MipLevel mip{};
+		mip.width = std::max(1u, indirectionWidth >> level);
+		mip.height = std::max(1u, indirectionHeight >> level);
+		mip.offset = offset;
+		mip.size = static_cast<uint64_t>(mip.width) * mip.height * sizeof(uint32_t);
+		indirectionLevels.push_back(mip);
+		offset += mip.size;
+	}
+	indirection.assign(offset / sizeof(uint32_t), packIndirection(0, 0, levelCount - 1));
+
+	cache.Init(slotsX * slotsY);
+
+	// the coarsest level is streamed in first and pinned, see UpdatePages
+	const MipLevel& top{ source.levels[levelCount - 1] };
+	const uint32_t topPages{ pageCount(top.width) * pageCount(top.height) };
+	if (topPages > slotsX * slotsY)
+	{
+		spdlog::warn("Virtual texture {} needs {} pages for its coarsest level, the cache holds {}", source.path, topPages, slotsX * slotsY);
+	}
+
+	requested.clear();
+	for (uint32_t y = 0; y < pageCount(top.height); ++y)
+	{
+		for (uint32_t x = 0; x < pageCount(top.width); ++x)
+		{
+			requested.push_back(packVirtualPage(levelCount - 1, x, y));
+		}
+	}
+}
+
+void Djinn::VirtualTexture::ProcessFeedback(std::span<const uint32_t> feedback, const uint64_t frame)
+{
+	std::vector<uint32_t> pages;
+	pages.reserve(feedback.size());
+	for (const uint32_t page : feedback)
+	{
+		if (page != VT_NO_PAGE)
+		{
+			pages.push_back(page);
+		}
+	}
+	std::sort(pages.begin(), pages.end());
+	pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+
+	// every coarser page under a visible one is wanted too, it is what the indirection falls back on
+	for (const uint32_t packed : pages)
+	{
+		VirtualPage page{ unpackVirtualPage(packed) };
+		if (!pageInRange(page))
+		{
+			continue;
+		}
+
+		for (; page.level < levelCount; ++page.level, page.x /= 2, page.y /= 2)
+		{
+			const uint32_t key{ packVirtualPage(page.level, page.x, page.y) };
+			if (cache.Contains(key))
+			{
+				cache.Touch(key, frame);
+			}
+			else
+			{
+				requested.push_back(key);
+			}
+		}
+	}
+}
+
+bool Djinn::VirtualTexture::UpdatePages(const uint32_t maxPages, const uint64_t frame, std::vector<VirtualPageUpload>& uploads)
+{
+	// level sits in the top bits, descending order is coarse first
+	std::sort(requested.begin(), requested.end(), std::greater<uint32_t>{});
+	requested.erase(std::unique(requested.begin(), requested.end()), requested.end());
+
+	bool changed{ false };
+	uint32_t uploaded{ 0 };
+	for (const uint32_t key : requested)
+	{
+		if (uploaded == maxPages)
+		{
+			break;
+		}
+		if (cache.Contains(key))
+		{
+			continue;
+		}
+
+		const VirtualPage page{ unpackVirtualPage(key) };
+		uint32_t slot{ 0 };
+		uint32_t evicted{ VT_NO_PAGE };
+		if (!cache.Insert(key, frame, page.level == levelCount - 1, slot, evicted))
+		{
+			// everything resident is on screen, the rest waits for the view to change
+			break;
+		}
+
+		uploads.push_back({ page, slot });
+		changed = true;
+		++uploaded;
+	}
+	// whatever didn't fit is asked for again by the next readback
+	requested.clear();
+
+	if (changed)
+	{
+		rebuildIndirection();
+	}
+	return changed;
+}
+
+std::span<const uint32_t> Djinn::VirtualTexture::Indirection() const
+{
+	return indirection;
+}
+
+std::span<const Djinn::MipLevel> Djinn::VirtualTexture::IndirectionLevels() const
+{
+	return indirectionLevels;
+}
+
+uint32_t Djinn::VirtualTexture::LevelCount() const
+{
+	return levelCount;
+}
+
+uint32_t Djinn::VirtualTexture::SlotsX() const
+{
+	return slotsX;
+}
+
+uint32_t Djinn::VirtualTexture::SlotsY() const
+{
+	return slotsY;
+}
+
+uint32_t Djinn::VirtualTexture::Width() const
+{
+	return p_source->width;
+}
+
+uint32_t Djinn::VirtualTexture::Height() const
+{
+	return p_source->height;
+}
+
+const Djinn::TextureAsset& Djinn::VirtualTexture::Source() const
+{
+	return *p_source;
+}
+
+bool Djinn::VirtualTexture::pageInRange(const VirtualPage& page) const
+{
+	if (page.level >= levelCount)
+	{
+		return false;
+	}
+	const MipLevel& level{ p_source->levels[page.level] };
+	return page.x < pageCount(level.width) && page.y < pageCount(level.height);
+}
+
+void Djinn::VirtualTexture::rebuildIndirection()
+{
+	// coarse to fine, a page that isn't resident inherits the entry of the page it sits in one level up
+	for (uint32_t level = levelCount; level-- > 0;)
+	{
+		const MipLevel& mip{ indirectionLevels[level] };
+		uint32_t* entries{ indirection.data() + mip.offset / sizeof(uint32_t) };
+		const MipLevel& sourceLevel{ p_source->levels[level] };
+		const uint32_t pagesX{ pageCount(sourceLevel.width) };
+		const uint32_t pagesY{ pageCount(sourceLevel.height) };
+
+		for (uint32_t y = 0; y < mip.height; ++y)
+		{
+			for (uint32_t x = 0; x < mip.width; ++x)
+			{
+				const uint32_t key{ packVirtualPage(level, std::min(x, pagesX - 1), std::min(y, pagesY - 1)) };
+				uint32_t& entry{ entries[y * mip.width + x] };
+				if (cache.Contains(key))
+				{
+					const uint32_t slot{ cache.Slot(key) };
+					entry = packIndirection(slot % slotsX, slot / slotsX, level);
+				}
+				else if (level + 1 < levelCount)
+				{
+					const MipLevel& parent{ indirectionLevels[level + 1] };
+					const uint32_t parentX{ std::min(x / 2, parent.width - 1) };
+					const uint32_t parentY{ std::min(y / 2, parent.height - 1) };
+					entry = indirection[parent.offset / sizeof(uint32_t) + parentY * parent.width + parentX];
+				}
+			}
+		}
+	}
+}
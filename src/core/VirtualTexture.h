@@ -0,0 +1,130 @@
+#ifndef VIRTUAL_TEXTURE_INCLUDE_H
+#define VIRTUAL_TEXTURE_INCLUDE_H
+
+#include <cstdint>
+#include <list>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "TextureAsset.h"
+
+namespace Djinn
+{
+	// texels of a level covered by one page
+	constexpr uint32_t VT_PAGE_SIZE{ 128 };
+	// texels repeated from the neighbouring pages on each side so bilinear filtering never crosses a tile, one BC block
+	constexpr uint32_t VT_PAGE_BORDER{ 4 };
+	// a page with its border, the unit the physical cache is divided into
+	constexpr uint32_t VT_TILE_SIZE{ VT_PAGE_SIZE + 2 * VT_PAGE_BORDER };
+	// the feedback pass renders at the swapchain extent divided by this
+	constexpr uint32_t VT_FEEDBACK_SCALE{ 8 };
+	// cleared feedback texels, nothing was drawn there
+	constexpr uint32_t VT_NO_PAGE{ UINT32_MAX };
+
+	// level in the top 8 bits, then 12 bits each of page row and column, the feedback shader writes the same packing
+	constexpr uint32_t packVirtualPage(const uint32_t level, const uint32_t x, const uint32_t y)
+	{
+		return (level << 24) | (y << 12) | x;
+	}
+
+	struct VirtualPage
+	{
+		uint32_t level;
+		uint32_t x;
+		uint32_t y;
+	};
+
+	constexpr VirtualPage unpackVirtualPage(const uint32_t packed)
+	{
+		return { packed >> 24, packed & 0xfff, (packed >> 12) & 0xfff };
+	}
+
+	// bytes of one tile of the texture's format, BC tiles are VT_TILE_SIZE / 4 blocks on a side
+	uint64_t virtualTileSize(const TextureFormat format);
+	// copies the page and its border out of the texture's mip chain, texels past the level's edge repeat the edge
+	void extractVirtualTile(const TextureAsset& texture, const VirtualPage& page, std::span<uint8_t> tile);
+
+	// least recently used pages of a fixed grid of slots, pinned pages are never evicted
+	class PageCache
+	{
+	public:
+		void Init(const uint32_t slotCount);
+
+		bool Contains(const uint32_t page) const;
+		uint32_t Slot(const uint32_t page) const;
+		// marks a resident page as used by frame
+		void Touch(const uint32_t page, const uint64_t frame);
+		// a free slot, or the slot of the least recently used page, false when every page was used by this frame
+		// evicted is VT_NO_PAGE when the slot was free
+		bool Insert(const uint32_t page, const uint64_t frame, const bool pinned, uint32_t& slot, uint32_t& evicted);
+
+		uint32_t ResidentCount() const;
+
+	private:
+		struct Entry
+		{
+			uint32_t slot;
+			uint64_t lastUsed;
+			bool pinned;
+			std::list<uint32_t>::iterator lruPosition;
+		};
+
+		std::vector<uint32_t> freeSlots;
+		std::unordered_map<uint32_t, Entry> entries;
+		// most recently used first
+		std::list<uint32_t> lru;
+	};
+
+	// a page that has to be copied into its cache slot before the indirection table that points at it is used
+	struct VirtualPageUpload
+	{
+		VirtualPage page;
+		uint32_t slot;
+	};
+
+	// a texture larger than its GPU footprint, sampled through an indirection table into a fixed cache of pages
+	// pages are requested by the feedback pass and streamed from the mapped mip chain of the source asset
+	class VirtualTexture
+	{
+	public:
+		// the source stays mapped for as long as pages are streamed from it
+		// the coarsest level is one page and stays resident, every texel always has something to fall back to
+		void Init(const TextureAsset& source, const uint32_t slotsX, const uint32_t slotsY);
+
+		// collects the pages a feedback readback asks for, resident ones are marked as used by frame
+		void ProcessFeedback(std::span<const uint32_t> feedback, const uint64_t frame);
+		// picks cache slots for at most maxPages of the requested pages, coarse levels first
+		// returns true if the indirection table changed
+		bool UpdatePages(const uint32_t maxPages, const uint64_t frame, std::vector<VirtualPageUpload>& uploads);
+
+		// per level, the best resident page for every page of the level
+		// RGBA8UI texels : cache slot x, cache slot y, resident level, unused
+		std::span<const uint32_t> Indirection() const;
+		std::span<const MipLevel> IndirectionLevels() const;
+
+		uint32_t LevelCount() const;
+		uint32_t SlotsX() const;
+		uint32_t SlotsY() const;
+		uint32_t Width() const;
+		uint32_t Height() const;
+		const TextureAsset& Source() const;
+
+	private:
+		bool pageInRange(const VirtualPage& page) const;
+		void rebuildIndirection();
+
+		const TextureAsset* p_source{ nullptr };
+		uint32_t slotsX{ 0 };
+		uint32_t slotsY{ 0 };
+		uint32_t levelCount{ 0 };
+		// the indirection table is a power of two so its mips halve exactly like the page grid
+		std::vector<MipLevel> indirectionLevels;
+		std::vector<uint32_t> indirection;
+
+		PageCache cache;
+		std::vector<uint32_t> requested;
+	};
+}
+
+#endif // VIRTUAL_TEXTURE_INCLUDE_H
@@ -29,5 +29,7 @@ constexpr uint32_t ENGINE_VERSION{ VK_MAKE_VERSION(1, 0, 0) };
 
 const std::string MODEL_PATH{ "res/model/viking_room.obj" };
 const std::string TEXTURE_PATH{ "res/tex/viking_room.png" };
+// written by djinn_cook (the cook_assets target), assets missing from it load from the loose files above
+const std::string PACK_PATH{ "res/djinn.pack" };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,166 @@
+// bakes meshes and textures into an asset pack the engine maps at startup
+// usage : djinn_cook <out.pack> [--compact] [--split-positions] [--texture-format rgba8|bc1|bc3|bc7] [--compress] <asset>...
+// names in the pack are the asset paths as given, run it from the directory the engine runs in
+
+#include <spdlog/spdlog.h>
+
+#include "../core/AssetPack.h"
+#include "../core/MeshAsset.h"
+#include "../core/TextureAsset.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct NamedTextureFormat
+	{
+		const char* name;
+		Djinn::TextureFormat format;
+	};
+
+	constexpr NamedTextureFormat TEXTURE_FORMAT_NAMES[]
+	{
+		{ "rgba8", Djinn::TextureFormat::TEXTURE_FORMAT_RGBA8 },
+		{ "bc1", Djinn::TextureFormat::TEXTURE_FORMAT_BC1 },
+		{ "bc3", Djinn::TextureFormat::TEXTURE_FORMAT_BC3 },
+		{ "bc7", Djinn::TextureFormat::TEXTURE_FORMAT_BC7 }
+	};
+
+	bool parseTextureFormat(const std::string& name, Djinn::TextureFormat& format)
+	{
+		for (const auto& named : TEXTURE_FORMAT_NAMES)
+		{
+			if (name == named.name)
+			{
+				format = named.format;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool isTexture(const std::string& path)
+	{
+		const auto extension{ std::filesystem::path(path).extension().string() };
+		return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp";
+	}
+
+	// the loaders leave a current cache file next to the source, its bytes are what goes into the pack
+	bool cookAsset(const std::string& path, const VertexFormat vertexFormat, const bool splitPositions,
+		const Djinn::TextureFormat textureFormat, std::vector<Djinn::MappedFile>& images, std::vector<Djinn::AssetPackInput>& inputs)
+	{
+		Djinn::PackEntryType type;
+		std::string cachePath;
+		if (isTexture(path))
+		{
+			Djinn::TextureAsset texture;
+			if (!Djinn::loadTextureAsset(path, textureFormat, texture))
+			{
+				return false;
+			}
+			type = Djinn::PackEntryType::PACK_ENTRY_TEXTURE;
+			cachePath = Djinn::TextureCache::CachePath(path);
+		}
+		else
+		{
+			Djinn::MeshAsset mesh;
+			if (!Djinn::loadMeshAsset(path, vertexFormat, splitPositions, mesh))
+			{
+				return false;
+			}
+			if (mesh.streams.vertexFormat == VertexFormat::VERTEX_FORMAT_GLTF)
+			{
+				// already in its final layout, the runtime maps the .glb itself
+				spdlog::info("{} is read in place, leaving it out of the pack", path);
+				return true;
+			}
+			type = Djinn::PackEntryType::PACK_ENTRY_MESH;
+			cachePath = Djinn::MeshCache::CachePath(path);
+		}
+
+		Djinn::MappedFile image;
+		if (!image.Open(cachePath))
+		{
+			spdlog::error("No cache was written for {}", path);
+			return false;
+		}
+
+		spdlog::info("Cooked {} ({} bytes)", path, image.Size());
+		inputs.push_back({ path, type, { image.Data(), image.Size() } });
+		images.push_back(std::move(image));
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		spdlog::error("usage : djinn_cook <out.pack> [--compact] [--split-positions] [--texture-format rgba8|bc1|bc3|bc7] [--compress] <asset>...");
+		return EXIT_FAILURE;
+	}
+
+	// defaults match RendererConfig, a pack cooked for other settings falls back to the loose files at runtime
+	VertexFormat vertexFormat{ VertexFormat::VERTEX_FORMAT_FULL };
+	bool splitPositions{ false };
+	Djinn::TextureFormat textureFormat{ Djinn::TextureFormat::TEXTURE_FORMAT_BC7 };
+	// smaller packs for slow storage, the loaders then decode on the streaming threads
+	Djinn::PackCompression compression{ Djinn::PackCompression::PACK_COMPRESSION_NONE };
+	std::vector<std::string> assets;
+
+	for (int i = 2; i < argc; ++i)
+	{
+		const std::string arg{ argv[i] };
+		if (arg == "--compact")
+		{
+			vertexFormat = VertexFormat::VERTEX_FORMAT_COMPACT;
+		}
+		else if (arg == "--split-positions")
+		{
+			splitPositions = true;
+		}
+		else if (arg == "--compress")
+		{
+			compression = Djinn::PackCompression::PACK_COMPRESSION_LZ;
+		}
+		else if (arg == "--texture-format")
+		{
+			if (i + 1 >= argc || !parseTextureFormat(argv[i + 1], textureFormat))
+			{
+				spdlog::error("--texture-format takes one of rgba8, bc1, bc3, bc7");
+				return EXIT_FAILURE;
+			}
+			++i;
+		}
+		else
+		{
+			assets.push_back(arg);
+		}
+	}
+
+	// the mapped cache files back the input spans until the pack is written
+	std::vector<Djinn::MappedFile> images;
+	std::vector<Djinn::AssetPackInput> inputs;
+	images.reserve(assets.size());
+	inputs.reserve(assets.size());
+	for (const auto& asset : assets)
+	{
+		if (!cookAsset(asset, vertexFormat, splitPositions, textureFormat, images, inputs))
+		{
+			spdlog::error("Failed to cook {}", asset);
+			return EXIT_FAILURE;
+		}
+	}
+
+	const std::string packPath{ argv[1] };
+	if (!Djinn::AssetPack::Store(packPath, inputs, compression))
+	{
+		spdlog::error("Failed to write {}", packPath);
+		return EXIT_FAILURE;
+	}
+
+	spdlog::info("Wrote {} assets to {}", inputs.size(), packPath);
+	return EXIT_SUCCESS;
+}